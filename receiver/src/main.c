@@ -0,0 +1,350 @@
+#include "broadcast.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/usb/usb_device.h>
+#include <zephyr/usb/class/usb_hid.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME receiver
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define KEY_LEFT   0x50 // same mapping as the clicker, button 0
+#define KEY_RIGHT  0x4f // button 1
+
+#define SYNC_TIMEOUT      100  // 10 ms units, sync lost after this long without a packet
+#define STATS_INTERVAL_S  10
+#define KEY_REPORT_LEN    8    // boot keyboard input report
+
+static struct bt_le_per_adv_sync *sync;
+static bool have_seq;
+static uint16_t last_seq;
+
+// The one clicker followed, from Kconfig or the first one synced to
+static bt_addr_le_t bound_addr;
+static bool bound;
+
+static struct receiver_stats {
+    uint32_t packets;   // periodic advertising packets received
+    uint32_t applied;   // events turned into key reports
+    uint32_t lost;      // events that fell out of the window before a packet was heard
+    uint32_t dropped;   // key reports that did not fit the queue or the endpoint refused
+} stats;
+
+
+#if defined(CONFIG_USB_DEVICE_HID)
+
+static const uint8_t report_map[] = HID_KEYBOARD_REPORT_DESC();
+static const struct device *hid_dev;
+
+/* Sync callbacks run on the BT RX thread and one packet can carry a whole
+ * window of events, but the interrupt endpoint takes one report per host
+ * poll. Reports wait here and go out one at a time from int_in_ready.
+ */
+K_MSGQ_DEFINE(report_queue, KEY_REPORT_LEN, CONFIG_RECEIVER_REPORT_QUEUE, 1);
+
+// Set while a report is on the interrupt endpoint, cleared once the queue is empty
+static atomic_t in_flight;
+
+
+static void report_next(void)
+{
+    uint8_t report[KEY_REPORT_LEN];
+
+    do {
+        while (k_msgq_get(&report_queue, report, K_NO_WAIT) == 0) {
+            if (hid_int_ep_write(hid_dev, report, sizeof(report), NULL) == 0) {
+                return;
+            }
+            stats.dropped++;
+        }
+        atomic_clear(&in_flight);
+        // a report queued between the last get and the clear is ours to send
+    } while (k_msgq_num_used_get(&report_queue) && atomic_cas(&in_flight, 0, 1));
+}
+
+
+static void int_in_ready(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    report_next();
+}
+
+
+static const struct hid_ops hid_ops = {
+    .int_in_ready = int_in_ready,
+};
+
+
+static void key_report_send(uint16_t seq, uint8_t button_mask)
+{
+    uint8_t report[KEY_REPORT_LEN] = { 0 };
+    size_t n = 2;
+
+    ARG_UNUSED(seq);
+
+    if (button_mask & BIT(0)) {
+        report[n++] = KEY_LEFT;
+    }
+    if (button_mask & BIT(1)) {
+        report[n++] = KEY_RIGHT;
+    }
+
+    if (k_msgq_put(&report_queue, report, K_NO_WAIT)) {
+        stats.dropped++;
+        return;
+    }
+    if (atomic_cas(&in_flight, 0, 1)) {
+        report_next();
+    }
+}
+
+
+static int output_init(void)
+{
+    hid_dev = device_get_binding("HID_0");
+    if (!hid_dev) {
+        LOG_ERR("USB HID device not found!");
+        return -ENODEV;
+    }
+    usb_hid_register_device(hid_dev, report_map, sizeof(report_map), &hid_ops);
+    usb_hid_init(hid_dev);
+    return usb_enable(NULL);
+}
+
+#else
+
+/* No USB device controller (nrf52_bsim): every key report becomes a log
+ * line with its time, which the bsim scenario matches against the
+ * clicker's button stimulus.
+ */
+static void key_report_send(uint16_t seq, uint8_t button_mask)
+{
+    LOG_INF("report seq %u mask 0x%02x at %llu us\n", seq, button_mask,
+            k_ticks_to_us_floor64(k_uptime_ticks()));
+}
+
+
+static int output_init(void)
+{
+    return 0;
+}
+
+#endif
+
+
+/* Apply the events newer than the last one seen, oldest first */
+static void payload_apply(const struct broadcast_payload *payload, uint8_t len)
+{
+    uint8_t count = MIN(payload->count, (len - offsetof(struct broadcast_payload, events)) /
+                                        sizeof(struct broadcast_event));
+    uint16_t newest, oldest, seq;
+
+    if (!count) {
+        return;
+    }
+
+    newest = sys_le16_to_cpu(payload->events[0].seq);
+    oldest = sys_le16_to_cpu(payload->events[count - 1].seq);
+
+    if (!have_seq) {
+        // joining mid-stream, only the current state matters
+        key_report_send(newest, payload->events[0].button_mask);
+        have_seq = true;
+        last_seq = newest;
+        return;
+    }
+
+    if ((int16_t)(newest - last_seq) <= 0) {
+        return; // repeat of a packet already applied
+    }
+    if ((int16_t)(oldest - last_seq) > 1) {
+        stats.lost += (uint16_t)(oldest - last_seq - 1);
+    }
+
+    for (int i = count - 1; i >= 0; i--) {
+        seq = sys_le16_to_cpu(payload->events[i].seq);
+        if ((int16_t)(seq - last_seq) <= 0) {
+            continue;
+        }
+        key_report_send(seq, payload->events[i].button_mask);
+        last_seq = seq;
+        stats.applied++;
+    }
+}
+
+
+static bool payload_find(struct bt_data *data, void *user_data)
+{
+    const struct broadcast_payload *payload = (const void *)data->data;
+
+    if (data->type != BT_DATA_MANUFACTURER_DATA ||
+        data->data_len < offsetof(struct broadcast_payload, events) ||
+        sys_le16_to_cpu(payload->company) != BROADCAST_COMPANY_ID ||
+        payload->version != BROADCAST_VERSION) {
+        return true;
+    }
+
+    payload_apply(payload, data->data_len);
+    return false;
+}
+
+
+static void sync_recv(struct bt_le_per_adv_sync *sync, const struct bt_le_per_adv_sync_recv_info *info,
+                      struct net_buf_simple *buf)
+{
+    stats.packets++;
+    bt_data_parse(buf, payload_find, NULL);
+}
+
+
+static void sync_synced(struct bt_le_per_adv_sync *sync, struct bt_le_per_adv_sync_synced_info *info)
+{
+    char addr[BT_ADDR_LE_STR_LEN];
+
+    if (!bound) {
+        // nothing configured: stay with this clicker until reset
+        bt_addr_le_copy(&bound_addr, info->addr);
+        bound = true;
+    }
+
+    bt_addr_le_to_str(info->addr, addr, sizeof(addr));
+    LOG_INF("Synced to %s, interval %u\n", addr, info->interval);
+    have_seq = false;
+}
+
+
+static void sync_terminated(struct bt_le_per_adv_sync *s, const struct bt_le_per_adv_sync_term_info *info)
+{
+    LOG_INF("Sync lost (reason %u)\n", info->reason);
+    sync = NULL;
+
+    // release keys, the clicker may be gone while a button was held
+    key_report_send(last_seq, 0);
+    bt_le_scan_start(BT_LE_SCAN_PASSIVE, NULL);
+}
+
+
+static struct bt_le_per_adv_sync_cb sync_callbacks = {
+    .synced = sync_synced,
+    .term = sync_terminated,
+    .recv = sync_recv,
+};
+
+
+static bool broadcast_uuid_find(struct bt_data *data, void *user_data)
+{
+    static const uint8_t uuid[] = { BT_UUID_BROADCAST_SERVICE_VAL };
+    bool *found = user_data;
+
+    if (data->type == BT_DATA_UUID128_ALL && data->data_len >= sizeof(uuid) &&
+        !memcmp(data->data, uuid, sizeof(uuid))) {
+        *found = true;
+        return false;
+    }
+    return true;
+}
+
+
+static void scan_recv(const struct bt_le_scan_recv_info *info, struct net_buf_simple *ad)
+{
+    struct bt_le_per_adv_sync_param param = { 0 };
+    bool found = false;
+    int err;
+
+    if (sync || !info->interval) {
+        return; // already synced, or no periodic advertising behind this set
+    }
+    if (bound && !bt_addr_le_eq(info->addr, &bound_addr)) {
+        return; // another clicker
+    }
+
+    bt_data_parse(ad, broadcast_uuid_find, &found);
+    if (!found) {
+        return;
+    }
+
+    bt_addr_le_copy(&param.addr, info->addr);
+    param.sid = info->sid;
+    param.timeout = SYNC_TIMEOUT;
+
+    err = bt_le_per_adv_sync_create(&param, &sync);
+    if (err) {
+        LOG_WRN("Sync create failed (err %d)\n", err);
+        return;
+    }
+    bt_le_scan_stop();
+}
+
+
+static struct bt_le_scan_cb scan_callbacks = {
+    .recv = scan_recv,
+};
+
+
+static int bound_addr_init(void)
+{
+    int err;
+
+    if (!strlen(CONFIG_RECEIVER_BROADCASTER_ADDR)) {
+        LOG_WRN("No broadcaster configured, following the first one heard\n");
+        return 0;
+    }
+
+    err = bt_addr_le_from_str(CONFIG_RECEIVER_BROADCASTER_ADDR, "random", &bound_addr);
+    if (err) {
+        LOG_ERR("Invalid broadcaster address %s\n", CONFIG_RECEIVER_BROADCASTER_ADDR);
+        return err;
+    }
+    bound = true;
+    return 0;
+}
+
+
+int main(void)
+{
+    int err;
+
+    err = bound_addr_init();
+    if (err) {
+        return 0;
+    }
+
+    err = output_init();
+    if (err) {
+        LOG_ERR("Output init failed (err %d)\n", err);
+        return 0;
+    }
+
+    err = bt_enable(NULL);
+    if (err) {
+        LOG_ERR("Bluetooth init failed (err %d)\n", err);
+        return 0;
+    }
+
+    bt_le_scan_cb_register(&scan_callbacks);
+    bt_le_per_adv_sync_cb_register(&sync_callbacks);
+
+    err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, NULL);
+    if (err) {
+        LOG_ERR("Scan start failed (err %d)\n", err);
+        return 0;
+    }
+
+    for (;;) {
+        k_sleep(K_SECONDS(STATS_INTERVAL_S));
+        LOG_INF("packets %u, events %u, lost %u, dropped %u\n", stats.packets, stats.applied, stats.lost,
+                stats.dropped);
+    }
+
+    return 0;
+}
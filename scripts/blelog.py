@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Capture dictionary logs from the BLE log characteristic and decode them.
+
+The device only sends binary records, the format strings live in the
+log_dictionary.json database produced by the build. Decoding is done by
+Zephyr's dictionary log parser.
+
+    pip install bleak
+    scripts/blelog.py build/zephyr/log_dictionary.json
+"""
+
+import argparse
+import asyncio
+import os
+import subprocess
+import sys
+import tempfile
+
+from bleak import BleakClient, BleakScanner
+
+BLELOG_DATA_UUID = "7472796b-6b65-7274-0301-000000000000"
+
+
+async def capture(name, out, seconds):
+    device = await BleakScanner.find_device_by_name(name)
+    if device is None:
+        sys.exit(f"{name} not found")
+
+    async with BleakClient(device) as client:
+        # the log characteristic requires an encrypted link
+        await client.pair()
+        await client.start_notify(BLELOG_DATA_UUID, lambda _, data: out.write(data))
+        print(f"capturing from {device.address}, ctrl-c to stop", file=sys.stderr)
+        try:
+            await asyncio.sleep(seconds if seconds else float("inf"))
+        except asyncio.CancelledError:
+            pass
+        await client.stop_notify(BLELOG_DATA_UUID)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("database", help="log_dictionary.json from the build directory")
+    parser.add_argument("--name", default="trykkert", help="advertised device name")
+    parser.add_argument("--seconds", type=float, default=0, help="capture duration, 0 until interrupted")
+    parser.add_argument("--raw", help="keep the binary capture in this file")
+    args = parser.parse_args()
+
+    zephyr_base = os.environ.get("ZEPHYR_BASE")
+    if not zephyr_base:
+        sys.exit("ZEPHYR_BASE is not set")
+    log_parser = os.path.join(zephyr_base, "scripts", "logging", "dictionary", "log_parser.py")
+
+    raw = args.raw or tempfile.NamedTemporaryFile(suffix=".bin", delete=False).name
+    with open(raw, "wb") as out:
+        try:
+            asyncio.run(capture(args.name, out, args.seconds))
+        except KeyboardInterrupt:
+            pass
+
+    subprocess.run([sys.executable, log_parser, args.database, raw], check=False)
+
+
+if __name__ == "__main__":
+    main()
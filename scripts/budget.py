@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Report flash and RAM use per module from the linker map and enforce budgets.
+
+Every input section in the map is charged to the object it came from.
+Application objects are reported by source file, and library objects are
+reported by archive. Sections placed in RAM count as RAM, sections in
+flash count as flash, and initialized data counts as both.
+
+Thread stacks are charged to the kernel archive, so the configured stack
+sizes are listed separately from the .config next to the map.
+
+With --baseline, the totals and stack sizes are also compared against the
+map (and .config) of a reference build, e.g. the tree before a change:
+
+    scripts/budget.py build/zephyr/zephyr.map scripts/budgets.json
+    scripts/budget.py build/zephyr/zephyr.map scripts/budgets-minimal.json
+    scripts/budget.py build/zephyr/zephyr.map scripts/budgets.json --baseline base/zephyr/zephyr.map
+
+With --update, the module budgets in the budget file are rewritten from the
+map instead of checked, each rounded up to the next 256 bytes of flash and
+32 bytes of RAM. Modules missing from the map, i.e. compiled out of this
+profile, get 0. The totals are the part's limits and are left as they are:
+
+    scripts/budget.py build/zephyr/zephyr.map scripts/budgets-minimal.json --update
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+from collections import defaultdict
+
+RAM_START = 0x20000000
+RAM_ONLY = ("bss", "noinit", ".noinit")  # NOLOAD, no flash image
+
+OUTPUT_RE = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+INPUT_RE = re.compile(r"^\s+(\S+)?\s*0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+\.(?:obj|o)\)?)$")
+OBJECT_RE = re.compile(r"(?:(\S+\.a)\()?(\S+?)\)?$")
+STACK_RE = re.compile(r"^CONFIG_(\w+_STACK_SIZE)=(\d+)$")
+ROUND = {"flash": 256, "ram": 32}  # --update rounds each measured size up to a multiple of this
+
+
+def module_name(obj):
+    archive, member = OBJECT_RE.match(obj).groups()
+    if archive and os.path.basename(archive) == "libapp.a":
+        return member.replace(".obj", "")
+    if archive:
+        return os.path.basename(archive)
+    return os.path.basename(member).replace(".obj", "")
+
+
+def parse(map_path):
+    usage = defaultdict(lambda: {"flash": 0, "ram": 0})
+    output, output_ram = None, False
+
+    with open(map_path) as f:
+        lines = f.read().split("\n")
+
+    started = False
+    for line in lines:
+        if line.startswith("Linker script and memory map"):
+            started = True
+            continue
+        if not started:
+            continue
+
+        match = OUTPUT_RE.match(line)
+        if match:
+            output = match.group(1)
+            output_ram = int(match.group(2), 16) >= RAM_START
+            continue
+
+        match = INPUT_RE.match(line)
+        if not match or output is None:
+            continue
+        size = int(match.group(3), 16)
+        if not size:
+            continue
+
+        module = module_name(match.group(4))
+        if output_ram:
+            usage[module]["ram"] += size
+            if output not in RAM_ONLY:
+                usage[module]["flash"] += size  # initial values are copied from flash
+        else:
+            usage[module]["flash"] += size
+
+    return usage
+
+
+def stacks(config_path):
+    sizes = {}
+
+    if not os.path.exists(config_path):
+        return sizes
+    with open(config_path) as f:
+        for line in f:
+            match = STACK_RE.match(line.strip())
+            if match:
+                sizes[match.group(1)] = int(match.group(2))
+
+    return sizes
+
+
+def update(usage, budgets, path):
+    modules = {name for name in usage if name.endswith(".c")} | budgets["modules"].keys()
+    width = max(len(name) for name in modules) + 3
+
+    lines = []
+    for name in sorted(modules, key=lambda name: -usage.get(name, {}).get("flash", 0)):
+        used = usage.get(name, {"flash": 0, "ram": 0})
+        flash, ram = (-(-used[kind] // ROUND[kind]) * ROUND[kind] for kind in ("flash", "ram"))
+        key, flash = f'"{name}":', f"{flash},"
+        lines.append(f'        {key:{width}} {{ "flash": {flash:6} "ram": {ram} }}')
+
+    total = budgets["total"]
+    with open(path, "w") as f:
+        f.write("{\n")
+        f.write(f'    "total": {{ "flash": {total["flash"]}, "ram": {total["ram"]} }},\n')
+        f.write('    "modules": {\n')
+        f.write(",\n".join(lines) + "\n")
+        f.write("    }\n}\n")
+    print(f"{path}: {len(lines)} module budgets updated")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="zephyr.map from the build directory")
+    parser.add_argument("budgets", help="budget file, see scripts/budgets.json")
+    parser.add_argument("--baseline", help="zephyr.map of a reference build to print deltas against")
+    parser.add_argument("--update", action="store_true", help="rewrite the module budgets from the map")
+    args = parser.parse_args()
+
+    usage = parse(args.map)
+    with open(args.budgets) as f:
+        budgets = json.load(f)
+
+    if args.update:
+        update(usage, budgets, args.budgets)
+        return
+
+    total = {
+        "flash": sum(u["flash"] for u in usage.values()),
+        "ram": sum(u["ram"] for u in usage.values()),
+    }
+    over = []
+
+    print(f"{'module':40} {'flash':>8} {'budget':>8} {'ram':>8} {'budget':>8}")
+    for module, used in sorted(usage.items(), key=lambda item: -item[1]["flash"]):
+        budget = budgets["modules"].get(module, {})
+        for kind in ("flash", "ram"):
+            if kind in budget and used[kind] > budget[kind]:
+                over.append(f"{module} {kind} {used[kind]} > {budget[kind]}")
+        print(f"{module:40} {used['flash']:8} {budget.get('flash', ''):>8} {used['ram']:8} {budget.get('ram', ''):>8}")
+
+    print(f"{'total':40} {total['flash']:8} {budgets['total']['flash']:8} {total['ram']:8} {budgets['total']['ram']:8}")
+    for kind in ("flash", "ram"):
+        if total[kind] > budgets["total"][kind]:
+            over.append(f"total {kind} {total[kind]} > {budgets['total'][kind]}")
+
+    base_sizes = {}
+    if args.baseline:
+        base = parse(args.baseline)
+        for kind in ("flash", "ram"):
+            base_total = sum(u[kind] for u in base.values())
+            print(f"{'delta ' + kind:40} {total[kind] - base_total:+8} (baseline {base_total})")
+        base_sizes = stacks(os.path.join(os.path.dirname(args.baseline), ".config"))
+
+    sizes = stacks(os.path.join(os.path.dirname(args.map), ".config"))
+    if sizes:
+        print(f"\n{'stack':40} {'bytes':>8} {'baseline':>8} {'delta':>8}")
+        for name in sorted(sizes.keys() | base_sizes.keys(), key=lambda name: -sizes.get(name, 0)):
+            size, base_size = sizes.get(name, 0), base_sizes.get(name)
+            delta = f"{size - base_size:+8}" if base_size is not None else ""
+            print(f"{name:40} {size:8} {'' if base_size is None else base_size:>8} {delta:>8}")
+        base_total = f"{sum(base_sizes.values()):8}" if base_sizes else ""
+        base_delta = f"{sum(sizes.values()) - sum(base_sizes.values()):+8}" if base_sizes else ""
+        print(f"{'total':40} {sum(sizes.values()):8} {base_total:>8} {base_delta:>8}")
+
+    if over:
+        print("\nover budget:\n  " + "\n  ".join(over), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
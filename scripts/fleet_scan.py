@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Inventory clickers from their advertising data with one passive scan.
+
+Every unit advertises its battery voltage, charge state, firmware version
+and an error flag as manufacturer data, both while connectable and as a
+10 s storage beacon. Nothing is connected to, so scanning does not drain
+the units. This is the reference scanner on Linux (BlueZ through bleak).
+Passive scanning needs BlueZ 5.56+ with experimental features enabled.
+
+    pip install bleak
+    scripts/fleet_scan.py --time 15
+"""
+
+import argparse
+import asyncio
+import struct
+
+from bleak import BleakScanner
+from bleak.assigned_numbers import AdvertisementDataType
+from bleak.backends.bluezdbus.advertisement_monitor import OrPattern
+from bleak.backends.bluezdbus.scanner import BlueZScannerArgs
+
+COMPANY_ID = 0xFFFF  # ADV_STATUS_COMPANY_ID
+VERSION = 1          # ADV_STATUS_VERSION
+
+FLAG_CHARGING = 1 << 0
+FLAG_VBUS = 1 << 1
+FLAG_ERROR = 1 << 2
+FLAG_BEACON = 1 << 3
+FLAG_HUB = 1 << 4
+
+# struct adv_status after the company ID
+STATUS = struct.Struct("<BBHBBB")
+
+
+def status_parse(data):
+    if len(data) < STATUS.size:
+        return None
+    version, flags, battery_mv, major, minor, patch = STATUS.unpack_from(data)
+    if version != VERSION:
+        return None
+    return {
+        "battery_mv": battery_mv,
+        "charging": bool(flags & FLAG_CHARGING),
+        "vbus": bool(flags & FLAG_VBUS),
+        "error": bool(flags & FLAG_ERROR),
+        "beacon": bool(flags & FLAG_BEACON),
+        "hub": bool(flags & FLAG_HUB),
+        "firmware": f"{major}.{minor}.{patch}",
+    }
+
+
+async def scan(args):
+    units = {}
+
+    def found(device, adv):
+        data = adv.manufacturer_data.get(COMPANY_ID)
+        status = status_parse(data) if data else None
+        if status:
+            units[device.address] = dict(status, name=adv.local_name or device.name or "", rssi=adv.rssi)
+
+    # BlueZ only scans passively with an advertisement monitor pattern
+    pattern = OrPattern(0, AdvertisementDataType.MANUFACTURER_SPECIFIC_DATA, struct.pack("<H", COMPANY_ID))
+    kwargs = {}
+    if not args.active:
+        kwargs = {"scanning_mode": "passive", "bluez": BlueZScannerArgs(or_patterns=[pattern])}
+
+    async with BleakScanner(found, **kwargs):
+        await asyncio.sleep(args.time)
+
+    return units
+
+
+def report(units):
+    print(f"{'address':17}  {'name':10} {'mV':>5} {'chg':>3} {'usb':>3} {'err':>3} {'mode':>7} {'fw':>8} {'rssi':>5}")
+    for address, unit in sorted(units.items(), key=lambda item: item[1]["battery_mv"]):
+        print(f"{address:17}  {unit['name'][:10]:10} {unit['battery_mv']:5} "
+              f"{'yes' if unit['charging'] else '':>3} {'yes' if unit['vbus'] else '':>3} "
+              f"{'ERR' if unit['error'] else '':>3} {'beacon' if unit['beacon'] else 'hub' if unit['hub'] else 'adv':>7} "
+              f"{unit['firmware']:>8} {unit['rssi']:5}")
+    print(f"{len(units)} units")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--time", type=float, default=15, help="scan time in s, longer than the 10 s beacon interval")
+    parser.add_argument("--active", action="store_true", help="active scan, for BlueZ without advertisement monitors")
+    args = parser.parse_args()
+
+    report(asyncio.run(scan(args)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Read and write the runtime-tunable parameters of a clicker.
+
+Without --set the effective values are printed. --set writes a complete
+set with the named fields changed; the device validates it, applies it
+without a reboot and keeps it across reboots. The link must be bonded.
+This is the reference client on Linux (BlueZ through bleak).
+
+    pip install bleak
+    scripts/params.py
+    scripts/params.py --set debounce_ms=15 --set adv_fast_int_max=48
+    scripts/params.py --reset
+"""
+
+import argparse
+import asyncio
+import struct
+import sys
+
+from bleak import BleakClient, BleakScanner
+
+PARAMS_VALUES_UUID = "7472796b-6b65-7274-0701-000000000000"
+PARAMS_VERSION = 1
+PARAMS_RESET = b"\x00"
+
+# struct params
+FIELDS = ("version", "adc_samples", "debounce_ms", "longpress_ms", "battery_interval_s", "blink_ms",
+          "adv_fast_int_min", "adv_fast_int_max", "adv_slow_int_min", "adv_slow_int_max")
+LAYOUT = struct.Struct("<BBHHHHHHHH")
+
+
+def assignments(values):
+    changes = {}
+    for value in values:
+        name, _, number = value.partition("=")
+        if name not in FIELDS[1:] or not number:
+            sys.exit(f"unknown parameter or missing value: {value}")
+        changes[name] = int(number, 0)
+    return changes
+
+
+async def run(args):
+    device = await BleakScanner.find_device_by_name(args.name)
+    if device is None:
+        sys.exit(f"{args.name} not found")
+
+    async with BleakClient(device) as client:
+        await client.pair()
+
+        if args.reset:
+            await client.write_gatt_char(PARAMS_VALUES_UUID, PARAMS_RESET, response=True)
+        elif args.set:
+            params = dict(zip(FIELDS, LAYOUT.unpack(await client.read_gatt_char(PARAMS_VALUES_UUID))))
+            if params["version"] != PARAMS_VERSION:
+                sys.exit(f"unsupported parameter version {params['version']}")
+            params.update(assignments(args.set))
+            # rejected as a whole when any value is out of range
+            await client.write_gatt_char(PARAMS_VALUES_UUID, LAYOUT.pack(*(params[f] for f in FIELDS)),
+                                         response=True)
+
+        return dict(zip(FIELDS, LAYOUT.unpack(await client.read_gatt_char(PARAMS_VALUES_UUID))))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--name", default="trykkert", help="advertised device name")
+    parser.add_argument("--set", action="append", metavar="NAME=VALUE", help="change one parameter")
+    parser.add_argument("--reset", action="store_true", help="back to the built-in defaults")
+    args = parser.parse_args()
+
+    for name, value in asyncio.run(run(args)).items():
+        print(f"{name:20} {value}")
+
+
+if __name__ == "__main__":
+    main()
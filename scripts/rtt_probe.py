@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Measure BLE round-trip time with the vendor echo characteristic.
+
+Each probe is a write-without-response carrying a sequence number, and
+the device notifies it straight back. Timing uses the host clock only.
+This is the reference client on Linux (BlueZ through bleak).
+
+    pip install bleak
+    scripts/rtt_probe.py --count 1000 --size 20
+"""
+
+import argparse
+import asyncio
+import statistics
+import struct
+import sys
+import time
+
+from bleak import BleakClient, BleakScanner
+
+PROBE_ECHO_UUID = "7472796b-6b65-7274-0401-000000000000"
+
+
+async def probe(args):
+    device = await BleakScanner.find_device_by_name(args.name)
+    if device is None:
+        sys.exit(f"{args.name} not found")
+
+    sent = {}
+    rtts = []
+    done = asyncio.Event()
+
+    def echoed(_, data):
+        (seq,) = struct.unpack_from("<I", data)
+        if seq in sent:
+            rtts.append((time.perf_counter() - sent.pop(seq)) * 1000)
+        if seq == args.count - 1:
+            done.set()
+
+    async with BleakClient(device) as client:
+        await client.pair()
+        await client.start_notify(PROBE_ECHO_UUID, echoed)
+
+        padding = bytes(max(args.size - 4, 0))
+        for seq in range(args.count):
+            sent[seq] = time.perf_counter()
+            await client.write_gatt_char(PROBE_ECHO_UUID, struct.pack("<I", seq) + padding, response=False)
+            await asyncio.sleep(args.interval / 1000)
+
+        # probes still unanswered after the last echo, or after the timeout, count as lost
+        try:
+            await asyncio.wait_for(done.wait(), timeout=2)
+        except asyncio.TimeoutError:
+            pass
+        await client.stop_notify(PROBE_ECHO_UUID)
+
+    return rtts, len(sent)
+
+
+def report(rtts, lost):
+    if not rtts:
+        sys.exit("no echoes received")
+
+    rtts.sort()
+    pct = lambda p: rtts[min(int(len(rtts) * p / 100), len(rtts) - 1)]
+    print(f"samples {len(rtts)}  lost {lost}")
+    print(f"min {rtts[0]:.2f}  p50 {pct(50):.2f}  p90 {pct(90):.2f}  p99 {pct(99):.2f}  "
+          f"max {rtts[-1]:.2f}  mean {statistics.mean(rtts):.2f} ms")
+
+    # coarse histogram in 2.5 ms buckets
+    buckets = {}
+    for rtt in rtts:
+        bucket = int(rtt / 2.5) * 2.5
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    width = max(buckets.values())
+    for bucket in sorted(buckets):
+        print(f"{bucket:7.1f} ms {'#' * max(1, buckets[bucket] * 50 // width)} {buckets[bucket]}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--name", default="trykkert", help="advertised device name")
+    parser.add_argument("--count", type=int, default=500, help="probes to send")
+    parser.add_argument("--size", type=int, default=4, help="probe payload size in bytes, at least 4")
+    parser.add_argument("--interval", type=float, default=20, help="time between probes in ms")
+    args = parser.parse_args()
+
+    rtts, lost = asyncio.run(probe(args))
+    report(rtts, lost)
+
+
+if __name__ == "__main__":
+    main()
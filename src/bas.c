@@ -34,6 +34,7 @@ static ssize_t read_blvl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
     return bt_gatt_attr_read(conn, attr, buf, len, offset, &lvl8, sizeof(lvl8));
 }
 
+#if defined(CONFIG_APP_BAS_LEVEL_STATUS)
 static void blvl_status_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
     ARG_UNUSED(attr);
@@ -48,6 +49,7 @@ static ssize_t read_blvl_status(struct bt_conn *conn, const struct bt_gatt_attr
     };
     return bt_gatt_attr_read(conn, attr, buf, len, offset, &status, sizeof(status));
 }
+#endif
 
 BT_GATT_SERVICE_DEFINE(bas_extended,
     BT_GATT_PRIMARY_SERVICE(
@@ -65,6 +67,7 @@ BT_GATT_SERVICE_DEFINE(bas_extended,
         BT_GATT_PERM_READ | BT_GATT_PERM_WRITE
     ),
 
+#if defined(CONFIG_APP_BAS_LEVEL_STATUS)
     BT_GATT_CHARACTERISTIC(
         BT_UUID_BAS_BATTERY_LEVEL_STATUS,
         BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
@@ -75,6 +78,7 @@ BT_GATT_SERVICE_DEFINE(bas_extended,
         blvl_status_ccc_cfg_changed,
         BT_GATT_PERM_READ | BT_GATT_PERM_WRITE
     ),
+#endif
 );
 
 static int bas_init(void)
@@ -142,11 +146,13 @@ int bas_notify(void)
         &battery_level, sizeof(battery_level)
     );
 
+#if defined(CONFIG_APP_BAS_LEVEL_STATUS)
     // notify battery status (not working... not implemented on iOS???)
     rc |= bt_gatt_notify(
         NULL, bt_gatt_find_by_uuid(bas_extended.attrs, 0, BT_UUID_BAS_BATTERY_LEVEL_STATUS),
         &battery_level_status, sizeof(battery_level_status)
     );
+#endif
 
     return rc == -ENOTCONN ? 0 : rc;
 }
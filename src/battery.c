@@ -1,10 +1,12 @@
 #include "battery.h"
+#include "params.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/adc.h>
+#include <zephyr/pm/device_runtime.h>
 
 #include <zephyr/logging/log.h>
 #define LOG_MODULE_NAME battery
@@ -17,8 +19,9 @@ static const struct device *adc_battery_dev = DEVICE_DT_GET(DT_NODELABEL(adc));
 #define GPIO_BATTERY_CHARGING_ENABLE 17
 #define GPIO_BATTERY_READ_ENABLE 14
 
-#define ADC_TOTAL_SAMPLES 10
-int16_t sample_buffer[ADC_TOTAL_SAMPLES];
+#define BATTERY_DIVIDER_SETTLE_MS 2 // divider output settles after enable
+
+int16_t sample_buffer[BATTERY_ADC_SAMPLES_MAX];
 
 #define ADC_RESOLUTION 12
 #define ADC_CHANNEL 7
@@ -37,7 +40,7 @@ struct adc_channel_cfg channel_7_cfg = {
 };
 
 static struct adc_sequence_options options = {
-    .extra_samplings = ADC_TOTAL_SAMPLES - 1,
+    .extra_samplings = BATTERY_ADC_SAMPLES_DEFAULT - 1,
     .interval_us = 500, // Interval between each sample
 };
 
@@ -50,24 +53,24 @@ struct adc_sequence sequence = {
 
 typedef struct
 {
-    float voltage;
+    int millivolt;
     int percentage;
 } BatteryState;
 
 #define BATTERY_STATES_COUNT 12
 BatteryState battery_states[BATTERY_STATES_COUNT] = {
-    {4.20, 100},
-    {4.16, 99},
-    {4.09, 91},
-    {4.03, 78},
-    {3.89, 63},
-    {3.83, 53},
-    {3.68, 36},
-    {3.66, 35},
-    {3.48, 14},
-    {3.42, 11},
-    {3.15, 1}, // .24
-    {0.00, 0}  // Below safe level
+    {4200, 100},
+    {4160, 99},
+    {4090, 91},
+    {4030, 78},
+    {3890, 63},
+    {3830, 53},
+    {3680, 36},
+    {3660, 35},
+    {3480, 14},
+    {3420, 11},
+    {3150, 1}, // .24
+    {0, 0}     // Below safe level
 };
 
 static uint8_t is_initialized = false;
@@ -77,6 +80,11 @@ static int battery_enable_read()
     return gpio_pin_set(gpio_battery_dev, GPIO_BATTERY_READ_ENABLE, 1);
 }
 
+static int battery_disable_read()
+{
+    return gpio_pin_set(gpio_battery_dev, GPIO_BATTERY_READ_ENABLE, 0);
+}
+
 int battery_set_fast_charge()
 {
     if (!is_initialized)
@@ -97,7 +105,7 @@ int battery_set_slow_charge()
     return gpio_pin_set(gpio_battery_dev, GPIO_BATTERY_CHARGE_SPEED, 0); // SLOW charge 50mA
 }
 
-int battery_get_voltage(float *battery_volt)
+int battery_get_millivolt(int *battery_mv)
 {
 
     int ret = 0;
@@ -110,6 +118,15 @@ int battery_get_voltage(float *battery_volt)
     int32_t adc_vref = adc_ref_internal(adc_battery_dev);
     int battery_millivolt = 0;
     int adc_mv = 0;
+    int samples = params_get()->adc_samples;
+
+    options.extra_samplings = samples - 1;
+    sequence.buffer_size = samples * sizeof(sample_buffer[0]);
+
+    // divider and ADC are only powered for the duration of the measurement
+    ret |= battery_enable_read();
+    ret |= pm_device_runtime_get(adc_battery_dev);
+    k_msleep(BATTERY_DIVIDER_SETTLE_MS);
 
     ret |= adc_read(adc_battery_dev, &sequence);
     if (ret)
@@ -117,45 +134,51 @@ int battery_get_voltage(float *battery_volt)
         LOG_WRN("ADC read failed (error %d)", ret);
     }
 
+    pm_device_runtime_put(adc_battery_dev);
+    battery_disable_read();
+
     // Get average sample value.
-    for (int sample = 0; sample < ADC_TOTAL_SAMPLES; sample++)
+    for (int sample = 0; sample < samples; sample++)
     {
         adc_mv += sample_buffer[sample]; // ADC value, not millivolt yet.
     }
-    adc_mv /= ADC_TOTAL_SAMPLES;
+    adc_mv /= samples;
 
     // Convert sample value to millivolts
     ret |= adc_raw_to_millivolts(adc_vref, ADC_GAIN, ADC_RESOLUTION, &adc_mv);
 
     // Calculate battery voltage.
     battery_millivolt = adc_mv * ((R1 + R2) / R2);
-    *battery_volt = (float)battery_millivolt / 1000.0; // From millivolt to volt.
+    *battery_mv = battery_millivolt;
 
     LOG_INF("%d mV", battery_millivolt);
     return ret;
 }
 
-int battery_get_percentage(int *battery_percentage, float battery_voltage)
+int battery_get_percentage(int *battery_percentage, int battery_mv)
 {
     // Ensure voltage is within bounds
-    if (battery_voltage > battery_states[0].voltage)
+    if (battery_mv > battery_states[0].millivolt)
+    {
         *battery_percentage = 100;
-    if (battery_voltage < battery_states[BATTERY_STATES_COUNT - 1].voltage)
+        return 0;
+    }
+    if (battery_mv < battery_states[BATTERY_STATES_COUNT - 1].millivolt)
+    {
         *battery_percentage = 0;
+        return 0;
+    }
 
     for (int i = 0; i < BATTERY_STATES_COUNT - 1; i++)
     {
-        // Find the two points battery_voltage is between
-        if (battery_states[i].voltage >= battery_voltage && battery_voltage >= battery_states[i + 1].voltage)
+        // Find the two points battery_mv is between
+        if (battery_states[i].millivolt >= battery_mv && battery_mv >= battery_states[i + 1].millivolt)
         {
-            // Linear interpolation
-            *battery_percentage = battery_states[i].percentage + (
-                (battery_voltage - battery_states[i].voltage) * (
-                    (battery_states[i + 1].percentage - battery_states[i].percentage) / (
-                        battery_states[i + 1].voltage - battery_states[i].voltage
-                    )
-                )
-            );
+            // Linear interpolation, integer only so no soft-float code is linked
+            *battery_percentage = battery_states[i].percentage +
+                (battery_mv - battery_states[i].millivolt) *
+                (battery_states[i + 1].percentage - battery_states[i].percentage) /
+                (battery_states[i + 1].millivolt - battery_states[i].millivolt);
 
             LOG_INF("%d %%", *battery_percentage);
             return 0;
@@ -164,6 +187,35 @@ int battery_get_percentage(int *battery_percentage, float battery_voltage)
     return -ESPIPE;
 }
 
+static struct gpio_callback charge_cb_data;
+static battery_charge_handler_t charge_handler;
+
+static void charge_isr(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    if (charge_handler)
+    {
+        charge_handler();
+    }
+}
+
+int battery_charge_handler_set(battery_charge_handler_t handler)
+{
+    int ret = 0;
+
+    if (!is_initialized)
+    {
+        LOG_ERR("Battery measurement not initialized");
+        return -ECANCELED;
+    }
+
+    charge_handler = handler;
+    gpio_init_callback(&charge_cb_data, charge_isr, BIT(GPIO_BATTERY_CHARGING_ENABLE));
+    ret |= gpio_add_callback(gpio_battery_dev, &charge_cb_data);
+    ret |= gpio_pin_interrupt_configure(gpio_battery_dev, GPIO_BATTERY_CHARGING_ENABLE, GPIO_INT_EDGE_BOTH);
+
+    return ret;
+}
+
 int battery_get_charge_state(int *charge_state)
 {
     *charge_state = gpio_pin_get(gpio_battery_dev, GPIO_BATTERY_CHARGING_ENABLE);
@@ -214,7 +266,6 @@ int battery_init()
     is_initialized = true;
     LOG_INF("Initialized");
 
-    ret |= battery_enable_read();
     ret |= battery_set_fast_charge();
 
     return ret;
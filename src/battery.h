@@ -1,5 +1,10 @@
 #pragma once
 
+#define BATTERY_ADC_SAMPLES_DEFAULT 10 // samples averaged per reading, tunable (params.c)
+#define BATTERY_ADC_SAMPLES_MAX     32
+
+typedef void (*battery_charge_handler_t)(void);
+
 /**
  * @brief Set battery charging to fast charge (100mA).
  *
@@ -17,22 +22,22 @@ int battery_set_slow_charge(void);
 /**
  * @brief Calculates the battery voltage using the ADC.
  *
- * @param[in] battery_volt Pointer where battery voltage is stored.
+ * @param[in] battery_mv Pointer where battery voltage in millivolts is stored.
  *
  * @retval 0 if successful. Negative errno number on error.
  */
-int battery_get_voltage(float *battery_volt);
+int battery_get_millivolt(int *battery_mv);
 
 /**
  * @brief Calculates the battery percentage using the battery voltage.
  *
  * @param[in] battery_percentage  Pointer where battery percentage is stored.
  *
- * @param[in] battery_volt Voltage used to calculate the percentage of how much energy is left in a 3.7V LiPo battery.
+ * @param[in] battery_mv Voltage in millivolts used to calculate the percentage of how much energy is left in a 3.7V LiPo battery.
  *
  * @retval 0 if successful. Negative errno number on error.
  */
-int battery_get_percentage(int *battery_percentage, float battery_volt);
+int battery_get_percentage(int *battery_percentage, int battery_mv);
 
 /**
  * @brief Gets the current charging state
@@ -43,6 +48,15 @@ int battery_get_percentage(int *battery_percentage, float battery_volt);
  */
 int battery_get_charge_state(int *charge_state);
 
+/**
+ * @brief Enable the interrupt on both edges of the charge status pin.
+ *
+ * @param[in] handler Called from the GPIO interrupt when the charge state may have changed.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int battery_charge_handler_set(battery_charge_handler_t handler);
+
 /**
  * @brief Initialize the battery charging circuit.
  *
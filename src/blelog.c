@@ -0,0 +1,328 @@
+#include "blelog.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/logging/log_output.h>
+#include <zephyr/logging/log_output_dict.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME blelog
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_LOG_DICTIONARY_DB)
+
+#define BLELOG_NOTIFY_MAX (CONFIG_BT_L2CAP_TX_MTU - 3)
+
+static struct bt_uuid_128 blelog_service_uuid = BT_UUID_INIT_128(BT_UUID_BLELOG_SERVICE_VAL);
+static struct bt_uuid_128 blelog_data_uuid = BT_UUID_INIT_128(BT_UUID_BLELOG_DATA_VAL);
+
+RING_BUF_DECLARE(blelog_ring, BLELOG_RING_LEN);
+static struct k_spinlock ring_lock;
+
+static uint8_t output_buf[BLELOG_OUTPUT_LEN];
+static uint32_t ring_dropped; // messages dropped since the last dropped record
+
+static atomic_t drain_inflight;
+static struct k_work drain_work;
+static bool subscribed;
+
+static struct blelog_stats blelog_stats;
+
+
+static int ring_out(uint8_t *data, size_t length, void *ctx)
+{
+    ARG_UNUSED(ctx);
+
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+    uint32_t written = ring_buf_put(&blelog_ring, data, length);
+
+    blelog_stats.bytes += written;
+    k_spin_unlock(&ring_lock, key);
+
+    // process() reserved room for the whole message, so this is all of it
+    return written;
+}
+
+LOG_OUTPUT_DEFINE(blelog_output, ring_out, output_buf, sizeof(output_buf));
+
+
+static const struct log_backend *backend_get(void);
+
+
+static void level_set(const struct log_backend *backend, uint32_t level)
+{
+    for (uint32_t source = 0; source < log_src_cnt_get(Z_LOG_LOCAL_DOMAIN_ID); source++) {
+        log_filter_set(backend, Z_LOG_LOCAL_DOMAIN_ID, source, level);
+    }
+}
+
+
+static void process(const struct log_backend *const backend, union log_msg_generic *msg)
+{
+    ARG_UNUSED(backend);
+
+    uint32_t space, need;
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    space = ring_buf_space_get(&blelog_ring);
+    k_spin_unlock(&ring_lock, key);
+
+    // whole messages only, a partial record would desynchronize the decoder. The
+    // stored message is an upper bound of its dictionary record.
+    need = log_msg_get_total_wlen(msg->log.hdr.desc) * sizeof(uint32_t);
+    if (ring_dropped) {
+        need += BLELOG_DROPPED_LEN;
+    }
+    if (space < need) {
+        ring_dropped++;
+        blelog_stats.dropped++;
+        return;
+    }
+    if (ring_dropped) {
+        log_output_dropped_process(&blelog_output, ring_dropped);
+        ring_dropped = 0;
+    }
+
+    log_output_msg_process(&blelog_output, &msg->log, 0);
+    log_output_flush(&blelog_output);
+
+    if (subscribed) {
+        k_work_submit(&drain_work);
+    }
+}
+
+
+static void dropped(const struct log_backend *const backend, uint32_t cnt)
+{
+    ARG_UNUSED(backend);
+
+    // written ahead of the next message, once there is room for both
+    ring_dropped += cnt;
+}
+
+
+static void panic(const struct log_backend *const backend)
+{
+    ARG_UNUSED(backend);
+
+    // nothing drains the ring once the system has panicked, messages stay for the next dump
+}
+
+
+static int format_set(const struct log_backend *const backend, uint32_t log_type)
+{
+    ARG_UNUSED(backend);
+
+    return log_type == LOG_OUTPUT_DICT ? 0 : -ENOTSUP;
+}
+
+
+static const struct log_backend_api blelog_api = {
+    .process = process,
+    .dropped = dropped,
+    .panic = panic,
+    .format_set = format_set,
+};
+
+LOG_BACKEND_DEFINE(blelog_backend, blelog_api, false);
+
+
+static void probe_process(const struct log_backend *const backend, union log_msg_generic *msg)
+{
+    ARG_UNUSED(backend);
+    ARG_UNUSED(msg);
+}
+
+
+/* Takes the place of blelog_backend while blelog_init() times log calls, so
+ * the calls take the same path without leaving records in the ring.
+ */
+static const struct log_backend_api probe_api = {
+    .process = probe_process,
+};
+
+LOG_BACKEND_DEFINE(blelog_probe_backend, probe_api, false);
+
+
+static const struct log_backend *backend_get(void)
+{
+    return &blelog_backend;
+}
+
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+
+    subscribed = (value == BT_GATT_CCC_NOTIFY);
+    level_set(backend_get(), subscribed ? CONFIG_LOG_DEFAULT_LEVEL : LOG_LEVEL_ERR);
+
+    if (subscribed) {
+        k_work_submit(&drain_work);
+    }
+}
+
+
+BT_GATT_SERVICE_DEFINE(blelog_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &blelog_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &blelog_data_uuid.uuid,
+        BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_NONE,
+        NULL, NULL, NULL
+    ),
+    BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+);
+
+
+static void drain_sent(struct bt_conn *conn, void *user_data)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(user_data);
+
+    atomic_dec(&drain_inflight);
+    k_work_submit(&drain_work);
+}
+
+
+static void mtu_min(struct bt_conn *conn, void *data)
+{
+    uint16_t *mtu = data;
+
+    *mtu = MIN(*mtu, bt_gatt_get_mtu(conn));
+}
+
+
+struct drain_chunk {
+    const uint8_t *data;
+    uint16_t len;
+    uint8_t sent;
+};
+
+
+/* One notification per subscriber, so drain_sent runs once per queued
+ * notification and drain_inflight stays balanced with several clients.
+ */
+static void drain_conn(struct bt_conn *conn, void *data)
+{
+    struct drain_chunk *chunk = data;
+    struct bt_gatt_notify_params params = {
+        .attr = &blelog_svc.attrs[2],
+        .data = chunk->data,
+        .len = chunk->len,
+        .func = drain_sent,
+    };
+
+    if (!bt_gatt_is_subscribed(conn, params.attr, BT_GATT_CCC_NOTIFY)) {
+        return;
+    }
+
+    atomic_inc(&drain_inflight);
+    if (bt_gatt_notify_cb(conn, &params)) {
+        atomic_dec(&drain_inflight);
+        return;
+    }
+    chunk->sent++;
+}
+
+
+static void drain_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t buf[BLELOG_NOTIFY_MAX];
+    uint16_t mtu = sizeof(buf) + 3;
+    k_spinlock_key_t key;
+    uint32_t len;
+
+    // notifications go to every subscriber, so the smallest MTU caps them
+    bt_conn_foreach(BT_CONN_TYPE_LE, mtu_min, &mtu);
+
+    while (subscribed && atomic_get(&drain_inflight) < BLELOG_TX_INFLIGHT) {
+        key = k_spin_lock(&ring_lock);
+        len = ring_buf_peek(&blelog_ring, buf, mtu - 3);
+        k_spin_unlock(&ring_lock, key);
+
+        if (!len) {
+            return;
+        }
+
+        struct drain_chunk chunk = {
+            .data = buf,
+            .len = len,
+        };
+
+        bt_conn_foreach(BT_CONN_TYPE_LE, drain_conn, &chunk);
+        if (!chunk.sent) {
+            return; // retried on the next message or subscription
+        }
+
+        key = k_spin_lock(&ring_lock);
+        ring_buf_get(&blelog_ring, NULL, len);
+        k_spin_unlock(&ring_lock, key);
+        blelog_stats.sent += len;
+    }
+}
+
+
+static uint32_t probe_cycles(void)
+{
+    timing_t start, end;
+
+    start = timing_counter_get();
+    for (int i = 0; i < BLELOG_PROBE_CALLS; i++) {
+        LOG_INF("probe %d", i);
+    }
+    end = timing_counter_get();
+
+    return timing_cycles_get(&start, &end) / BLELOG_PROBE_CALLS;
+}
+
+
+void blelog_stats_get(struct blelog_stats *stats)
+{
+    *stats = blelog_stats;
+}
+
+
+int blelog_init(void)
+{
+    k_work_init(&drain_work, drain_work_handler);
+
+    log_backend_enable(&blelog_probe_backend, NULL, LOG_LEVEL_ERR);
+
+    timing_init();
+    timing_start();
+    level_set(&blelog_probe_backend, LOG_LEVEL_ERR);
+    blelog_stats.cycles_filtered = probe_cycles();
+    level_set(&blelog_probe_backend, CONFIG_LOG_DEFAULT_LEVEL);
+    blelog_stats.cycles_recorded = probe_cycles();
+    timing_stop();
+
+    // hand the probe records to the probe backend before the ring is attached
+    while (log_process()) {
+    }
+    log_backend_disable(&blelog_probe_backend);
+
+    log_backend_enable(&blelog_backend, NULL, LOG_LEVEL_ERR);
+    level_set(backend_get(), LOG_LEVEL_ERR);
+
+    LOG_INF("Initialized, log call %u cycles, %u when filtered",
+        blelog_stats.cycles_recorded, blelog_stats.cycles_filtered);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#define BT_UUID_BLELOG_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0300, 0x000000000000)
+#define BT_UUID_BLELOG_DATA_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0301, 0x000000000000)
+
+#define BLELOG_RING_LEN      1024 // dictionary log bytes kept until a client drains them
+#define BLELOG_OUTPUT_LEN    64   // log_output staging buffer, flushed into the ring when full
+#define BLELOG_DROPPED_LEN   8    // space kept for the dropped-messages record
+#define BLELOG_TX_INFLIGHT   2    // notifications queued back-to-back while draining
+#define BLELOG_PROBE_CALLS   4    // log calls timed by blelog_init() at each level
+
+struct blelog_stats {
+    uint32_t bytes;            // dictionary bytes written to the ring
+    uint32_t sent;             // bytes notified to a client
+    uint32_t dropped;          // messages lost because the ring was full
+    uint32_t cycles_filtered;  // CPU cycles per LOG_INF call with no client subscribed
+    uint32_t cycles_recorded;  // CPU cycles per LOG_INF call with a client subscribed
+};
+
+#if defined(CONFIG_LOG_DICTIONARY_DB)
+
+/**
+ * @brief Start the BLE log backend and measure the cost of a log call.
+ *
+ * Until a client subscribes to the log characteristic only errors are
+ * recorded, every other level is filtered at the call site.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int blelog_init(void);
+
+/**
+ * @brief Gets the backend statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void blelog_stats_get(struct blelog_stats *stats);
+
+#else
+
+static inline int blelog_init(void)
+{
+    return 0;
+}
+
+static inline void blelog_stats_get(struct blelog_stats *stats)
+{
+    *stats = (struct blelog_stats){ 0 };
+}
+
+#endif
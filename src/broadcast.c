@@ -0,0 +1,112 @@
+#include "broadcast.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <stddef.h>
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME broadcast
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_BT_PER_ADV)
+
+static const struct bt_data ext_ad[] = {
+    BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_BROADCAST_SERVICE_VAL),
+};
+
+static struct bt_le_ext_adv *adv;
+static struct broadcast_payload payload;
+static uint16_t seq;
+
+static struct broadcast_stats broadcast_stats;
+
+
+static int payload_update(void)
+{
+    struct bt_data per_ad = BT_DATA(BT_DATA_MANUFACTURER_DATA, (uint8_t *)&payload,
+        offsetof(struct broadcast_payload, events) + payload.count * sizeof(struct broadcast_event));
+
+    return bt_le_per_adv_set_data(adv, &per_ad, 1);
+}
+
+
+void broadcast_key_changed(uint8_t button_mask)
+{
+    int err;
+
+    if (!adv) {
+        return;
+    }
+
+    // newest first, the oldest event falls out of the window
+    memmove(&payload.events[1], &payload.events[0], (BROADCAST_WINDOW - 1) * sizeof(payload.events[0]));
+    payload.events[0].seq = sys_cpu_to_le16(++seq);
+    payload.events[0].button_mask = button_mask;
+    payload.count = MIN(payload.count + 1, BROADCAST_WINDOW);
+
+    err = payload_update();
+    if (err) {
+        broadcast_stats.failed++;
+        LOG_WRN("Broadcast update failed (err %d)\n", err);
+        return;
+    }
+    broadcast_stats.events++;
+}
+
+
+void broadcast_stats_get(struct broadcast_stats *stats)
+{
+    *stats = broadcast_stats;
+}
+
+
+int broadcast_init(void)
+{
+    int err;
+
+    payload.company = sys_cpu_to_le16(BROADCAST_COMPANY_ID);
+    payload.version = BROADCAST_VERSION;
+
+    err = bt_le_ext_adv_create(BT_LE_EXT_ADV_NCONN, NULL, &adv);
+    if (err) {
+        LOG_ERR("Advertising set create failed (err %d)", err);
+        return err;
+    }
+
+    err = bt_le_ext_adv_set_data(adv, ext_ad, ARRAY_SIZE(ext_ad), NULL, 0);
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_per_adv_set_param(adv, BT_LE_PER_ADV_PARAM(BROADCAST_INT, BROADCAST_INT, BT_LE_PER_ADV_OPT_NONE));
+    if (err) {
+        LOG_ERR("Periodic advertising parameters failed (err %d)", err);
+        return err;
+    }
+
+    err = payload_update();
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_per_adv_start(adv);
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_DEFAULT);
+    if (err) {
+        LOG_ERR("Advertising set start failed (err %d)", err);
+        return err;
+    }
+
+    LOG_INF("Initialized");
+    return 0;
+}
+
+#endif
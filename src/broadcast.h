@@ -0,0 +1,73 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <zephyr/toolchain.h>
+
+#define BT_UUID_BROADCAST_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0600, 0x000000000000)
+
+#define BROADCAST_INT          8       // periodic advertising interval, 1.25 ms units (10 ms)
+#define BROADCAST_WINDOW       8       // latest events repeated in every packet
+#define BROADCAST_COMPANY_ID   0xffff  // no company, manufacturer data for testing only
+#define BROADCAST_VERSION      1
+
+/* Periodic advertising manufacturer data, little endian. Every packet
+ * carries the last BROADCAST_WINDOW key events, newest first, so a
+ * receiver that misses packets recovers the events from the next one
+ * it hears. Only a gap longer than the window loses events.
+ */
+struct __packed broadcast_event {
+    uint16_t seq;          // increments by one per event, wraps
+    uint8_t button_mask;   // button state after the event
+};
+
+struct __packed broadcast_payload {
+    uint16_t company;      // BROADCAST_COMPANY_ID
+    uint8_t version;
+    uint8_t count;         // valid entries in events
+    struct broadcast_event events[BROADCAST_WINDOW];
+};
+
+struct broadcast_stats {
+    uint32_t events;       // key events broadcast
+    uint32_t failed;       // periodic advertising data updates that failed
+};
+
+#if defined(CONFIG_BT_PER_ADV)
+
+/**
+ * @brief Start the broadcast advertising set alongside the connectable one.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int broadcast_init(void);
+
+/**
+ * @brief Put a key event into the broadcast.
+ */
+void broadcast_key_changed(uint8_t button_mask);
+
+/**
+ * @brief Gets the broadcast counters.
+ *
+ * @param[out] stats Pointer where the counters are stored.
+ */
+void broadcast_stats_get(struct broadcast_stats *stats);
+
+#else
+
+static inline int broadcast_init(void)
+{
+    return 0;
+}
+
+static inline void broadcast_key_changed(uint8_t button_mask)
+{
+}
+
+static inline void broadcast_stats_get(struct broadcast_stats *stats)
+{
+    *stats = (struct broadcast_stats){ 0 };
+}
+
+#endif
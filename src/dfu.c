@@ -0,0 +1,232 @@
+#include "dfu.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME dfu
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_MCUMGR_TRANSPORT_BT)
+
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/mgmt/mcumgr/mgmt/callbacks.h>
+#include <zephyr/mgmt/mcumgr/grp/img_mgmt/img_mgmt.h>
+
+static struct dfu_upload {
+    bool active;
+    uint32_t size;      // total image size announced in the first chunk
+    uint32_t received;  // offset after the last accepted chunk
+    int64_t started;
+} upload;
+
+static struct dfu_stats dfu_stats;
+static struct dfu_conn_ctx {
+    struct bt_conn *conn;
+    struct k_work_delayable dle_work;
+} dfu_conn_ctx[CONFIG_BT_MAX_CONN];
+
+
+static void conn_fast_params(struct bt_conn *conn, void *data)
+{
+    ARG_UNUSED(data);
+
+    int err = bt_conn_le_param_update(conn, BT_LE_CONN_PARAM(DFU_INT_MIN, DFU_INT_MAX, 0, DFU_SUP_TIMEOUT));
+
+    if (err) {
+        LOG_WRN("Connection parameter update failed (err %d)\n", err);
+    }
+}
+
+
+static void conn_data_len_max(struct bt_conn *conn, void *data)
+{
+    ARG_UNUSED(data);
+
+    int err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+
+    if (err && err != -EALREADY) {
+        LOG_WRN("Data length update failed (err %d)\n", err);
+    }
+}
+
+
+static void upload_start(uint32_t size)
+{
+    upload.active = true;
+    upload.size = size;
+    upload.received = 0;
+    upload.started = k_uptime_get();
+
+    // the host may have connected before the longest data length was in place
+    bt_conn_foreach(BT_CONN_TYPE_LE, conn_data_len_max, NULL);
+    bt_conn_foreach(BT_CONN_TYPE_LE, conn_fast_params, NULL);
+
+    LOG_INF("Upload started, %u bytes\n", size);
+}
+
+
+static void upload_end(bool complete)
+{
+    uint32_t elapsed_ms;
+
+    if (!upload.active) {
+        return;
+    }
+    upload.active = false;
+
+    if (!complete) {
+        dfu_stats.aborted++;
+        LOG_WRN("Upload stopped at %u of %u bytes\n", upload.received, upload.size);
+        return;
+    }
+
+    elapsed_ms = MAX((uint32_t)(k_uptime_get() - upload.started), 1);
+
+    dfu_stats.uploads++;
+    dfu_stats.last_size = upload.received;
+    dfu_stats.last_duration_ms = elapsed_ms;
+    dfu_stats.last_bps = (uint32_t)((uint64_t)upload.received * MSEC_PER_SEC / elapsed_ms);
+
+    LOG_INF("Upload complete, %u bytes in %u ms (%u B/s)\n",
+        upload.received, elapsed_ms, dfu_stats.last_bps);
+}
+
+
+static enum mgmt_cb_return img_mgmt_event(uint32_t event, enum mgmt_cb_return prev_status,
+                                          int32_t *rc, uint16_t *group, bool *abort_more,
+                                          void *data, size_t data_size)
+{
+    ARG_UNUSED(prev_status);
+    ARG_UNUSED(rc);
+    ARG_UNUSED(group);
+    ARG_UNUSED(abort_more);
+
+    switch (event) {
+    case MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK: {
+        const struct img_mgmt_upload_check *check = data;
+
+        if (data_size != sizeof(*check)) {
+            break;
+        }
+        if (check->req->off == 0) {
+            upload_start(check->action->size);
+        }
+        upload.received = check->req->off + check->req->img_data.len;
+        break;
+    }
+
+    case MGMT_EVT_OP_IMG_MGMT_DFU_PENDING:
+        upload_end(true);
+        break;
+
+    case MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED:
+        upload_end(false);
+        break;
+
+    default:
+        break;
+    }
+
+    return MGMT_CB_OK;
+}
+
+
+static struct mgmt_callback img_mgmt_callback = {
+    .callback = img_mgmt_event,
+    .event_id = MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK |
+                MGMT_EVT_OP_IMG_MGMT_DFU_PENDING |
+                MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED,
+};
+
+
+static void dle_request(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct dfu_conn_ctx *ctx = CONTAINER_OF(dwork, struct dfu_conn_ctx, dle_work);
+
+    if (ctx->conn) {
+        conn_data_len_max(ctx->conn, NULL);
+    }
+}
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    struct dfu_conn_ctx *ctx = &dfu_conn_ctx[bt_conn_index(conn)];
+
+    if (err) {
+        return;
+    }
+
+    ctx->conn = conn;
+    k_work_reschedule(&ctx->dle_work, K_MSEC(DFU_DLE_DELAY_MS));
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    ARG_UNUSED(reason);
+
+    struct dfu_conn_ctx *ctx = &dfu_conn_ctx[bt_conn_index(conn)];
+
+    ctx->conn = NULL;
+    k_work_cancel_delayable(&ctx->dle_work);
+}
+
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    ARG_UNUSED(conn);
+
+    LOG_INF("Data length tx %u B/%u us, rx %u B/%u us\n",
+        info->tx_max_len, info->tx_max_time, info->rx_max_len, info->rx_max_time);
+}
+
+
+BT_CONN_CB_DEFINE(dfu_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_data_len_updated = le_data_len_updated,
+};
+
+
+bool dfu_in_progress(void)
+{
+    return upload.active;
+}
+
+
+void dfu_stats_get(struct dfu_stats *stats)
+{
+    *stats = dfu_stats;
+}
+
+
+int dfu_init(void)
+{
+    int err;
+
+    for (size_t i = 0; i < ARRAY_SIZE(dfu_conn_ctx); i++) {
+        k_work_init_delayable(&dfu_conn_ctx[i].dle_work, dle_request);
+    }
+
+    mgmt_callback_register(&img_mgmt_callback);
+
+    if (!boot_is_img_confirmed()) {
+        err = boot_write_img_confirmed();
+        if (err) {
+            LOG_ERR("Image confirm failed (err %d)", err);
+            return err;
+        }
+        LOG_INF("Running image confirmed");
+    }
+
+    LOG_INF("Initialized");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#define DFU_DLE_DELAY_MS  1000  // request the longest data length once the link has settled
+
+/* Connection parameters held while an upload is running, in 1.25 ms units.
+ * Short enough for throughput, and HID reports share the same events so
+ * clicks are never queued behind the transfer.
+ */
+#define DFU_INT_MIN       6
+#define DFU_INT_MAX       12
+#define DFU_SUP_TIMEOUT   400
+
+struct dfu_stats {
+    uint32_t uploads;           // uploads that reached the end of the image
+    uint32_t aborted;           // uploads stopped before the end of the image
+    uint32_t last_size;         // bytes in the last completed upload
+    uint32_t last_duration_ms;  // first to last chunk of the last completed upload
+    uint32_t last_bps;          // throughput of the last completed upload in bytes/s
+};
+
+#if defined(CONFIG_MCUMGR_TRANSPORT_BT)
+
+/**
+ * @brief Initialize the SMP DFU hooks and confirm the running image.
+ *
+ * Call once Bluetooth is up and the HID service is advertising, so a
+ * test image that cannot reach that point is reverted by MCUboot.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int dfu_init(void);
+
+/**
+ * @brief Check if an image upload is in progress.
+ */
+bool dfu_in_progress(void);
+
+/**
+ * @brief Gets the upload statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void dfu_stats_get(struct dfu_stats *stats);
+
+#else
+
+static inline int dfu_init(void)
+{
+    return 0;
+}
+
+static inline bool dfu_in_progress(void)
+{
+    return false;
+}
+
+static inline void dfu_stats_get(struct dfu_stats *stats)
+{
+    *stats = (struct dfu_stats){ 0 };
+}
+
+#endif
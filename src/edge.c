@@ -0,0 +1,227 @@
+#include "edge.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME edge
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_APP_BUTTON_TIMESTAMPS)
+
+#include <nrfx_gpiote.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_timer.h>
+
+#define EDGE_TIMER        NRF_TIMER3   // not used by the SoftDevice Controller or MPSL
+#define EDGE_PRESCALER    4            // 16 MHz / 2^4 = 1 MHz
+#define EDGE_CC_LAST(b)   (b)
+#define EDGE_CC_FIRST(b)  (EDGE_BUTTONS + (b))
+#define EDGE_CC_NOW       5
+#define EDGE_NONE         UINT32_MAX   // no edge captured since the register was armed
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(0);
+
+static nrfx_gppi_channel_group_t first_group;
+static uint32_t last_channels;  // capture the latest edge and start the timer
+static struct k_spinlock lock;
+static bool routed;       // the capture channels are set up
+static bool running;      // edges are routed to the timer
+static uint32_t press_us = EDGE_NONE; // first edge to settle of the press not yet reported
+static uint32_t settle_cycles;
+
+static struct edge_stats edge_stats;
+static uint64_t latency_sum_us;
+
+
+static uint32_t now_get(void)
+{
+    nrf_timer_task_trigger(EDGE_TIMER, nrf_timer_capture_task_get(EDGE_CC_NOW));
+    return nrf_timer_cc_get(EDGE_TIMER, EDGE_CC_NOW);
+}
+
+
+static void first_arm(void)
+{
+    for (int b = 0; b < EDGE_BUTTONS; b++) {
+        nrf_timer_cc_set(EDGE_TIMER, EDGE_CC_FIRST(b), EDGE_NONE);
+    }
+    nrfx_gppi_group_enable(first_group);
+}
+
+
+/* Stop and clear the timer until the next edge starts it again. The timer
+ * holds the high-frequency clock while it counts, so it only counts from
+ * the first edge of a press until debouncing settles. An edge that comes
+ * in while this runs loses its capture; debouncing then falls back to the
+ * interrupt time for that press.
+ */
+static void timer_idle(void)
+{
+    nrf_timer_task_trigger(EDGE_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(EDGE_TIMER, NRF_TIMER_TASK_CLEAR);
+    for (int b = 0; b < EDGE_BUTTONS; b++) {
+        nrf_timer_cc_set(EDGE_TIMER, EDGE_CC_LAST(b), EDGE_NONE);
+    }
+    first_arm();
+}
+
+
+int edge_quiet_us(uint32_t *quiet_us)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t now, edge;
+    int err = -EAGAIN;
+
+    if (running) {
+        now = now_get();
+        for (int b = 0; b < EDGE_BUTTONS; b++) {
+            edge = nrf_timer_cc_get(EDGE_TIMER, EDGE_CC_LAST(b));
+            if (edge == EDGE_NONE) {
+                continue;
+            }
+            // unsigned difference, correct across the 71 minute wrap
+            *quiet_us = err ? now - edge : MIN(*quiet_us, now - edge);
+            err = 0;
+        }
+    }
+
+    k_spin_unlock(&lock, key);
+    return err;
+}
+
+
+void edge_settle(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t now, edge, first = EDGE_NONE;
+
+    if (running) {
+        now = now_get();
+        for (int b = 0; b < EDGE_BUTTONS; b++) {
+            edge = nrf_timer_cc_get(EDGE_TIMER, EDGE_CC_FIRST(b));
+            if (edge != EDGE_NONE && (first == EDGE_NONE || now - edge > now - first)) {
+                first = edge;
+            }
+        }
+        // the rest of the way to the report is timed on the system clock
+        press_us = first == EDGE_NONE ? EDGE_NONE : now - first;
+        settle_cycles = k_cycle_get_32();
+        timer_idle();
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+
+void edge_latency_record(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t latency_us;
+
+    if (!running || press_us == EDGE_NONE) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    latency_us = press_us + k_cyc_to_us_floor32(k_cycle_get_32() - settle_cycles);
+    press_us = EDGE_NONE;
+
+    edge_stats.count++;
+    edge_stats.last_us = latency_us;
+    if (edge_stats.count == 1 || latency_us < edge_stats.min_us) {
+        edge_stats.min_us = latency_us;
+    }
+    edge_stats.max_us = MAX(edge_stats.max_us, latency_us);
+    latency_sum_us += latency_us;
+    edge_stats.avg_us = latency_sum_us / edge_stats.count;
+
+    k_spin_unlock(&lock, key);
+
+    LOG_DBG("Edge to report %u us", latency_us);
+}
+
+
+void edge_stats_get(struct edge_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *stats = edge_stats;
+
+    k_spin_unlock(&lock, key);
+}
+
+
+void edge_enable(bool enable)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (!routed || enable == running) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    if (enable) {
+        timer_idle();
+        press_us = EDGE_NONE;
+        nrfx_gppi_channels_enable(last_channels);
+    } else {
+        nrfx_gppi_channels_disable(last_channels);
+        nrfx_gppi_group_disable(first_group);
+        nrf_timer_task_trigger(EDGE_TIMER, NRF_TIMER_TASK_STOP);
+    }
+    running = enable;
+
+    k_spin_unlock(&lock, key);
+}
+
+
+int edge_init(const uint32_t psel[EDGE_BUTTONS])
+{
+    uint8_t last_ch, first_ch, gpiote_ch;
+    uint32_t eep;
+
+    nrf_timer_mode_set(EDGE_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(EDGE_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_prescaler_set(EDGE_TIMER, EDGE_PRESCALER);
+
+    if (nrfx_gppi_group_alloc(&first_group) != NRFX_SUCCESS) {
+        LOG_ERR("No free (D)PPI channel group");
+        return -ENOMEM;
+    }
+
+    for (int b = 0; b < EDGE_BUTTONS; b++) {
+        // the GPIO driver took a GPIOTE channel for the edge interrupt
+        if (nrfx_gpiote_channel_get(&gpiote, psel[b], &gpiote_ch) != NRFX_SUCCESS) {
+            LOG_ERR("Pin %u has no GPIOTE channel", psel[b]);
+            return -ENODEV;
+        }
+        eep = nrfx_gpiote_in_event_address_get(&gpiote, psel[b]);
+
+        if (nrfx_gppi_channel_alloc(&last_ch) != NRFX_SUCCESS ||
+            nrfx_gppi_channel_alloc(&first_ch) != NRFX_SUCCESS) {
+            LOG_ERR("No free (D)PPI channel");
+            return -ENOMEM;
+        }
+
+        // every edge captures the latest time and starts the timer, a no-op while it runs;
+        // stopped and cleared between presses, the first edge of a press captures 0
+        nrfx_gppi_channel_endpoints_setup(last_ch, eep,
+            nrf_timer_task_address_get(EDGE_TIMER, nrf_timer_capture_task_get(EDGE_CC_LAST(b))));
+        nrfx_gppi_fork_endpoint_setup(last_ch, nrf_timer_task_address_get(EDGE_TIMER, NRF_TIMER_TASK_START));
+        last_channels |= BIT(last_ch);
+
+        // the first edge of a press captures once, then the channel disables itself
+        nrfx_gppi_channel_endpoints_setup(first_ch, eep,
+            nrf_timer_task_address_get(EDGE_TIMER, nrf_timer_capture_task_get(EDGE_CC_FIRST(b))));
+        nrfx_gppi_fork_endpoint_setup(first_ch, nrfx_gppi_group_disable_task_address(first_group));
+        nrfx_gppi_channels_include_in_group(BIT(first_ch), first_group);
+    }
+
+    routed = true;
+
+    LOG_INF("Initialized");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <errno.h>
+
+#define EDGE_BUTTONS 2
+
+/* Button edge times captured in hardware. Every GPIOTE edge event of a
+ * button is routed through (D)PPI to a capture task of a 1 MHz TIMER, so
+ * the time is exact regardless of when the GPIO interrupt or the workqueue
+ * gets to run. Per button one capture register holds the latest edge and
+ * one holds the first edge of a press; the channel of the latter disables
+ * itself through a channel group right after capturing.
+ *
+ * The same edge event starts the TIMER and edge_settle() stops it, so the
+ * TIMER and the high-frequency clock only run from the first edge of a
+ * press until debouncing settles. The time from there to the report is
+ * taken from the system clock.
+ */
+
+struct edge_stats {
+    uint32_t count;       // changes reported with a hardware edge time
+    uint32_t last_us;     // first edge to report queued
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t avg_us;
+};
+
+#if defined(CONFIG_APP_BUTTON_TIMESTAMPS)
+
+/**
+ * @brief Route the GPIOTE events of the buttons to the capture timer.
+ *        Call after the edge interrupts have been configured.
+ *
+ * @param[in] psel Absolute pin numbers of the buttons.
+ *
+ * @retval 0 if successful. -ENODEV if a pin has no GPIOTE channel.
+ */
+int edge_init(const uint32_t psel[EDGE_BUTTONS]);
+
+/**
+ * @brief Route the button edges to the capture timer, or take them off it
+ *        while the device sleeps and a press wakes it first.
+ */
+void edge_enable(bool enable);
+
+/**
+ * @brief Gets the time since the latest edge of any button.
+ *
+ * @param[out] quiet_us Time in microseconds.
+ *
+ * @retval 0 if successful. -EAGAIN while the timer is stopped or before any edge.
+ */
+int edge_quiet_us(uint32_t *quiet_us);
+
+/**
+ * @brief Take the first edge time of the settled press, stop the capture
+ *        timer and arm it for the next press. Call when debouncing completes.
+ */
+void edge_settle(void);
+
+/**
+ * @brief Record the time from the first edge of the settled press until now.
+ */
+void edge_latency_record(void);
+
+/**
+ * @brief Gets the edge to report statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void edge_stats_get(struct edge_stats *stats);
+
+#else
+
+static inline int edge_init(const uint32_t psel[EDGE_BUTTONS])
+{
+    return -ENOTSUP;
+}
+
+static inline void edge_enable(bool enable)
+{
+}
+
+static inline int edge_quiet_us(uint32_t *quiet_us)
+{
+    return -ENOTSUP;
+}
+
+static inline void edge_settle(void)
+{
+}
+
+static inline void edge_latency_record(void)
+{
+}
+
+static inline void edge_stats_get(struct edge_stats *stats)
+{
+    *stats = (struct edge_stats){ 0 };
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "governor.h"
+#include "gpio.h"
+#include "hid.h"
+#include "history.h"
+#include "periodic.h"
+#include "wake.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/poweroff.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME governor
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define GOVERNOR_HYSTERESIS_PCT CONFIG_APP_GOVERNOR_HYSTERESIS_PCT
+
+BUILD_ASSERT(CONFIG_APP_GOVERNOR_SAVER_PCT > CONFIG_APP_GOVERNOR_LOW_PCT &&
+             CONFIG_APP_GOVERNOR_LOW_PCT > CONFIG_APP_GOVERNOR_OFF_PCT,
+             "Governor tiers must be in descending battery order");
+
+/* Battery level at or below which each tier is entered */
+static const uint8_t tier_pct[GOVERNOR_TIER_COUNT] = {
+    [GOVERNOR_TIER_NORMAL] = 100,
+    [GOVERNOR_TIER_SAVER]  = CONFIG_APP_GOVERNOR_SAVER_PCT,
+    [GOVERNOR_TIER_LOW]    = CONFIG_APP_GOVERNOR_LOW_PCT,
+    [GOVERNOR_TIER_OFF]    = CONFIG_APP_GOVERNOR_OFF_PCT,
+};
+
+static const struct governor_policy governor_policy[GOVERNOR_TIER_COUNT] = {
+    [GOVERNOR_TIER_NORMAL] = {
+        .adv_fast = true, .led = true, .telemetry = true, .beacon = true, .blink_period_ms = 500,
+        .conn_fast_int_min = WAKE_FAST_INT_MIN, .conn_fast_int_max = WAKE_FAST_INT_MAX,
+        .conn_idle_int_min = WAKE_IDLE_INT_MIN, .conn_idle_int_max = WAKE_IDLE_INT_MAX,
+        .battery_interval_mul = 1,
+    },
+    [GOVERNOR_TIER_SAVER] = {
+        .adv_fast = false, .led = true, .telemetry = false, .beacon = true, .blink_period_ms = 2000,
+        .conn_fast_int_min = 12, .conn_fast_int_max = 24,
+        .conn_idle_int_min = 160, .conn_idle_int_max = 200,
+        .battery_interval_mul = 2,
+    },
+    [GOVERNOR_TIER_LOW] = {
+        .adv_fast = false, .led = false, .telemetry = false, .beacon = false, .blink_period_ms = 0,
+        .conn_fast_int_min = 24, .conn_fast_int_max = 36,
+        .conn_idle_int_min = 320, .conn_idle_int_max = 400,
+        .battery_interval_mul = 3,
+    },
+    [GOVERNOR_TIER_OFF] = {
+        .adv_fast = false, .led = false, .telemetry = false, .beacon = false, .blink_period_ms = 0,
+        .conn_fast_int_min = 24, .conn_fast_int_max = 36,
+        .conn_idle_int_min = 320, .conn_idle_int_max = 400,
+        .battery_interval_mul = 1,
+    },
+};
+
+static const char *const tier_names[GOVERNOR_TIER_COUNT] = {
+    [GOVERNOR_TIER_NORMAL] = "normal",
+    [GOVERNOR_TIER_SAVER] = "saver",
+    [GOVERNOR_TIER_LOW] = "low",
+    [GOVERNOR_TIER_OFF] = "off",
+};
+
+static enum governor_tier tier = GOVERNOR_TIER_NORMAL;
+static governor_tier_changed_t tier_changed_cb;
+
+static struct periodic_job warning_job;
+static int64_t off_at;
+
+static int64_t sample_at;  // 0 until the first discharging sample
+static int sample_pct;
+static uint64_t residency_ms[GOVERNOR_TIER_COUNT];
+static struct governor_stats governor_stats;
+
+
+static void poweroff(void)
+{
+    int err;
+
+    periodic_stop(&warning_job);
+    gpio_status_led_off();
+
+    // System OFF keeps only the GPIO sense logic and VBUS detection, both wake with a reset
+    err = gpio_wake_enable();
+    if (err) {
+        LOG_ERR("Button wake-up enable failed (err %d), staying on", err);
+        return;
+    }
+
+    // the samples still in RAM are the ones that show the battery running out
+    history_flush();
+
+    err = hid_shutdown(K_MSEC(GOVERNOR_DISCONNECT_TIMEOUT_MS));
+    if (err) {
+        LOG_WRN("Links still up at System OFF (err %d)", err);
+    }
+
+    LOG_WRN("Battery empty, System OFF");
+    LOG_PANIC();
+    sys_poweroff();
+}
+
+
+static void warning_blink(void)
+{
+    if (k_uptime_get() >= off_at) {
+        poweroff();
+        return;
+    }
+    gpio_status_led_toggle();
+}
+
+
+static enum governor_tier tier_next(int percentage, bool powered)
+{
+    enum governor_tier next = tier;
+
+    // down to the deepest tier whose level is reached
+    while (next + 1 < GOVERNOR_TIER_COUNT && percentage <= tier_pct[next + 1]) {
+        next++;
+    }
+    // up only once the level is clear of the tier by the hysteresis
+    while (next > GOVERNOR_TIER_NORMAL && percentage >= tier_pct[next] + GOVERNOR_HYSTERESIS_PCT) {
+        next--;
+    }
+
+    if (powered && next == GOVERNOR_TIER_OFF) {
+        next = GOVERNOR_TIER_OFF - 1;
+    }
+    return next;
+}
+
+
+static void stats_account(int64_t now, int percentage, bool powered)
+{
+    if (powered) {
+        sample_at = 0; // charging time and charge gained are not runtime
+        return;
+    }
+
+    if (sample_at) {
+        residency_ms[tier] += now - sample_at;
+        if (sample_pct > percentage) {
+            governor_stats.pct_used[tier] += sample_pct - percentage;
+        }
+    }
+    sample_at = now;
+    sample_pct = percentage;
+}
+
+
+void governor_stats_get(struct governor_stats *stats)
+{
+    uint32_t normal_s_per_pct = 0;
+
+    for (int i = 0; i < GOVERNOR_TIER_COUNT; i++) {
+        governor_stats.residency_s[i] = residency_ms[i] / MSEC_PER_SEC;
+    }
+
+    // what the same consumption would have lasted at the normal tier's rate
+    if (governor_stats.pct_used[GOVERNOR_TIER_NORMAL]) {
+        normal_s_per_pct = governor_stats.residency_s[GOVERNOR_TIER_NORMAL] /
+                           governor_stats.pct_used[GOVERNOR_TIER_NORMAL];
+    }
+    for (int i = GOVERNOR_TIER_NORMAL + 1; i < GOVERNOR_TIER_COUNT; i++) {
+        governor_stats.gained_s[i] = normal_s_per_pct ?
+            (int32_t)(governor_stats.residency_s[i] - governor_stats.pct_used[i] * normal_s_per_pct) : 0;
+    }
+
+    *stats = governor_stats;
+}
+
+
+void governor_battery_update(int percentage, bool powered)
+{
+    struct governor_stats stats;
+    enum governor_tier next;
+    int64_t now = k_uptime_get();
+
+    stats_account(now, percentage, powered);
+
+    next = tier_next(percentage, powered);
+    if (next == tier) {
+        return;
+    }
+
+    governor_stats_get(&stats);
+    LOG_INF("%s -> %s at %d%%, %u s for %u%% in %s, %d s gained", tier_names[tier], tier_names[next],
+            percentage, stats.residency_s[tier], stats.pct_used[tier], tier_names[tier], stats.gained_s[tier]);
+
+    if (tier == GOVERNOR_TIER_OFF) {
+        periodic_stop(&warning_job);
+        gpio_status_led_off();
+        LOG_INF("System OFF aborted");
+    }
+
+    tier = next;
+    wake_params_refresh();
+    if (tier_changed_cb) {
+        tier_changed_cb(tier);
+    }
+
+    if (tier == GOVERNOR_TIER_OFF) {
+        // the LED belongs to the warning until power is back or the device is off
+        off_at = now + GOVERNOR_OFF_WARNING_MS;
+        periodic_start(&warning_job, 0, GOVERNOR_WARNING_BLINK_MS);
+        LOG_WRN("Battery at %d%%, System OFF in %u s", percentage, GOVERNOR_OFF_WARNING_MS / MSEC_PER_SEC);
+    }
+}
+
+
+enum governor_tier governor_tier_get(void)
+{
+    return tier;
+}
+
+
+const struct governor_policy *governor_policy_get(void)
+{
+    return &governor_policy[tier];
+}
+
+
+int governor_init(governor_tier_changed_t cb)
+{
+    tier_changed_cb = cb;
+    periodic_job_init(&warning_job, warning_blink, 0);
+
+    LOG_INF("Initialized (saver %u%%, low %u%%, off %u%%)", tier_pct[GOVERNOR_TIER_SAVER],
+            tier_pct[GOVERNOR_TIER_LOW], tier_pct[GOVERNOR_TIER_OFF]);
+    return 0;
+}
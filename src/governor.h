@@ -0,0 +1,74 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define GOVERNOR_OFF_WARNING_MS  30000  // final warning before System OFF, aborted by charging
+#define GOVERNOR_WARNING_BLINK_MS 100   // fast LED flashing during the final warning
+#define GOVERNOR_DISCONNECT_TIMEOUT_MS 2000 // links taken down before System OFF, a few idle intervals
+
+enum governor_tier {
+    GOVERNOR_TIER_NORMAL = 0,
+    GOVERNOR_TIER_SAVER,
+    GOVERNOR_TIER_LOW,
+    GOVERNOR_TIER_OFF,       // final warning, then System OFF
+    GOVERNOR_TIER_COUNT
+};
+
+/* What each tier allows. Connection intervals are in 1.25 ms units. */
+struct governor_policy {
+    bool adv_fast;               // start advertising at the fast interval
+    bool led;                    // press feedback and charge indication on the status LED
+    bool telemetry;              // resource log at the end of every session
+    bool beacon;                 // storage beacon once the slow advertising window has ended
+    uint16_t blink_period_ms;    // advertising blink, 0 keeps the LED dark; tunable at the normal tier
+    uint16_t conn_fast_int_min;  // connection interval while in use
+    uint16_t conn_fast_int_max;
+    uint16_t conn_idle_int_min;  // connection interval after the idle timeout
+    uint16_t conn_idle_int_max;
+    uint8_t battery_interval_mul; // battery sampling interval multiplier
+};
+
+struct governor_stats {
+    uint32_t residency_s[GOVERNOR_TIER_COUNT]; // discharging time spent in each tier
+    uint16_t pct_used[GOVERNOR_TIER_COUNT];    // battery percent consumed in each tier
+    int32_t gained_s[GOVERNOR_TIER_COUNT];     // runtime beyond the normal tier's discharge rate
+};
+
+typedef void (*governor_tier_changed_t)(enum governor_tier tier);
+
+/**
+ * @brief Initialize the battery-aware performance governor.
+ *
+ * @param[in] cb Called from the application event loop after every tier change.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int governor_init(governor_tier_changed_t cb);
+
+/**
+ * @brief Feed a battery sample into the governor.
+ *
+ * The final warning is never entered while powered, and charging or VBUS
+ * during the warning aborts it.
+ *
+ * @param[in] percentage Battery level in percent.
+ * @param[in] powered True while charging or VBUS is present.
+ */
+void governor_battery_update(int percentage, bool powered);
+
+/**
+ * @brief Gets the current tier.
+ */
+enum governor_tier governor_tier_get(void);
+
+/**
+ * @brief Gets the policy of the current tier.
+ */
+const struct governor_policy *governor_policy_get(void);
+
+/**
+ * @brief Gets the per-tier residency, consumption and runtime gained.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void governor_stats_get(struct governor_stats *stats);
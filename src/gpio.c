@@ -1,7 +1,12 @@
 #include "gpio.h"
+#include "params.h"
+#include "edge.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
+#if defined(CONFIG_APP_BUTTON_TIMESTAMPS)
+#include <soc.h>
+#endif
 
 #include <zephyr/logging/log.h>
 #define LOG_MODULE_NAME gpio
@@ -33,6 +38,7 @@ static struct gpio_callback sw0_cb_data;
 static struct gpio_callback sw1_cb_data;
 
 static button_event_handler_t button_cb;
+static button_contact_handler_t contact_cb;
 
 static struct k_work_delayable debounce_work;
 static struct k_work_delayable longpress_work;
@@ -42,7 +48,16 @@ static void debounce_expired(struct k_work *work)
 {
     ARG_UNUSED(work);
 
+    uint32_t debounce_us = params_get()->debounce_ms * USEC_PER_MSEC;
+    uint32_t quiet_us;
     uint8_t btn_mask = 0;
+
+    // the work may run late, or an edge may have slipped in after it was scheduled
+    if (!edge_quiet_us(&quiet_us) && quiet_us < debounce_us) {
+        k_work_reschedule(&debounce_work, K_USEC(debounce_us - quiet_us));
+        return;
+    }
+    edge_settle();
     
     if (gpio_pin_get_dt(&sw0)) {
         btn_mask |= 0b001;
@@ -52,7 +67,7 @@ static void debounce_expired(struct k_work *work)
     }
 
     if (btn_mask == 0b011) {
-        k_work_reschedule(&longpress_work, K_MSEC(GPIO_SW_LONGPRESS_MS));
+        k_work_reschedule(&longpress_work, K_MSEC(params_get()->longpress_ms));
     }
 
     if (button_cb) {
@@ -78,7 +93,16 @@ static void longpress_expired(struct k_work *work)
 
 void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    k_work_reschedule(&debounce_work, K_MSEC(GPIO_SW_DEBOUNCE_MS));
+    if (contact_cb && !k_work_delayable_is_pending(&debounce_work)) {
+        contact_cb();
+    }
+    k_work_reschedule(&debounce_work, K_MSEC(params_get()->debounce_ms));
+}
+
+
+void gpio_contact_handler_set(button_contact_handler_t handler)
+{
+    contact_cb = handler;
 }
 
 
@@ -143,12 +167,36 @@ int gpio_init(button_event_handler_t handler)
         return err;
     }
 
+#if defined(CONFIG_APP_BUTTON_TIMESTAMPS)
+    // hardware edge times, debouncing falls back to the work timing without them
+    err = edge_init((const uint32_t[EDGE_BUTTONS]){
+        NRF_DT_GPIOS_TO_PSEL(SW0_NODE, gpios),
+        NRF_DT_GPIOS_TO_PSEL(SW1_NODE, gpios),
+    });
+    if (err) {
+        LOG_WRN("Edge timestamps unavailable (err %d)", err);
+    }
+#endif
+
     // done
     LOG_INF("Initialized GPIO\n");
     return 0;
 }
 
 
+int gpio_wake_enable(void)
+{
+    int err;
+
+    // a level interrupt is what arms the pin's sense for System OFF
+    err = gpio_pin_interrupt_configure_dt(&sw0, GPIO_INT_LEVEL_ACTIVE);
+    if (err) {
+        return err;
+    }
+    return gpio_pin_interrupt_configure_dt(&sw1, GPIO_INT_LEVEL_ACTIVE);
+}
+
+
 int gpio_status_led_on(void)
 {
     return gpio_pin_set_dt(&led3, 1);
@@ -2,12 +2,26 @@
 
 #include <zephyr/types.h>
 
+/* Defaults, tunable at runtime (params.c) */
 #define GPIO_SW_DEBOUNCE_MS 30
 #define GPIO_SW_LONGPRESS_MS 5000
 
 typedef void (*button_event_handler_t)(uint8_t button_mask);
+typedef void (*button_contact_handler_t)(void);
 
 int gpio_init(button_event_handler_t handler);
+
+/**
+ * @brief Set a handler called from the GPIO interrupt on the first edge of
+ *        a press, before debouncing.
+ */
+void gpio_contact_handler_set(button_contact_handler_t handler);
+/**
+ * @brief Let the buttons wake the device from System OFF.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int gpio_wake_enable(void);
 int gpio_status_led_on(void);
 int gpio_status_led_off(void);
 int gpio_status_led_toggle(void);
@@ -1,4 +1,12 @@
 #include "hid.h"
+#include "governor.h"
+#include "link.h"
+#include "params.h"
+#include "pending.h"
+#include "power.h"
+#include "probe.h"
+#include "txpower.h"
+#include "usbhid.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/spinlock.h>
@@ -11,6 +19,7 @@
 #include <zephyr/bluetooth/services/dis.h>
 #include <bluetooth/services/hids.h>
 
+#include <app_version.h>
 #include <soc.h>
 #include <stddef.h>
 #include <string.h>
@@ -29,9 +38,22 @@ BT_HIDS_DEF(
 );
 
 static volatile bool is_adv;
+static volatile bool adv_fast;
+static volatile bool is_beacon;
+static volatile bool is_shutdown; // System OFF is next, nothing advertises again
+static struct k_work_delayable adv_slow_work;
 
 static hid_connection_changed_t connection_changed_cb;
 
+static struct adv_status adv_status = {
+    .company = sys_cpu_to_le16(ADV_STATUS_COMPANY_ID),
+    .version = ADV_STATUS_VERSION,
+    .flags = IS_ENABLED(CONFIG_BT_CENTRAL) ? ADV_STATUS_HUB : 0,
+    .fw_major = APP_VERSION_MAJOR,
+    .fw_minor = APP_VERSION_MINOR,
+    .fw_patch = APP_PATCHLEVEL,
+};
+
 static const struct bt_data ad[] = {
     BT_DATA_BYTES(
         BT_DATA_GAP_APPEARANCE,
@@ -47,6 +69,17 @@ static const struct bt_data ad[] = {
         BT_UUID_16_ENCODE(BT_UUID_HIDS_VAL),
         BT_UUID_16_ENCODE(BT_UUID_BAS_VAL)
     ),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, (const uint8_t *)&adv_status, sizeof(adv_status)),
+};
+
+/* Not scannable, so the name goes into the advertising data */
+static const struct bt_data beacon_ad[] = {
+    BT_DATA_BYTES(
+        BT_DATA_FLAGS,
+        BT_LE_AD_NO_BREDR
+    ),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, (const uint8_t *)&adv_status, sizeof(adv_status)),
+    BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
 };
 
 static const struct bt_data sd[] = {
@@ -56,26 +89,210 @@ static const struct bt_data sd[] = {
 static struct conn_mode {
     struct bt_conn *conn;
     bool in_boot_mode;
+    bool notify_enabled;
+    bool boot_notify_enabled;
+    int64_t connected_at;  // 0 once the host has subscribed to key reports
 } conn_mode;
 
+static struct k_work replay_work;
+
+/* Key state and the order of key reports. Live changes come from the main
+ * loop and the hub's BT RX callbacks, replays from the system workqueue.
+ */
+static K_MUTEX_DEFINE(keyboard_lock);
+static uint8_t source_masks[HID_SOURCES_MAX];
+
+#if HID_POINTER_ENABLED
+static struct pointer_state {
+    struct k_spinlock lock;
+    int32_t dx;           // motion not yet reported
+    int32_t dy;
+    atomic_t in_flight;   // a mouse report is waiting for its acknowledgement
+    bool notify_enabled;
+    struct k_work work;
+} pointer;
+#endif
+
 static struct keyboard_state {
     uint8_t ctrl_keys_state;
     uint8_t keys_state[KEY_PRESS_MAX];
     uint8_t charging;
 } hid_keyboard_state;
 
+static const uint8_t report_map[] = {
+    0x05, 0x01,       /* Usage Page (Generic Desktop) */
+    0x09, 0x06,       /* Usage (Keyboard) */
+    0xa1, 0x01,       /* Collection (Application) */
 
-void advertising_start(void)
+    /* Keys */
+#if INPUT_REP_KEYS_REF_ID
+    0x85, INPUT_REP_KEYS_REF_ID,
+#endif
+    0x05, 0x07,       /* Usage Page (Key Codes) */
+    0x19, 0xe0,       /* Usage Minimum (224) */
+    0x29, 0xe7,       /* Usage Maximum (231) */
+    0x15, 0x00,       /* Logical Minimum (0) */
+    0x25, 0x01,       /* Logical Maximum (1) */
+    0x75, 0x01,       /* Report Size (1) */
+    0x95, 0x08,       /* Report Count (8) */
+    0x81, 0x02,       /* Input (Data, Variable, Absolute) */
+
+    0x95, 0x01,       /* Report Count (1) */
+    0x75, 0x08,       /* Report Size (8) */
+    0x81, 0x01,       /* Input (Constant) reserved byte(1) */
+
+    0x95, 0x06,       /* Report Count (6) */
+    0x75, 0x08,       /* Report Size (8) */
+    0x15, 0x00,       /* Logical Minimum (0) */
+    0x25, 0x65,       /* Logical Maximum (101) */
+    0x05, 0x07,       /* Usage Page (Key codes) */
+    0x19, 0x00,       /* Usage Minimum (0) */
+    0x29, 0x65,       /* Usage Maximum (101) */
+    0x81, 0x00,       /* Input (Data, Array) Key array(6 bytes) */
+
+#if defined(CONFIG_APP_HID_LED_REPORT)
+    /* LED */
+#if OUTPUT_REP_KEYS_REF_ID
+    0x85, OUTPUT_REP_KEYS_REF_ID,
+#endif
+    0x95, 0x05,       /* Report Count (5) */
+    0x75, 0x01,       /* Report Size (1) */
+    0x05, 0x08,       /* Usage Page (Page# for LEDs) */
+    0x19, 0x01,       /* Usage Minimum (1) */
+    0x29, 0x05,       /* Usage Maximum (5) */
+    0x91, 0x02,       /* Output (Data, Variable, Absolute), */
+    0x95, 0x01,       /* Report Count (1) */
+    0x75, 0x03,       /* Report Size (3) */
+    0x91, 0x01,       /* Output (Data, Variable, Absolute), */
+#endif
+
+    0xC0,             /* End Collection (Application) */
+
+#if HID_POINTER_ENABLED
+    0x05, 0x01,       /* Usage Page (Generic Desktop) */
+    0x09, 0x02,       /* Usage (Mouse) */
+    0xa1, 0x01,       /* Collection (Application) */
+    0x85, INPUT_REP_MOUSE_REF_ID,
+    0x09, 0x01,       /* Usage (Pointer) */
+    0xa1, 0x00,       /* Collection (Physical) */
+
+    0x05, 0x09,       /* Usage Page (Buttons) */
+    0x19, 0x01,       /* Usage Minimum (1) */
+    0x29, 0x03,       /* Usage Maximum (3) */
+    0x15, 0x00,       /* Logical Minimum (0) */
+    0x25, 0x01,       /* Logical Maximum (1) */
+    0x95, 0x03,       /* Report Count (3) */
+    0x75, 0x01,       /* Report Size (1) */
+    0x81, 0x02,       /* Input (Data, Variable, Absolute) */
+    0x95, 0x01,       /* Report Count (1) */
+    0x75, 0x05,       /* Report Size (5) */
+    0x81, 0x01,       /* Input (Constant) padding */
+
+    0x05, 0x01,       /* Usage Page (Generic Desktop) */
+    0x09, 0x30,       /* Usage (X) */
+    0x09, 0x31,       /* Usage (Y) */
+    0x15, 0x81,       /* Logical Minimum (-127) */
+    0x25, 0x7f,       /* Logical Maximum (127) */
+    0x75, 0x08,       /* Report Size (8) */
+    0x95, 0x02,       /* Report Count (2) */
+    0x81, 0x06,       /* Input (Data, Variable, Relative) */
+
+    0xC0,             /* End Collection (Physical) */
+    0xC0,             /* End Collection (Application) */
+#endif
+};
+
+
+static int advertising_start_interval(bool fast)
 {
-    int err;
+    const struct params *params = params_get();
     struct bt_le_adv_param *adv_param = BT_LE_ADV_PARAM(
         (BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_ONE_TIME),
-        BT_GAP_ADV_FAST_INT_MIN_2,
-        BT_GAP_ADV_FAST_INT_MAX_2,
+        fast ? params->adv_fast_int_min : params->adv_slow_int_min,
+        fast ? params->adv_fast_int_max : params->adv_slow_int_max,
         NULL
     );
 
-    err = bt_le_adv_start(adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+    return bt_le_adv_start(adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+}
+
+
+static void beacon_stop(void)
+{
+    if (!is_beacon) {
+        return;
+    }
+
+    bt_le_adv_stop();
+    is_beacon = false;
+    adv_status.flags &= ~ADV_STATUS_BEACON;
+}
+
+
+/* Low-duty, non-connectable advertising that keeps the unit visible to a
+ * fleet scan after the connectable windows have ended.
+ */
+static void beacon_start(void)
+{
+    int err;
+
+    if (!IS_ENABLED(CONFIG_APP_STORAGE_BEACON) || !governor_policy_get()->beacon || is_beacon || is_shutdown) {
+        return;
+    }
+
+    adv_status.flags |= ADV_STATUS_BEACON;
+    err = bt_le_adv_start(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_USE_IDENTITY, ADV_BEACON_INT_MIN, ADV_BEACON_INT_MAX, NULL),
+                          beacon_ad, ARRAY_SIZE(beacon_ad), NULL, 0);
+    if (err) {
+        adv_status.flags &= ~ADV_STATUS_BEACON;
+        LOG_ERR("Storage beacon failed to start (err %d)\n", err);
+        return;
+    }
+    is_beacon = true;
+    LOG_INF("Storage beacon started\n");
+}
+
+
+void advertising_status_set(uint16_t battery_mv, uint8_t flags)
+{
+    int err = 0;
+
+    adv_status.battery_mv = sys_cpu_to_le16(battery_mv);
+    adv_status.flags = (adv_status.flags & (ADV_STATUS_BEACON | ADV_STATUS_HUB)) | flags;
+
+    if (is_beacon) {
+        err = bt_le_adv_update_data(beacon_ad, ARRAY_SIZE(beacon_ad), NULL, 0);
+    } else if (is_adv) {
+        err = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+    }
+    if (err) {
+        LOG_WRN("Advertising data update failed (err %d)\n", err);
+    }
+}
+
+
+void advertising_start(void)
+{
+    bool fast = governor_policy_get()->adv_fast;
+    int err;
+
+    if (usbhid_is_active() || is_shutdown) {
+        return; // tethered, keep the radio off until the cable is pulled
+    }
+
+    beacon_stop();
+
+    if (is_adv) {
+        if (adv_fast || !fast) {
+            LOG_WRN("Advertising continued\n");
+            return;
+        }
+        // back to the fast interval, e.g. the device was just picked up
+        bt_le_adv_stop();
+        is_adv = false;
+    }
+
+    err = advertising_start_interval(fast);
     if (err) {
         if (err == -EALREADY) {
             LOG_WRN("Advertising continued\n");
@@ -85,7 +302,111 @@ void advertising_start(void)
         return;
     }
     is_adv = true;
+    adv_fast = fast;
+    // on a low battery the slow interval is all there is
+    k_work_reschedule(&adv_slow_work, K_MSEC(fast ? ADV_FAST_TIMEOUT_MS : ADV_SLOW_TIMEOUT_MS));
+    power_event(POWER_EVT_ADV_STARTED);
     LOG_INF("Advertising successfully started\n");
+
+    err = txpower_adv_set();
+    if (err) {
+        LOG_WRN("Failed to set advertising TX power (err %d)\n", err);
+    }
+}
+
+
+static void advertising_slow(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    int err;
+
+    if (!is_adv) {
+        return;
+    }
+
+    if (!adv_fast) {
+        advertising_stop(); // nobody connected during the slow window either
+        beacon_start();
+        return;
+    }
+
+    bt_le_adv_stop();
+    err = advertising_start_interval(false);
+    if (err) {
+        LOG_ERR("Slow advertising failed to start (err %d)\n", err);
+        is_adv = false;
+        power_event(POWER_EVT_ADV_STOPPED);
+        return;
+    }
+    adv_fast = false;
+    k_work_reschedule(&adv_slow_work, K_MSEC(ADV_SLOW_TIMEOUT_MS));
+    LOG_INF("Advertising slowed down\n");
+
+    txpower_adv_set();
+}
+
+
+static void conn_shutdown(struct bt_conn *conn, void *data)
+{
+    struct bt_conn_info info;
+    uint32_t *up = data;
+
+    if (bt_conn_get_info(conn, &info)) {
+        return;
+    }
+    if (info.state == BT_CONN_STATE_CONNECTED) {
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_POWER_OFF);
+    }
+    if (info.state == BT_CONN_STATE_CONNECTED || info.state == BT_CONN_STATE_DISCONNECTING) {
+        (*up)++;
+    }
+}
+
+
+int hid_shutdown(k_timeout_t timeout)
+{
+    k_timepoint_t end = sys_timepoint_calc(timeout);
+    uint32_t up;
+
+    is_shutdown = true;
+    advertising_stop();
+
+    // a hub may still be reconnecting a remote, every pass takes down what is up
+    for (;;) {
+        up = 0;
+        bt_conn_foreach(BT_CONN_TYPE_LE, conn_shutdown, &up);
+        if (!up) {
+            return 0;
+        }
+        if (sys_timepoint_expired(end)) {
+            return -ETIMEDOUT;
+        }
+        k_sleep(K_MSEC(10));
+    }
+}
+
+
+void advertising_stop(void)
+{
+    int err;
+
+    beacon_stop();
+
+    if (!is_adv) {
+        return;
+    }
+
+    k_work_cancel_delayable(&adv_slow_work);
+
+    err = bt_le_adv_stop();
+    if (err) {
+        LOG_ERR("Advertising failed to stop (err %d)\n", err);
+        return;
+    }
+    is_adv = false;
+    power_event(POWER_EVT_ADV_STOPPED);
+    LOG_INF("Advertising stopped\n");
 }
 
 
@@ -95,11 +416,24 @@ bool is_advertising(void)
 }
 
 
+/* Links this unit opened as a hub are not host connections */
+static bool conn_is_host(struct bt_conn *conn)
+{
+    struct bt_conn_info info;
+
+    return bt_conn_get_info(conn, &info) == 0 && info.role == BT_CONN_ROLE_PERIPHERAL;
+}
+
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
+    if (!conn_is_host(conn)) {
+        return;
+    }
+
     if (err) {
         LOG_ERR("Failed to connect to %s (%u)\n", addr, err);
         if (connection_changed_cb) {
@@ -123,9 +457,13 @@ static void connected(struct bt_conn *conn, uint8_t err)
     if (!conn_mode.conn) {
         conn_mode.conn = conn;
         conn_mode.in_boot_mode = false;
+        conn_mode.notify_enabled = false;
+        conn_mode.boot_notify_enabled = false;
+        conn_mode.connected_at = k_uptime_get();
     }
 
     is_adv = false;
+    k_work_cancel_delayable(&adv_slow_work);
     if (connection_changed_cb) {
         connection_changed_cb(1);
     }
@@ -139,6 +477,10 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
+    if (!conn_is_host(conn)) {
+        return;
+    }
+
     LOG_INF("Disconnected from %s (reason %u)\n", addr, reason);
 
     err = bt_hids_disconnected(&hids_obj, conn);
@@ -149,8 +491,10 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
         }
     }
 
-    if (conn_mode.conn) {
+    if (conn_mode.conn == conn) {
         conn_mode.conn = NULL;
+        conn_mode.notify_enabled = false;
+        conn_mode.boot_notify_enabled = false;
     }
 
     advertising_start();
@@ -180,6 +524,12 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 };
 
 
+#if HID_OUTPUT_REPORTS
+static void probe_echo_send(struct bt_conn *conn, uint8_t value);
+#endif
+
+
+#if defined(CONFIG_APP_HID_LED_REPORT)
 static void hids_outp_rep_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
 {
     char addr[BT_ADDR_LE_STR_LEN];
@@ -190,10 +540,17 @@ static void hids_outp_rep_handler(struct bt_hids_rep *rep, struct bt_conn *conn,
         return;
     };
 
+    if (probe_is_active() && rep->size) {
+        probe_echo_send(conn, rep->data[0]);
+        return;
+    }
+
     LOG_INF("Output report has been received %s\n", addr);
 }
+#endif
 
 
+#if defined(CONFIG_APP_HID_BOOT_KEYBOARD)
 static void hids_boot_kb_outp_rep_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
 {
     char addr[BT_ADDR_LE_STR_LEN];
@@ -204,8 +561,64 @@ static void hids_boot_kb_outp_rep_handler(struct bt_hids_rep *rep, struct bt_con
         return;
     };
 
+    if (probe_is_active() && rep->size) {
+        probe_echo_send(conn, rep->data[0]);
+        return;
+    }
+
     LOG_INF("Boot Keyboard Output report has been received %s\n", addr);
 }
+#endif
+
+
+/* Connection to key reports enabled, the time the host spends on discovery
+ * and subscription after the link is up. This is not pair-to-first-keystroke:
+ * the host still has to deliver the first report to its input stack, which
+ * only the host side sees (tests/bsim discovery_time.sh).
+ */
+static void ready_record(void)
+{
+    if (!conn_mode.connected_at) {
+        return;
+    }
+
+    LOG_INF("Key reports subscribed %u ms after connect\n", (uint32_t)(k_uptime_get() - conn_mode.connected_at));
+    conn_mode.connected_at = 0;
+}
+
+
+static void hids_inp_rep_notify_handler(enum bt_hids_notify_evt evt)
+{
+    conn_mode.notify_enabled = (evt == BT_HIDS_CCCD_EVT_NOTIFY_ENABLED);
+    if (conn_mode.notify_enabled) {
+        ready_record();
+    }
+    if (conn_mode.notify_enabled && !conn_mode.in_boot_mode) {
+        k_work_submit(&replay_work);
+    }
+}
+
+
+#if HID_POINTER_ENABLED
+static void hids_mouse_notify_handler(enum bt_hids_notify_evt evt)
+{
+    pointer.notify_enabled = (evt == BT_HIDS_CCCD_EVT_NOTIFY_ENABLED);
+}
+#endif
+
+
+#if defined(CONFIG_APP_HID_BOOT_KEYBOARD)
+static void hids_boot_kb_notify_handler(enum bt_hids_notify_evt evt)
+{
+    conn_mode.boot_notify_enabled = (evt == BT_HIDS_CCCD_EVT_NOTIFY_ENABLED);
+    if (conn_mode.boot_notify_enabled) {
+        ready_record();
+    }
+    if (conn_mode.boot_notify_enabled && conn_mode.in_boot_mode) {
+        k_work_submit(&replay_work);
+    }
+}
+#endif
 
 
 static void hids_pm_evt_handler(enum bt_hids_pm_evt evt, struct bt_conn *conn)
@@ -230,6 +643,15 @@ static void hids_pm_evt_handler(enum bt_hids_pm_evt evt, struct bt_conn *conn)
 }
 
 
+static void replay_pending(struct k_work *work);
+
+static void usb_state_changed(bool active);
+
+#if HID_POINTER_ENABLED
+static void pointer_send(struct k_work *work);
+#endif
+
+
 void hid_init(hid_connection_changed_t cb)
 {
     int err;
@@ -240,54 +662,6 @@ void hid_init(hid_connection_changed_t cb)
     struct bt_hids_inp_rep       *hids_inp_rep;
     struct bt_hids_outp_feat_rep *hids_outp_rep;
 
-    static const uint8_t report_map[] = {
-        0x05, 0x01,       /* Usage Page (Generic Desktop) */
-        0x09, 0x06,       /* Usage (Keyboard) */
-        0xa1, 0x01,       /* Collection (Application) */
-
-        /* Keys */
-#if INPUT_REP_KEYS_REF_ID
-        0x85, INPUT_REP_KEYS_REF_ID,
-#endif
-        0x05, 0x07,       /* Usage Page (Key Codes) */
-        0x19, 0xe0,       /* Usage Minimum (224) */
-        0x29, 0xe7,       /* Usage Maximum (231) */
-        0x15, 0x00,       /* Logical Minimum (0) */
-        0x25, 0x01,       /* Logical Maximum (1) */
-        0x75, 0x01,       /* Report Size (1) */
-        0x95, 0x08,       /* Report Count (8) */
-        0x81, 0x02,       /* Input (Data, Variable, Absolute) */
-
-        0x95, 0x01,       /* Report Count (1) */
-        0x75, 0x08,       /* Report Size (8) */
-        0x81, 0x01,       /* Input (Constant) reserved byte(1) */
-
-        0x95, 0x06,       /* Report Count (6) */
-        0x75, 0x08,       /* Report Size (8) */
-        0x15, 0x00,       /* Logical Minimum (0) */
-        0x25, 0x65,       /* Logical Maximum (101) */
-        0x05, 0x07,       /* Usage Page (Key codes) */
-        0x19, 0x00,       /* Usage Minimum (0) */
-        0x29, 0x65,       /* Usage Maximum (101) */
-        0x81, 0x00,       /* Input (Data, Array) Key array(6 bytes) */
-
-        /* LED */
-#if OUTPUT_REP_KEYS_REF_ID
-        0x85, OUTPUT_REP_KEYS_REF_ID,
-#endif
-        0x95, 0x05,       /* Report Count (5) */
-        0x75, 0x01,       /* Report Size (1) */
-        0x05, 0x08,       /* Usage Page (Page# for LEDs) */
-        0x19, 0x01,       /* Usage Minimum (1) */
-        0x29, 0x05,       /* Usage Maximum (5) */
-        0x91, 0x02,       /* Output (Data, Variable, Absolute), */
-        0x95, 0x01,       /* Report Count (1) */
-        0x75, 0x03,       /* Report Size (3) */
-        0x91, 0x01,       /* Output (Data, Variable, Absolute), */
-
-        0xC0              /* End Collection (Application) */
-    };
-
     // // ! test
     // 0x05, 0x85,       /* Usage Page (Battery System) */
     // 0x09, 0x44,       /* Usage (Charging) */
@@ -312,27 +686,51 @@ void hid_init(hid_connection_changed_t cb)
     hids_inp_rep = &hids_init_obj.inp_rep_group_init.reports[INPUT_REP_KEYS_IDX];
     hids_inp_rep->size = INPUT_REPORT_KEYS_MAX_LEN;
     hids_inp_rep->id = INPUT_REP_KEYS_REF_ID;
+    hids_inp_rep->handler = hids_inp_rep_notify_handler;
     hids_init_obj.inp_rep_group_init.cnt++;
 
+#if HID_POINTER_ENABLED
+    hids_inp_rep = &hids_init_obj.inp_rep_group_init.reports[INPUT_REP_MOUSE_IDX];
+    hids_inp_rep->size = INPUT_REPORT_MOUSE_LEN;
+    hids_inp_rep->id = INPUT_REP_MOUSE_REF_ID;
+    hids_inp_rep->handler = hids_mouse_notify_handler;
+    hids_init_obj.inp_rep_group_init.cnt++;
+#endif
+
+#if defined(CONFIG_APP_HID_LED_REPORT)
     hids_outp_rep = &hids_init_obj.outp_rep_group_init.reports[OUTPUT_REP_KEYS_IDX];
     hids_outp_rep->size = OUTPUT_REPORT_MAX_LEN;
     hids_outp_rep->id = OUTPUT_REP_KEYS_REF_ID;
     hids_outp_rep->handler = hids_outp_rep_handler;
     hids_init_obj.outp_rep_group_init.cnt++;
+#endif
 
+#if defined(CONFIG_APP_HID_BOOT_KEYBOARD)
     hids_init_obj.is_kb = true;
     hids_init_obj.boot_kb_outp_rep_handler = hids_boot_kb_outp_rep_handler;
+    hids_init_obj.boot_kb_notif_handler = hids_boot_kb_notify_handler;
+#endif
     hids_init_obj.pm_evt_handler = hids_pm_evt_handler;
 
+    k_work_init(&replay_work, replay_pending);
+    k_work_init_delayable(&adv_slow_work, advertising_slow);
+#if HID_POINTER_ENABLED
+    k_work_init(&pointer.work, pointer_send);
+#endif
+
     err = bt_hids_init(&hids_obj, &hids_init_obj);
     __ASSERT(err == 0, "HIDS initialization failed\n");
+    LOG_INF("HID service registered with %u attributes\n", hid_gatt_attr_count());
+
+    err = usbhid_init(report_map, sizeof(report_map), usb_state_changed);
+    if (err) {
+        LOG_ERR("USB HID initialization failed (err %d)\n", err);
+    }
 }
 
 
-static int key_report_con_send(const struct keyboard_state *state, bool boot_mode, struct bt_conn *conn)
+static void key_report_build(const struct keyboard_state *state, uint8_t data[INPUT_REPORT_KEYS_MAX_LEN])
 {
-    int err = 0;
-    uint8_t  data[INPUT_REPORT_KEYS_MAX_LEN];
     uint8_t *key_data;
     const uint8_t *key_state;
     size_t n;
@@ -345,22 +743,56 @@ static int key_report_con_send(const struct keyboard_state *state, bool boot_mod
     for (n = 0; n < KEY_PRESS_MAX; ++n) {
         *key_data++ = *key_state++;
     }
+}
+
+
+static int key_report_con_send(const struct keyboard_state *state, bool boot_mode, struct bt_conn *conn,
+                               uint8_t reserved)
+{
+    int err = 0;
+    uint8_t  data[INPUT_REPORT_KEYS_MAX_LEN];
+
+    key_report_build(state, data);
+    data[1] = reserved;
+
+    link_tx_queued(conn);
     if (boot_mode) {
-        err = bt_hids_boot_kb_inp_rep_send(&hids_obj, conn, data, sizeof(data), NULL);
+        err = bt_hids_boot_kb_inp_rep_send(&hids_obj, conn, data, sizeof(data), link_tx_complete);
     } else {
-        err = bt_hids_inp_rep_send(&hids_obj, conn, INPUT_REP_KEYS_IDX, data, sizeof(data), NULL);
+        err = bt_hids_inp_rep_send(&hids_obj, conn, INPUT_REP_KEYS_IDX, data, sizeof(data), link_tx_complete);
+    }
+    if (err) {
+        link_tx_failed(conn);
     }
 
     return err;
 }
 
 
-static int key_report_send(void)
+/* Send the keyboard state to the active host. The reserved byte is 0, or
+ * the value of a probe echo. Call with keyboard_lock held.
+ */
+static int key_report_send(uint8_t reserved)
 {
+    if (usbhid_is_active()) {
+        // USB carries the report ID in-band when the map has more than one report
+        uint8_t data[1 + INPUT_REPORT_KEYS_MAX_LEN] = { INPUT_REP_KEYS_REF_ID };
+        size_t id_len = INPUT_REP_KEYS_REF_ID ? 1 : 0;
+        int err;
+
+        key_report_build(&hid_keyboard_state, &data[id_len]);
+        data[id_len + 1] = reserved;
+        err = usbhid_send(data, id_len + INPUT_REPORT_KEYS_MAX_LEN);
+        if (err) {
+            LOG_ERR("USB key report send error: %d\n", err);
+        }
+        return err;
+    }
+
     if (conn_mode.conn) {
         int err;
 
-        err = key_report_con_send(&hid_keyboard_state, conn_mode.in_boot_mode, conn_mode.conn);
+        err = key_report_con_send(&hid_keyboard_state, conn_mode.in_boot_mode, conn_mode.conn, reserved);
         if (err) {
             LOG_ERR("Key report send error: %d\n", err);
             return err;
@@ -417,7 +849,7 @@ static int hid_kbd_state_key_clear(uint8_t key)
 }
 
 
-int hid_key_changed(uint8_t button_mask)
+static void hid_kbd_state_apply(uint8_t button_mask)
 {
     if (button_mask & (uint8_t)(1U << 0)) {
         hid_kbd_state_key_set(KEY_CODE_SW0);
@@ -430,18 +862,251 @@ int hid_key_changed(uint8_t button_mask)
     } else {
         hid_kbd_state_key_clear(KEY_CODE_SW1);
     }
+}
+
 
-    return key_report_send();
+static bool host_subscribed(void)
+{
+    if (usbhid_is_active()) {
+        return true;
+    }
+    if (!conn_mode.conn) {
+        return false;
+    }
+    return conn_mode.in_boot_mode ? conn_mode.boot_notify_enabled : conn_mode.notify_enabled;
+}
+
+
+static void replay_pending(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t button_mask;
+
+    // pushes also happen under keyboard_lock, so the peeked transition is
+    // still the oldest when it is popped; a failed send keeps it for the next replay
+    k_mutex_lock(&keyboard_lock, K_FOREVER);
+    while (host_subscribed() && pending_peek(&button_mask) == 0) {
+        LOG_INF("Replaying %x\n", button_mask);
+        hid_kbd_state_apply(button_mask);
+        if (key_report_send(0)) {
+            break;
+        }
+        pending_pop();
+    }
+    k_mutex_unlock(&keyboard_lock);
+}
+
+
+#if HID_OUTPUT_REPORTS
+/* Echo a probe output report in the reserved byte of the keyboard report.
+ * The key state is unchanged, so the host sees no key events. The echo
+ * goes out under keyboard_lock on the same path as every key report, so
+ * it cannot overtake a newer key state. While the replay has presses to
+ * deliver, or the keys go over USB, the echo is dropped and the probe
+ * counts it as failed.
+ */
+static void probe_echo_send(struct bt_conn *conn, uint8_t value)
+{
+    int err;
+
+    k_mutex_lock(&keyboard_lock, K_FOREVER);
+    if (usbhid_is_active() || conn != conn_mode.conn || !host_subscribed()) {
+        err = -ENOTCONN;
+    } else if (!pending_empty()) {
+        err = -EBUSY;
+    } else {
+        err = key_report_send(value);
+    }
+    k_mutex_unlock(&keyboard_lock);
+
+    probe_hid_echoed(err);
+}
+#endif
+
+
+static void usb_state_changed(bool active)
+{
+    if (active) {
+        advertising_stop();
+    } else if (!conn_mode.conn) {
+        advertising_start();
+    }
+
+    // the keyboard state survives the switch, bring the new host up to date
+    if (host_subscribed()) {
+        k_mutex_lock(&keyboard_lock, K_FOREVER);
+        key_report_send(0);
+        k_mutex_unlock(&keyboard_lock);
+        k_work_submit(&replay_work);
+    }
+}
+
+
+int hid_source_key_changed(uint8_t source, uint8_t button_mask)
+{
+    int err;
+
+    if (source >= HID_SOURCES_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&keyboard_lock, K_FOREVER);
+
+    source_masks[source] = button_mask;
+    LOG_INF("Source %u keys %x\n", source, button_mask);
+
+    // a key stays down while any source holds it
+    button_mask = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(source_masks); i++) {
+        button_mask |= source_masks[i];
+    }
+
+    if (!host_subscribed()) {
+        // host cannot receive this yet, replay it once it subscribes again
+        pending_push(button_mask);
+        k_mutex_unlock(&keyboard_lock);
+        return 0;
+    }
+
+    if (!pending_empty()) {
+        // the replay is still catching up, a direct report would overtake it
+        pending_push(button_mask);
+        k_mutex_unlock(&keyboard_lock);
+        k_work_submit(&replay_work);
+        return 0;
+    }
+
+    hid_kbd_state_apply(button_mask);
+    err = key_report_send(0);
+
+    k_mutex_unlock(&keyboard_lock);
+    return err;
+}
+
+
+int hid_key_changed(uint8_t button_mask)
+{
+    return hid_source_key_changed(HID_SOURCE_LOCAL, button_mask);
 }
 
 
 int hid_charging_changed(uint8_t charging)
 {
+    int err;
+
+    k_mutex_lock(&keyboard_lock, K_FOREVER);
+
     if (charging) {
         hid_keyboard_state.charging = 0xff;
     } else {
         hid_keyboard_state.charging = 0;
     }
+    err = key_report_send(0);
+
+    k_mutex_unlock(&keyboard_lock);
+    return err;
+}
+
+
+#if HID_POINTER_ENABLED
+static void pointer_tx_complete(struct bt_conn *conn, void *user_data)
+{
+    link_tx_complete(conn, user_data);
+
+    atomic_clear(&pointer.in_flight);
+    k_work_submit(&pointer.work);
+}
+
+
+static void pointer_send(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t data[1 + INPUT_REPORT_MOUSE_LEN] = { INPUT_REP_MOUSE_REF_ID };
+    uint8_t *report = &data[1];
+    k_spinlock_key_t key;
+    bool usb = usbhid_is_active();
+    int8_t dx, dy;
+    int err;
+
+    if (!usb && (!conn_mode.conn || conn_mode.in_boot_mode || !pointer.notify_enabled)) {
+        // nobody to move the pointer for, stale motion must not jump later
+        key = k_spin_lock(&pointer.lock);
+        pointer.dx = 0;
+        pointer.dy = 0;
+        k_spin_unlock(&pointer.lock, key);
+        return;
+    }
+
+    if (!atomic_cas(&pointer.in_flight, 0, 1)) {
+        return; // motion keeps merging until the report in flight is acknowledged
+    }
+
+    key = k_spin_lock(&pointer.lock);
+    dx = CLAMP(pointer.dx, INT8_MIN + 1, INT8_MAX);
+    dy = CLAMP(pointer.dy, INT8_MIN + 1, INT8_MAX);
+    pointer.dx -= dx;
+    pointer.dy -= dy;
+    k_spin_unlock(&pointer.lock, key);
+
+    if (dx == 0 && dy == 0) {
+        atomic_clear(&pointer.in_flight);
+        return;
+    }
+
+    report[0] = 0; // buttons stay on the keyboard report
+    report[1] = (uint8_t)dx;
+    report[2] = (uint8_t)dy;
+
+    if (usb) {
+        err = usbhid_send(data, sizeof(data));
+        atomic_clear(&pointer.in_flight);
+    } else {
+        link_tx_queued(conn_mode.conn);
+        err = bt_hids_inp_rep_send(&hids_obj, conn_mode.conn, INPUT_REP_MOUSE_IDX,
+                                   report, INPUT_REPORT_MOUSE_LEN, pointer_tx_complete);
+        if (err) {
+            link_tx_failed(conn_mode.conn);
+            atomic_clear(&pointer.in_flight);
+        }
+    }
 
-    return key_report_send();
+    if (err) {
+        LOG_ERR("Mouse report send error: %d\n", err);
+        return;
+    }
+
+    if (usb) {
+        k_work_submit(&pointer.work); // usbhid queues behind the endpoint, drain the remainder
+    }
+}
+
+
+int hid_pointer_motion(int16_t dx, int16_t dy)
+{
+    k_spinlock_key_t key = k_spin_lock(&pointer.lock);
+
+    pointer.dx += dx;
+    pointer.dy += dy;
+
+    k_spin_unlock(&pointer.lock, key);
+
+    k_work_submit(&pointer.work);
+    return 0;
+}
+#else
+int hid_pointer_motion(int16_t dx, int16_t dy)
+{
+    ARG_UNUSED(dx);
+    ARG_UNUSED(dy);
+
+    return -ENOTSUP;
+}
+#endif
+
+
+uint16_t hid_gatt_attr_count(void)
+{
+    return hids_obj.gp.svc.attr_count;
 }
@@ -1,7 +1,10 @@
 
 #pragma once
 
+#include <zephyr/kernel.h>
 #include <zephyr/types.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/toolchain.h>
 
 #include <assert.h>
 
@@ -11,9 +14,52 @@
 
 #define BASE_USB_HID_SPEC_VERSION 0x0101
 
+#define ADV_FAST_TIMEOUT_MS 30000  // fast advertising before falling back to the slow interval
+#define ADV_SLOW_TIMEOUT_MS 600000 // slow advertising before going silent until the next press
+
+/* Storage beacon after the slow window, 0.625 ms units (10 s) */
+#define ADV_BEACON_INT_MIN  0x3e80
+#define ADV_BEACON_INT_MAX  0x4000
+
+#define ADV_STATUS_COMPANY_ID 0xffff  // no company, manufacturer data for testing only
+#define ADV_STATUS_VERSION    1
+
+#define ADV_STATUS_CHARGING   BIT(0)
+#define ADV_STATUS_VBUS       BIT(1)
+#define ADV_STATUS_ERROR      BIT(2)  // a module failed to initialize
+#define ADV_STATUS_BEACON     BIT(3)  // sent by the storage beacon, not connectable
+#define ADV_STATUS_HUB        BIT(4)  // built as a hub, keeps central links to remotes (hub.c)
+
+/* Manufacturer data in every advertising packet, little endian. A passive
+ * scan reads battery and health of every unit in range without connecting
+ * (scripts/fleet_scan.py).
+ */
+struct __packed adv_status {
+    uint16_t company;      // ADV_STATUS_COMPANY_ID
+    uint8_t version;       // ADV_STATUS_VERSION
+    uint8_t flags;         // ADV_STATUS_*
+    uint16_t battery_mv;
+    uint8_t fw_major;
+    uint8_t fw_minor;
+    uint8_t fw_patch;
+};
+
+/* Air-mouse pointer, available on boards with the LSM6DS3TR-C IMU (XIAO BLE Sense) */
+#define HID_POINTER_ENABLED DT_HAS_COMPAT_STATUS_OKAY(st_lsm6dsl)
+
+/* Output reports the host can write, see Kconfig */
+#define HID_OUTPUT_REPORTS (IS_ENABLED(CONFIG_APP_HID_LED_REPORT) || IS_ENABLED(CONFIG_APP_HID_BOOT_KEYBOARD))
+
 #define OUTPUT_REPORT_MAX_LEN  1
+#if HID_POINTER_ENABLED
+/* More than one report in the map, every report needs an ID */
+#define INPUT_REP_KEYS_REF_ID  1
+#define OUTPUT_REP_KEYS_REF_ID 1
+#define INPUT_REP_MOUSE_REF_ID 2
+#else
 #define INPUT_REP_KEYS_REF_ID  0
 #define OUTPUT_REP_KEYS_REF_ID 0
+#endif
 #define MODIFIER_KEY_POS       0
 #define SCAN_CODE_POS          2
 #define KEYS_MAX_LEN           (INPUT_REPORT_KEYS_MAX_LEN - SCAN_CODE_POS)
@@ -51,6 +97,14 @@
  */
 #define INPUT_REPORT_KEYS_MAX_LEN (1 + 1 + KEY_PRESS_MAX)
 
+/* Number of bytes in mouse report
+ *
+ * 1B - buttons
+ * 1B - X displacement
+ * 1B - Y displacement
+ */
+#define INPUT_REPORT_MOUSE_LEN 3
+
 /* Current report map construction requires exactly 8 buttons */
 BUILD_ASSERT((KEY_CTRL_CODE_MAX - KEY_CTRL_CODE_MIN) + 1 == 8);
 
@@ -69,14 +123,63 @@ enum {
  * report ID.
  */
 enum {
-    INPUT_REP_KEYS_IDX = 0
+    INPUT_REP_KEYS_IDX = 0,
+#if HID_POINTER_ENABLED
+    INPUT_REP_MOUSE_IDX,
+#endif
 };
 
 typedef void (*hid_connection_changed_t)(uint8_t state);
 
+#define HID_SOURCE_LOCAL 0                  // this unit's own buttons
+#define HID_SOURCES_MAX  CONFIG_BT_MAX_CONN // local buttons plus one per hub remote
+
 void hid_init(hid_connection_changed_t cb);
 int hid_key_changed(uint8_t button_mask);
+
+/**
+ * @brief Update the keys held by one source. The report carries the union
+ *        of all sources.
+ *
+ * @param[in] source HID_SOURCE_LOCAL or a hub remote.
+ * @param[in] button_mask Buttons the source holds down.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int hid_source_key_changed(uint8_t source, uint8_t button_mask);
 int hid_charging_changed(uint8_t charging);
+uint16_t hid_gatt_attr_count(void);
+
+/**
+ * @brief Queue relative pointer motion.
+ *
+ * Motion is merged until the previous mouse report has been sent, so
+ * reports go out at the rate the link can carry them and none is dropped.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int hid_pointer_motion(int16_t dx, int16_t dy);
 
 void advertising_start(void);
+void advertising_stop(void);
 bool is_advertising();
+
+/**
+ * @brief Stop advertising for good and disconnect every link, ahead of
+ *        System OFF. Hosts see a power-off disconnect instead of waiting
+ *        out the supervision timeout.
+ *
+ * @param[in] timeout How long to wait for the links to go down.
+ *
+ * @retval 0 if successful. -ETIMEDOUT if a link was still up at the timeout.
+ */
+int hid_shutdown(k_timeout_t timeout);
+
+/**
+ * @brief Update the status carried in the advertising data. Applied to a
+ *        running advertiser or beacon without restarting it.
+ *
+ * @param[in] battery_mv Battery voltage in millivolts.
+ * @param[in] flags ADV_STATUS_CHARGING, ADV_STATUS_VBUS and ADV_STATUS_ERROR.
+ */
+void advertising_status_set(uint16_t battery_mv, uint8_t flags);
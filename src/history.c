@@ -0,0 +1,453 @@
+#include "history.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME history
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_FCB)
+
+#define HISTORY_FCB_MAGIC    0x7472796b
+#define HISTORY_SECTORS_MAX  16
+#define HISTORY_DELTA_MAX    (2 * 5) // two 32-bit varints
+#define HISTORY_NOTIFY_MAX   (CONFIG_BT_L2CAP_TX_MTU - 3)
+
+static struct bt_uuid_128 history_service_uuid = BT_UUID_INIT_128(BT_UUID_HISTORY_SERVICE_VAL);
+static struct bt_uuid_128 history_data_uuid = BT_UUID_INIT_128(BT_UUID_HISTORY_DATA_VAL);
+static struct bt_uuid_128 history_control_uuid = BT_UUID_INIT_128(BT_UUID_HISTORY_CONTROL_VAL);
+
+static struct flash_sector history_sectors[HISTORY_SECTORS_MAX];
+static struct fcb history_fcb;
+static bool is_initialized;
+
+/* Block being filled in RAM. history_record() runs on the main thread and
+ * the download on the system workqueue, both append to and read the log,
+ * so the block and the FCB are only touched with history_lock held.
+ */
+static K_MUTEX_DEFINE(history_lock);
+static uint8_t block[HISTORY_BLOCK_LEN];
+static size_t block_len;
+static uint16_t boot;
+static uint32_t last_s;
+static uint16_t last_mv;
+
+static struct history_stats history_stats;
+
+/* Download state, only used from the system workqueue */
+static struct history_stream {
+    struct bt_conn *conn;
+    struct fcb_entry loc;
+    uint8_t entry[1 + HISTORY_BLOCK_LEN]; // length prefix + block
+    size_t entry_len;
+    size_t entry_off;
+    bool started;       // RAM block flushed and first entry not yet read
+    bool done;
+    bool abort;
+} stream;
+
+static atomic_t stream_inflight;
+static struct k_work stream_work;
+static uint8_t stream_buf[HISTORY_NOTIFY_MAX]; // copied by the host before notify returns
+
+
+static size_t varint_put(uint8_t *buf, uint32_t value)
+{
+    size_t len = 0;
+
+    do {
+        buf[len] = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            buf[len] |= 0x80;
+        }
+        len++;
+    } while (value);
+
+    return len;
+}
+
+
+// Called with history_lock held
+static int block_write(void)
+{
+    struct fcb_entry loc;
+    int err;
+
+    if (!block_len) {
+        return 0;
+    }
+
+    err = fcb_append(&history_fcb, block_len, &loc);
+    if (err == -ENOSPC) {
+        // oldest sector goes first, sectors are reused in turn which spreads the erases
+        err = fcb_rotate(&history_fcb);
+        if (!err) {
+            history_stats.rotations++;
+            err = fcb_append(&history_fcb, block_len, &loc);
+        }
+    }
+    if (err) {
+        LOG_ERR("Append failed (err %d)", err);
+        return err;
+    }
+
+    err = flash_area_write(history_fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), block, block_len);
+    if (err) {
+        LOG_ERR("Write failed (err %d)", err);
+        return err;
+    }
+
+    err = fcb_append_finish(&history_fcb, &loc);
+    if (err) {
+        return err;
+    }
+
+    history_stats.blocks++;
+    block_len = 0;
+    return 0;
+}
+
+
+static void block_start(uint32_t now_s, uint16_t mv, bool charging)
+{
+    struct history_block_header header = {
+        .version = HISTORY_VERSION,
+        .charging = charging,
+        .boot = sys_cpu_to_le16(boot),
+        .uptime_s = sys_cpu_to_le32(now_s),
+        .mv = sys_cpu_to_le16(mv),
+    };
+
+    memcpy(block, &header, sizeof(header));
+    block_len = sizeof(header);
+}
+
+
+void history_record(uint16_t mv, bool charging)
+{
+    uint32_t now_s = k_uptime_get() / MSEC_PER_SEC;
+    uint8_t delta[HISTORY_DELTA_MAX];
+    size_t delta_len;
+    int32_t dmv = (int32_t)mv - last_mv;
+
+    if (!is_initialized) {
+        return;
+    }
+
+    k_mutex_lock(&history_lock, K_FOREVER);
+
+    delta_len = varint_put(delta, ((now_s - last_s) << 1) | charging);
+    delta_len += varint_put(&delta[delta_len], (uint32_t)((dmv << 1) ^ (dmv >> 31))); // zigzag
+
+    if (block_len && block_len + delta_len <= sizeof(block)) {
+        memcpy(&block[block_len], delta, delta_len);
+        block_len += delta_len;
+    } else {
+        block_write();
+        block_start(now_s, mv, charging);
+    }
+
+    last_s = now_s;
+    last_mv = mv;
+    history_stats.samples++;
+
+    k_mutex_unlock(&history_lock);
+}
+
+
+void history_flush(void)
+{
+    if (!is_initialized) {
+        return;
+    }
+
+    k_mutex_lock(&history_lock, K_FOREVER);
+    block_write();
+    k_mutex_unlock(&history_lock);
+}
+
+
+void history_stats_get(struct history_stats *stats)
+{
+    *stats = history_stats;
+}
+
+
+// Called with history_lock held, a rotation must not move the entry under the read
+static int stream_entry_load(void)
+{
+    int err = fcb_getnext(&history_fcb, &stream.loc);
+
+    if (err) {
+        // end of the log
+        stream.entry[0] = 0;
+        stream.entry_len = 1;
+        stream.entry_off = 0;
+        stream.done = true;
+        return 0;
+    }
+
+    if (stream.loc.fe_data_len > HISTORY_BLOCK_LEN) {
+        return -EINVAL;
+    }
+
+    err = flash_area_read(history_fcb.fap, FCB_ENTRY_FA_DATA_OFF(stream.loc),
+                          &stream.entry[1], stream.loc.fe_data_len);
+    if (err) {
+        return err;
+    }
+
+    stream.entry[0] = stream.loc.fe_data_len;
+    stream.entry_len = 1 + stream.loc.fe_data_len;
+    stream.entry_off = 0;
+    return 0;
+}
+
+
+static void stream_sent(struct bt_conn *conn, void *user_data)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(user_data);
+
+    atomic_dec(&stream_inflight);
+    k_work_submit(&stream_work);
+}
+
+
+static void stream_stop(void)
+{
+    if (stream.conn) {
+        bt_conn_unref(stream.conn);
+        stream.conn = NULL;
+    }
+}
+
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+
+
+BT_GATT_SERVICE_DEFINE(history_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &history_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &history_data_uuid.uuid,
+        BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_NONE,
+        NULL, NULL, NULL
+    ),
+    BT_GATT_CCC(NULL, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+
+    BT_GATT_CHARACTERISTIC(
+        &history_control_uuid.uuid,
+        BT_GATT_CHRC_WRITE,
+        BT_GATT_PERM_WRITE_ENCRYPT,
+        NULL, write_control, NULL
+    ),
+);
+
+
+static void stream_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t *buf = stream_buf;
+    size_t len, max_len;
+    int err;
+
+    if (stream.abort) {
+        stream_stop();
+        return;
+    }
+
+    if (stream.conn && !stream.started) {
+        // the download includes the block still held in RAM
+        k_mutex_lock(&history_lock, K_FOREVER);
+        block_write();
+        k_mutex_unlock(&history_lock);
+        stream.started = true;
+    }
+
+    while (stream.conn && atomic_get(&stream_inflight) < HISTORY_TX_INFLIGHT) {
+        if (stream.done && stream.entry_off == stream.entry_len) {
+            LOG_INF("Download complete, %u bytes\n", history_stats.streamed);
+            stream_stop();
+            return;
+        }
+
+        max_len = MIN(bt_gatt_get_mtu(stream.conn) - 3, sizeof(stream_buf));
+        len = 0;
+
+        // fill the notification across block boundaries
+        while (len < max_len) {
+            size_t chunk;
+
+            if (stream.entry_off == stream.entry_len) {
+                if (stream.done) {
+                    break;
+                }
+                k_mutex_lock(&history_lock, K_FOREVER);
+                err = stream_entry_load();
+                k_mutex_unlock(&history_lock);
+                if (err) {
+                    LOG_ERR("Download read failed (err %d)", err);
+                    stream_stop();
+                    return;
+                }
+            }
+
+            chunk = MIN(stream.entry_len - stream.entry_off, max_len - len);
+            memcpy(&buf[len], &stream.entry[stream.entry_off], chunk);
+            stream.entry_off += chunk;
+            len += chunk;
+        }
+
+        struct bt_gatt_notify_params params = {
+            .attr = &history_svc.attrs[2],
+            .data = buf,
+            .len = len,
+            .func = stream_sent,
+        };
+
+        atomic_inc(&stream_inflight);
+        err = bt_gatt_notify_cb(stream.conn, &params);
+        if (err) {
+            atomic_dec(&stream_inflight);
+            LOG_WRN("Download stopped (err %d)\n", err);
+            stream_stop();
+            return;
+        }
+        history_stats.streamed += len;
+    }
+}
+
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    const uint8_t *op = buf;
+
+    if (offset != 0 || len != 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    switch (*op) {
+    case HISTORY_CTRL_DOWNLOAD:
+        if (!is_initialized) {
+            return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+        }
+        if (stream.conn) {
+            return BT_GATT_ERR(BT_ATT_ERR_PROCEDURE_IN_PROGRESS);
+        }
+        if (!bt_gatt_is_subscribed(conn, &history_svc.attrs[2], BT_GATT_CCC_NOTIFY)) {
+            return BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+        }
+
+        stream.conn = bt_conn_ref(conn);
+        memset(&stream.loc, 0, sizeof(stream.loc));
+        stream.entry_len = 0;
+        stream.entry_off = 0;
+        stream.started = false;
+        stream.done = false;
+        stream.abort = false;
+        history_stats.streamed = 0;
+        k_work_submit(&stream_work);
+        break;
+
+    case HISTORY_CTRL_ABORT:
+        stream.abort = true;
+        k_work_submit(&stream_work);
+        break;
+
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+    }
+
+    return len;
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    ARG_UNUSED(reason);
+
+    if (conn == stream.conn) {
+        stream.abort = true;
+        k_work_submit(&stream_work);
+    }
+}
+
+
+BT_CONN_CB_DEFINE(history_conn_callbacks) = {
+    .disconnected = disconnected,
+};
+
+
+static int last_boot_find(struct fcb_entry_ctx *entry_ctx, void *arg)
+{
+    struct history_block_header header;
+    uint16_t *last = arg;
+
+    if (entry_ctx->loc.fe_data_len < sizeof(header)) {
+        return 0;
+    }
+    if (flash_area_read(entry_ctx->fap, FCB_ENTRY_FA_DATA_OFF(entry_ctx->loc), &header, sizeof(header)) == 0 &&
+        header.version == HISTORY_VERSION) {
+        *last = sys_le16_to_cpu(header.boot);
+    }
+    return 0;
+}
+
+
+int history_init(void)
+{
+#if FIXED_PARTITION_EXISTS(history_partition)
+    uint32_t sector_cnt = ARRAY_SIZE(history_sectors);
+    uint16_t last = 0;
+    int err;
+
+    k_work_init(&stream_work, stream_work_handler);
+
+    err = flash_area_get_sectors(FIXED_PARTITION_ID(history_partition), &sector_cnt, history_sectors);
+    if (err) {
+        LOG_ERR("Partition layout failed (err %d)", err);
+        return err;
+    }
+
+    history_fcb.f_magic = HISTORY_FCB_MAGIC;
+    history_fcb.f_version = HISTORY_VERSION;
+    history_fcb.f_sector_cnt = sector_cnt;
+    history_fcb.f_scratch_cnt = 0;
+    history_fcb.f_sectors = history_sectors;
+
+    err = fcb_init(FIXED_PARTITION_ID(history_partition), &history_fcb);
+    if (err) {
+        LOG_ERR("FCB init failed (err %d)", err);
+        return err;
+    }
+
+    fcb_walk(&history_fcb, NULL, last_boot_find, &last);
+    boot = last + 1;
+
+    is_initialized = true;
+    LOG_INF("Initialized, boot %u, %u sectors", boot, sector_cnt);
+    return 0;
+#else
+    return -ENODEV;
+#endif
+}
+
+#endif
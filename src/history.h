@@ -0,0 +1,101 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#define BT_UUID_HISTORY_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0200, 0x000000000000)
+#define BT_UUID_HISTORY_DATA_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0201, 0x000000000000)
+#define BT_UUID_HISTORY_CONTROL_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0202, 0x000000000000)
+
+#define HISTORY_VERSION        1
+#define HISTORY_BLOCK_LEN      128  // samples are kept in RAM until a block of this size is full
+#define HISTORY_TX_INFLIGHT    4    // notifications queued back-to-back during a download
+
+/* Control point opcodes */
+#define HISTORY_CTRL_ABORT     0x00
+#define HISTORY_CTRL_DOWNLOAD  0x01
+
+/* Log layout. Each flash entry is one block:
+ *
+ * struct history_block_header
+ * delta * n, until the end of the entry
+ *
+ * delta, each field an unsigned LEB128 varint:
+ *   (dt_s << 1) | charging    seconds since the previous sample
+ *   zigzag(dmv)               millivolts relative to the previous sample
+ *
+ * A download streams every block as a one byte length followed by the
+ * block, oldest first, over back-to-back notifications on the data
+ * characteristic. A zero length marks the end of the log.
+ */
+struct __packed history_block_header {
+    uint8_t version;
+    uint8_t charging;    // charge state of the first sample
+    uint16_t boot;       // boot counter, uptimes restart from zero on every boot
+    uint32_t uptime_s;   // uptime of the first sample
+    uint16_t mv;         // battery voltage of the first sample
+};
+
+struct history_stats {
+    uint32_t samples;    // samples recorded since boot
+    uint32_t blocks;     // blocks written to flash since boot
+    uint32_t rotations;  // oldest flash sector erased to make room
+    uint32_t streamed;   // bytes sent by the last download
+};
+
+#if defined(CONFIG_FCB)
+
+/**
+ * @brief Open the history partition and find the current boot number.
+ *
+ * @retval 0 if successful. -ENODEV if the build has no history partition.
+ */
+int history_init(void);
+
+/**
+ * @brief Append a battery sample to the log.
+ *
+ * @param[in] mv Battery voltage in millivolts.
+ * @param[in] charging Charge state as reported by the charger.
+ */
+void history_record(uint16_t mv, bool charging);
+
+/**
+ * @brief Write the samples of the block still in RAM to flash, e.g. before
+ *        System OFF. The next sample starts a new block.
+ */
+void history_flush(void);
+
+/**
+ * @brief Gets the log statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void history_stats_get(struct history_stats *stats);
+
+#else
+
+static inline int history_init(void)
+{
+    return -ENODEV;
+}
+
+static inline void history_record(uint16_t mv, bool charging)
+{
+}
+
+static inline void history_flush(void)
+{
+}
+
+static inline void history_stats_get(struct history_stats *stats)
+{
+    *stats = (struct history_stats){ 0 };
+}
+
+#endif
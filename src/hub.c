@@ -0,0 +1,460 @@
+#include "hub.h"
+#include "hid.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME hub
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+static struct bt_uuid_128 hub_service_uuid = BT_UUID_INIT_128(BT_UUID_HUB_SERVICE_VAL);
+static struct bt_uuid_128 hub_keys_uuid = BT_UUID_INIT_128(BT_UUID_HUB_KEYS_VAL);
+
+static bool hub_subscribed;
+
+
+/* Remote role, every unit */
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+
+    hub_subscribed = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("Hub %s\n", hub_subscribed ? "subscribed" : "unsubscribed");
+}
+
+
+BT_GATT_SERVICE_DEFINE(hub_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &hub_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &hub_keys_uuid.uuid,
+        BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_NONE,
+        NULL, NULL, NULL
+    ),
+    BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+);
+
+
+bool hub_forward(uint8_t button_mask)
+{
+    if (!hub_subscribed) {
+        return false;
+    }
+
+    return bt_gatt_notify(NULL, &hub_svc.attrs[2], &button_mask, sizeof(button_mask)) == 0;
+}
+
+
+#if defined(CONFIG_BT_CENTRAL)
+
+/* Hub role */
+
+static struct hub_remote {
+    struct bt_conn *conn;
+    struct bt_gatt_discover_params discover;
+    struct bt_gatt_subscribe_params subscribe;
+    struct hub_remote_stats stats;
+} remotes[HUB_REMOTES_MAX];
+
+static struct bt_conn *connecting;
+static struct k_work scan_work;
+
+static bool pairing_open;
+static struct k_work_delayable pairing_work;
+static uint8_t accept_count; // bonded peers in the controller filter accept list
+
+
+static struct hub_remote *remote_get(struct bt_conn *conn)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(remotes); i++) {
+        if (remotes[i].conn == conn) {
+            return &remotes[i];
+        }
+    }
+    return NULL;
+}
+
+
+static uint8_t remote_source(const struct hub_remote *remote)
+{
+    return 1 + (remote - remotes); // HID_SOURCE_LOCAL is this unit's own buttons
+}
+
+
+static uint8_t keys_notified(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                             const void *data, uint16_t length)
+{
+    struct hub_remote *remote = CONTAINER_OF(params, struct hub_remote, subscribe);
+    timing_t start, end;
+    uint32_t forward_us;
+
+    if (!data) {
+        params->value_handle = 0;
+        return BT_GATT_ITER_STOP;
+    }
+    if (length < 1) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    start = timing_counter_get();
+    hid_source_key_changed(remote_source(remote), *(const uint8_t *)data);
+    end = timing_counter_get();
+
+    forward_us = timing_cycles_to_ns(timing_cycles_get(&start, &end)) / NSEC_PER_USEC;
+    remote->stats.events++;
+    remote->stats.forward_max_us = MAX(remote->stats.forward_max_us, forward_us);
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+static uint8_t keys_discovered(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                               struct bt_gatt_discover_params *params)
+{
+    struct hub_remote *remote = CONTAINER_OF(params, struct hub_remote, discover);
+    const struct bt_gatt_chrc *chrc;
+    int err;
+
+    if (!attr) {
+        LOG_WRN("Remote has no key characteristic\n");
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        return BT_GATT_ITER_STOP;
+    }
+
+    chrc = attr->user_data;
+    remote->subscribe.notify = keys_notified;
+    remote->subscribe.value = BT_GATT_CCC_NOTIFY;
+    remote->subscribe.value_handle = chrc->value_handle;
+    remote->subscribe.ccc_handle = chrc->value_handle + 1; // the CCC follows the value in hub_svc
+
+    err = bt_gatt_subscribe(conn, &remote->subscribe);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Subscribe failed (err %d)", err);
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    }
+
+    return BT_GATT_ITER_STOP;
+}
+
+
+static bool name_matches(struct bt_data *data, void *user_data)
+{
+    bool *match = user_data;
+
+    if (data->type == BT_DATA_NAME_COMPLETE) {
+        *match = data->data_len == DEVICE_NAME_LEN && !memcmp(data->data, DEVICE_NAME, DEVICE_NAME_LEN);
+        return false;
+    }
+    return true;
+}
+
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+    bool match = false;
+    int err;
+
+    // the name is in the scan response of other units
+    if (type != BT_GAP_ADV_TYPE_SCAN_RSP || connecting) {
+        return;
+    }
+    if (!pairing_open && !bt_le_bond_exists(BT_ID_DEFAULT, addr)) {
+        return;
+    }
+
+    bt_data_parse(ad, name_matches, &match);
+    if (!match) {
+        return;
+    }
+
+    err = bt_le_scan_stop();
+    if (err) {
+        return;
+    }
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
+        BT_LE_CONN_PARAM(HUB_INT_MIN, HUB_INT_MAX, 0, HUB_SUP_TIMEOUT), &connecting);
+    if (err) {
+        LOG_WRN("Connect failed (err %d)\n", err);
+        k_work_submit(&scan_work);
+    }
+}
+
+
+static void scan_start(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    // only bonded remotes are reconnected outside the pairing window
+    struct bt_le_scan_param param = {
+        .type = BT_LE_SCAN_TYPE_ACTIVE,
+        .options = pairing_open ? BT_LE_SCAN_OPT_NONE : BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST,
+        .interval = BT_GAP_SCAN_FAST_INTERVAL,
+        .window = BT_GAP_SCAN_FAST_WINDOW,
+    };
+    int err;
+
+    if (connecting || !remote_get(NULL)) {
+        return; // busy, or every remote slot is taken
+    }
+    if (!pairing_open && !accept_count) {
+        return; // nothing bonded to reconnect
+    }
+
+    err = bt_le_scan_start(&param, device_found);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Scan start failed (err %d)", err);
+    }
+}
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    struct hub_remote *remote;
+
+    if (conn != connecting) {
+        return;
+    }
+    connecting = NULL;
+
+    if (err) {
+        bt_conn_unref(conn);
+        k_work_submit(&scan_work);
+        return;
+    }
+
+    remote = remote_get(NULL);
+    remote->conn = conn; // keeps the reference from bt_conn_le_create
+    memset(&remote->stats, 0, sizeof(remote->stats));
+    remote->stats.interval = HUB_INT_MIN;
+
+    if (!pairing_open && !bt_le_bond_exists(BT_ID_DEFAULT, bt_conn_get_dst(conn))) {
+        bt_conn_disconnect(conn, BT_HCI_ERR_AUTH_FAIL);
+        return;
+    }
+
+    // the key characteristic requires an encrypted link, discovery starts once it is
+    if (bt_conn_set_security(conn, BT_SECURITY_L2)) {
+        bt_conn_disconnect(conn, BT_HCI_ERR_AUTH_FAIL);
+    }
+
+    LOG_INF("Remote %u connected\n", remote_source(remote));
+    k_work_submit(&scan_work);
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct hub_remote *remote = remote_get(conn);
+
+    if (!remote) {
+        return;
+    }
+
+    LOG_INF("Remote %u disconnected (reason %u)\n", remote_source(remote), reason);
+
+    // release whatever the remote was holding down
+    hid_source_key_changed(remote_source(remote), 0);
+
+    remote->stats.interval = 0;
+    remote->conn = NULL;
+    bt_conn_unref(conn);
+    k_work_submit(&scan_work);
+}
+
+
+static void security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err)
+{
+    struct hub_remote *remote = remote_get(conn);
+
+    if (!remote) {
+        return;
+    }
+    if (err) {
+        bt_conn_disconnect(conn, BT_HCI_ERR_AUTH_FAIL);
+        return;
+    }
+
+    remote->discover.uuid = &hub_keys_uuid.uuid;
+    remote->discover.func = keys_discovered;
+    remote->discover.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    remote->discover.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    remote->discover.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    if (bt_gatt_discover(conn, &remote->discover)) {
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    }
+}
+
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    ARG_UNUSED(latency);
+    ARG_UNUSED(timeout);
+
+    struct hub_remote *remote = remote_get(conn);
+
+    if (!remote) {
+        return;
+    }
+
+    remote->stats.interval = interval;
+    if (interval > HUB_INT_MAX) {
+        remote->stats.interval_misses++;
+        LOG_WRN("Remote %u at %u units\n", remote_source(remote), interval);
+    }
+}
+
+
+/* Remotes ask for slower parameters when idle, the hub keeps them at 7.5 ms */
+static bool le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
+{
+    if (remote_get(conn)) {
+        param->interval_min = HUB_INT_MIN;
+        param->interval_max = HUB_INT_MAX;
+    }
+    return true;
+}
+
+
+static void pairing_complete(struct bt_conn *conn, bool bonded)
+{
+    const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+
+    if (!remote_get(conn)) {
+        return;
+    }
+
+    // pairing is only accepted inside the window, and only if it leaves a bond
+    if (!pairing_open || !bonded) {
+        LOG_WRN("Remote paired outside the pairing window, dropped\n");
+        bt_conn_disconnect(conn, BT_HCI_ERR_AUTH_FAIL);
+        bt_unpair(BT_ID_DEFAULT, addr);
+        return;
+    }
+
+    if (bt_le_filter_accept_list_add(addr) == 0) {
+        accept_count++;
+    }
+}
+
+
+static struct bt_conn_auth_info_cb auth_info_callbacks = {
+    .pairing_complete = pairing_complete,
+};
+
+
+static void pairing_close(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    pairing_open = false;
+    LOG_INF("Pairing window closed, %u bonded\n", accept_count);
+
+    bt_le_scan_stop();
+    k_work_submit(&scan_work);
+}
+
+
+void hub_pairing_start(void)
+{
+    // the accept list cannot change while the scanner uses it
+    bt_le_scan_stop();
+
+    // the gesture also removed every bond, remotes are paired from scratch
+    if (bt_le_filter_accept_list_clear() == 0) {
+        accept_count = 0;
+    }
+
+    pairing_open = true;
+    k_work_reschedule(&pairing_work, K_MSEC(HUB_PAIR_WINDOW_MS));
+    LOG_INF("Pairing window open\n");
+
+    k_work_submit(&scan_work);
+}
+
+
+BT_CONN_CB_DEFINE(hub_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .security_changed = security_changed,
+    .le_param_updated = le_param_updated,
+    .le_param_req = le_param_req,
+};
+
+
+void hub_remote_stats_get(uint8_t remote, struct hub_remote_stats *stats)
+{
+    *stats = remotes[remote].stats;
+}
+
+
+static void bond_accept(const struct bt_bond_info *info, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    if (bt_le_filter_accept_list_add(&info->addr) == 0) {
+        accept_count++;
+    }
+}
+
+
+int hub_init(void)
+{
+    int err;
+
+    k_work_init(&scan_work, scan_start);
+    k_work_init_delayable(&pairing_work, pairing_close);
+
+    err = bt_conn_auth_info_cb_register(&auth_info_callbacks);
+    if (err) {
+        return err;
+    }
+
+    // bonds are loaded by now, the host's bond is in the list too but never advertises a remote
+    bt_foreach_bond(BT_ID_DEFAULT, bond_accept, NULL);
+
+    timing_init();
+    timing_start();
+
+    k_work_submit(&scan_work);
+
+    LOG_INF("Initialized, %u remotes, %u bonded", HUB_REMOTES_MAX, accept_count);
+    return 0;
+}
+
+#else
+
+void hub_pairing_start(void)
+{
+}
+
+
+void hub_remote_stats_get(uint8_t remote, struct hub_remote_stats *stats)
+{
+    ARG_UNUSED(remote);
+
+    *stats = (struct hub_remote_stats){ 0 };
+}
+
+
+int hub_init(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#define BT_UUID_HUB_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0500, 0x000000000000)
+#define BT_UUID_HUB_KEYS_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0501, 0x000000000000)
+
+/* Hub links in 1.25 ms units, 7.5 ms keeps a forwarded press within one host interval */
+#define HUB_INT_MIN        6
+#define HUB_INT_MAX        6
+#define HUB_SUP_TIMEOUT    400
+
+#define HUB_PAIR_WINDOW_MS 30000 // new remotes are only paired this long after the pairing gesture
+
+#if defined(CONFIG_BT_CENTRAL)
+#define HUB_REMOTES_MAX    (CONFIG_BT_MAX_CONN - 1) // one connection stays with the host
+#else
+#define HUB_REMOTES_MAX    0
+#endif
+
+struct hub_remote_stats {
+    uint32_t events;          // key transitions received from the remote
+    uint16_t interval;        // connection interval granted, 1.25 ms units, 0 when not connected
+    uint16_t interval_misses; // parameter updates that left the link slower than HUB_INT_MAX
+    uint32_t forward_max_us;  // longest time from notification to host report queued
+};
+
+/**
+ * @brief Start the hub. Every unit serves its key state to a hub, units
+ *        built with CONFIG_BT_CENTRAL also scan for and connect to remotes.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int hub_init(void);
+
+/**
+ * @brief Open the window for pairing new remotes.
+ *
+ * Called after the long press removed every bond. Outside the window the
+ * hub only scans for and connects to remotes it is bonded with. A remote
+ * still holding its old bond has to be reset with its own long press to
+ * pair again. No-op on units built without CONFIG_BT_CENTRAL.
+ */
+void hub_pairing_start(void);
+
+/**
+ * @brief Forward a local key transition to the hub this unit is a remote of.
+ *
+ * @retval true if a hub is subscribed and the transition was sent to it.
+ */
+bool hub_forward(uint8_t button_mask);
+
+/**
+ * @brief Gets the statistics of one remote.
+ *
+ * @param[in] remote Remote index, below HUB_REMOTES_MAX.
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void hub_remote_stats_get(uint8_t remote, struct hub_remote_stats *stats);
@@ -0,0 +1,309 @@
+#include "imu.h"
+#include "hid.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME imu
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(st_lsm6dsl)
+
+/* The FIFO is driven directly over I2C, the Zephyr sensor driver reads
+ * one sample per data-ready interrupt and has no FIFO support.
+ */
+#define IMU_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(st_lsm6dsl)
+
+static const struct i2c_dt_spec imu_i2c = I2C_DT_SPEC_GET(IMU_NODE);
+static const struct gpio_dt_spec imu_int1 = GPIO_DT_SPEC_GET(IMU_NODE, irq_gpios);
+
+// LSM6DS3TR-C registers
+#define REG_FIFO_CTRL1      0x06
+#define REG_FIFO_CTRL2      0x07
+#define REG_FIFO_CTRL3      0x08
+#define REG_FIFO_CTRL5      0x0A
+#define REG_INT1_CTRL       0x0D
+#define REG_WHO_AM_I        0x0F
+#define REG_CTRL1_XL        0x10
+#define REG_CTRL2_G         0x11
+#define REG_CTRL3_C         0x12
+#define REG_CTRL6_C         0x15
+#define REG_WAKE_UP_SRC     0x1B
+#define REG_FIFO_STATUS1    0x3A
+#define REG_TAP_CFG         0x58
+#define REG_WAKE_UP_THS     0x5B
+#define REG_WAKE_UP_DUR     0x5C
+#define REG_MD1_CFG         0x5E
+#define REG_FIFO_DATA_OUT_L 0x3E
+
+#define WHO_AM_I_VALUE      0x6A
+#define CTRL3_C_BDU_IF_INC  0x44
+#define CTRL2_G_208HZ_500DPS 0x54
+#define FIFO_CTRL3_GYRO_NO_DEC 0x08
+#define FIFO_CTRL5_208HZ_CONTINUOUS 0x2E
+#define INT1_CTRL_FTH       0x08
+#define FIFO_STATUS2_OVER_RUN 0x40
+#define FIFO_STATUS2_DIFF_MASK 0x07
+#define CTRL1_XL_12HZ5_2G   0x10
+#define CTRL6_C_XL_LOW_POWER 0x10
+#define TAP_CFG_INTERRUPTS_ENABLE 0x80
+#define MD1_CFG_INT1_WU     0x20
+#define WAKE_UP_SRC_WU_IA   0x08
+
+#define IMU_WORDS_PER_SAMPLE 3    // gyro X, Y, Z
+#define IMU_READ_SAMPLES_MAX 16
+
+// Axis mapping depends on how the board sits in the enclosure
+#define IMU_POINTER_X_AXIS  2     // yaw
+#define IMU_POINTER_Y_AXIS  0     // pitch
+#define IMU_POINTER_X_SIGN  (-1)
+#define IMU_POINTER_Y_SIGN  (-1)
+
+static struct gpio_callback imu_cb_data;
+static struct k_work int1_work;
+static struct imu_stats imu_stats;
+static imu_wake_handler_t wake_cb;
+
+static bool pointer_enabled;
+static int32_t acc_x;
+static int32_t acc_y;
+
+
+static int imu_write(uint8_t reg, uint8_t value)
+{
+    return i2c_reg_write_byte_dt(&imu_i2c, reg, value);
+}
+
+
+static void imu_accumulate(const uint8_t *sample)
+{
+    int16_t x = (int16_t)sys_get_le16(&sample[IMU_POINTER_X_AXIS * 2]);
+    int16_t y = (int16_t)sys_get_le16(&sample[IMU_POINTER_Y_AXIS * 2]);
+
+    if (abs(x) >= IMU_DEADZONE_LSB) {
+        acc_x += IMU_POINTER_X_SIGN * x;
+    }
+    if (abs(y) >= IMU_DEADZONE_LSB) {
+        acc_y += IMU_POINTER_Y_SIGN * y;
+    }
+}
+
+
+static int fifo_drain(void)
+{
+    uint8_t data[IMU_READ_SAMPLES_MAX * IMU_WORDS_PER_SAMPLE * 2];
+    uint8_t status[2];
+    uint16_t samples;
+    int16_t dx, dy;
+    int err;
+
+    err = i2c_burst_read_dt(&imu_i2c, REG_FIFO_STATUS1, status, sizeof(status));
+    if (err) {
+        LOG_WRN("FIFO status read failed (err %d)", err);
+        return err;
+    }
+
+    if (status[1] & FIFO_STATUS2_OVER_RUN) {
+        imu_stats.overruns++;
+    }
+    samples = (status[0] | ((status[1] & FIFO_STATUS2_DIFF_MASK) << 8)) / IMU_WORDS_PER_SAMPLE;
+    imu_stats.batches++;
+
+    while (samples) {
+        uint16_t n = MIN(samples, IMU_READ_SAMPLES_MAX);
+
+        // FIFO_DATA_OUT rolls back to its first byte, so one burst reads n samples
+        err = i2c_burst_read_dt(&imu_i2c, REG_FIFO_DATA_OUT_L, data, n * IMU_WORDS_PER_SAMPLE * 2);
+        if (err) {
+            LOG_WRN("FIFO read failed (err %d)", err);
+            return err;
+        }
+
+        for (uint16_t i = 0; i < n; i++) {
+            imu_accumulate(&data[i * IMU_WORDS_PER_SAMPLE * 2]);
+        }
+        imu_stats.samples += n;
+        samples -= n;
+    }
+
+    if (!pointer_enabled) {
+        return 0;
+    }
+
+    dx = acc_x / IMU_LSB_PER_COUNT;
+    dy = acc_y / IMU_LSB_PER_COUNT;
+    acc_x -= dx * IMU_LSB_PER_COUNT;
+    acc_y -= dy * IMU_LSB_PER_COUNT;
+
+    if (dx || dy) {
+        hid_pointer_motion(dx, dy);
+    }
+    return 0;
+}
+
+
+/* INT1 is the only IMU line wired on the board, it carries both the FIFO
+ * threshold and the wake-up interrupt. The threshold signal is a level that
+ * stays high while the FIFO holds a batch, so a batch completed during the
+ * drain gives no new edge; the line is checked again once drained.
+ */
+static void int1_handler(struct k_work *work)
+{
+    uint8_t wake_src = 0;
+
+    if (wake_cb && i2c_reg_read_byte_dt(&imu_i2c, REG_WAKE_UP_SRC, &wake_src) == 0 &&
+        (wake_src & WAKE_UP_SRC_WU_IA)) {
+        wake_cb();
+    }
+
+    if (pointer_enabled && fifo_drain() == 0 && gpio_pin_get_dt(&imu_int1) > 0) {
+        imu_stats.rechecks++;
+        k_work_submit(work);
+    }
+}
+
+
+static void imu_int1_triggered(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    k_work_submit(&int1_work);
+}
+
+
+int imu_wake_enable(imu_wake_handler_t handler)
+{
+    int err = 0;
+
+    wake_cb = handler;
+
+    if (handler) {
+        err |= imu_write(REG_CTRL6_C, CTRL6_C_XL_LOW_POWER);
+        err |= imu_write(REG_CTRL1_XL, CTRL1_XL_12HZ5_2G);
+        err |= imu_write(REG_WAKE_UP_THS, IMU_WAKE_THS & 0x3f);
+        err |= imu_write(REG_WAKE_UP_DUR, (IMU_WAKE_DUR & 0x03) << 5);
+        err |= imu_write(REG_TAP_CFG, TAP_CFG_INTERRUPTS_ENABLE);
+        err |= imu_write(REG_MD1_CFG, MD1_CFG_INT1_WU);
+    } else {
+        err |= imu_write(REG_MD1_CFG, 0);
+        err |= imu_write(REG_TAP_CFG, 0);
+        err |= imu_write(REG_CTRL1_XL, 0);
+    }
+
+    return err ? -EIO : 0;
+}
+
+
+int imu_pointer_enable(bool enable)
+{
+    int err = 0;
+
+    if (enable == pointer_enabled) {
+        return 0;
+    }
+    pointer_enabled = enable;
+    acc_x = 0;
+    acc_y = 0;
+
+    if (enable) {
+        err |= imu_write(REG_CTRL2_G, CTRL2_G_208HZ_500DPS);
+        err |= imu_write(REG_FIFO_CTRL5, FIFO_CTRL5_208HZ_CONTINUOUS);
+    } else {
+        // bypass mode empties the FIFO, power-down stops the gyro
+        err |= imu_write(REG_FIFO_CTRL5, 0);
+        err |= imu_write(REG_CTRL2_G, 0);
+    }
+
+    LOG_INF("Pointer mode %s", enable ? "on" : "off");
+    return err;
+}
+
+
+int imu_init(void)
+{
+    uint16_t threshold = IMU_FIFO_BATCH * IMU_WORDS_PER_SAMPLE;
+    uint8_t who_am_i = 0;
+    int err = 0;
+
+    if (!device_is_ready(imu_i2c.bus) || !device_is_ready(imu_int1.port)) {
+        return -EIO;
+    }
+
+    err = i2c_reg_read_byte_dt(&imu_i2c, REG_WHO_AM_I, &who_am_i);
+    if (err || who_am_i != WHO_AM_I_VALUE) {
+        LOG_ERR("IMU not found (err %d, id 0x%02x)", err, who_am_i);
+        return -ENODEV;
+    }
+
+    err |= imu_write(REG_CTRL3_C, CTRL3_C_BDU_IF_INC);
+    err |= imu_write(REG_FIFO_CTRL1, threshold & 0xff);
+    err |= imu_write(REG_FIFO_CTRL2, (threshold >> 8) & 0x07);
+    err |= imu_write(REG_FIFO_CTRL3, FIFO_CTRL3_GYRO_NO_DEC);
+    err |= imu_write(REG_INT1_CTRL, INT1_CTRL_FTH);
+    if (err) {
+        LOG_ERR("IMU configure failed!");
+        return -EIO;
+    }
+
+    k_work_init(&int1_work, int1_handler);
+
+    err = gpio_pin_configure_dt(&imu_int1, GPIO_INPUT);
+    if (err) {
+        return err;
+    }
+    err = gpio_pin_interrupt_configure_dt(&imu_int1, GPIO_INT_EDGE_TO_ACTIVE);
+    if (err) {
+        return err;
+    }
+    gpio_init_callback(&imu_cb_data, imu_int1_triggered, BIT(imu_int1.pin));
+    err = gpio_add_callback(imu_int1.port, &imu_cb_data);
+    if (err) {
+        return err;
+    }
+
+    LOG_INF("Initialized");
+    return 0;
+}
+
+
+void imu_stats_get(struct imu_stats *stats)
+{
+    *stats = imu_stats;
+}
+
+#else
+
+int imu_init(void)
+{
+    return -ENODEV;
+}
+
+
+int imu_pointer_enable(bool enable)
+{
+    ARG_UNUSED(enable);
+
+    return -ENODEV;
+}
+
+
+int imu_wake_enable(imu_wake_handler_t handler)
+{
+    ARG_UNUSED(handler);
+
+    return -ENODEV;
+}
+
+
+void imu_stats_get(struct imu_stats *stats)
+{
+    *stats = (struct imu_stats){ 0 };
+}
+
+#endif
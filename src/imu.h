@@ -0,0 +1,54 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define IMU_ODR_HZ           208  // gyro output data rate
+#define IMU_FIFO_BATCH       3    // gyro samples per FIFO threshold interrupt (~14 ms)
+#define IMU_DEADZONE_LSB     200  // ignore rotation below ~3.5 dps so a resting hand does not drift
+#define IMU_LSB_PER_COUNT    600  // accumulated gyro LSB per pointer count, sets the pointer speed
+#define IMU_WAKE_THS         3    // wake-up threshold in FS/64 steps, ~94 mg at +-2 g
+#define IMU_WAKE_DUR         2    // samples above threshold (12.5 Hz) before wake-up fires
+
+typedef void (*imu_wake_handler_t)(void);
+
+struct imu_stats {
+    uint32_t batches;     // FIFO threshold interrupts served
+    uint32_t samples;     // gyro samples read from the FIFO
+    uint32_t overruns;    // FIFO overflowed before it was drained
+    uint32_t rechecks;    // threshold still active after a drain, served without an edge
+};
+
+/**
+ * @brief Initialize the IMU and its hardware FIFO.
+ *
+ * @retval 0 if successful. -ENODEV on boards without the IMU.
+ */
+int imu_init(void);
+
+/**
+ * @brief Start or stop streaming gyro motion to the pointer report.
+ *
+ * The gyro is powered down while pointer mode is off.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int imu_pointer_enable(bool enable);
+
+/**
+ * @brief Enable the accelerometer wake-up interrupt.
+ *
+ * The accelerometer runs in low-power mode at 12.5 Hz and the handler is
+ * called from the system workqueue when the device is moved.
+ *
+ * @param[in] handler Called on wake-up, NULL to disable.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int imu_wake_enable(imu_wake_handler_t handler);
+
+/**
+ * @brief Gets the FIFO statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void imu_stats_get(struct imu_stats *stats);
@@ -0,0 +1,301 @@
+#include "link.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME link
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define LINK_TX_FIFO_LEN 8
+
+/* Packets complete in the order they were queued, so a small FIFO of queue
+ * timestamps per connection is enough to time every acknowledgement. Each
+ * stamp keeps the event interval it was queued under: a packet queued on a
+ * subrated or idle link waits for that interval even if the link is fast
+ * again by the time it completes.
+ */
+static struct link_ctx {
+    struct link_quality quality;
+    uint32_t interval_us;
+    uint16_t subrate;    // connection events per subrated event, 1 when not subrated
+    uint32_t tx_stamp[LINK_TX_FIFO_LEN];
+    uint32_t tx_event_us[LINK_TX_FIFO_LEN];
+    uint8_t tx_head;
+    uint8_t tx_count;
+} link_ctx[CONFIG_BT_MAX_CONN];
+
+static struct k_spinlock link_lock;
+static sys_slist_t link_cbs = SYS_SLIST_STATIC_INIT(&link_cbs);
+static struct k_work_delayable sample_work;
+static uint8_t conn_count;
+
+
+static struct link_ctx *link_ctx_get(struct bt_conn *conn)
+{
+    return &link_ctx[bt_conn_index(conn)];
+}
+
+
+static void link_interval_update(struct bt_conn *conn)
+{
+    struct bt_conn_info info;
+
+    if (bt_conn_get_info(conn, &info) == 0) {
+        link_ctx_get(conn)->interval_us = info.le.interval * 1250U;
+    }
+}
+
+
+/* Time between the connection events the peripheral actually attends */
+static uint32_t link_event_us(const struct link_ctx *ctx)
+{
+    return ctx->interval_us * MAX(ctx->subrate, 1);
+}
+
+
+void link_cb_register(struct link_cb *cb)
+{
+    sys_slist_append(&link_cbs, &cb->node);
+}
+
+
+int link_read_rssi(struct bt_conn *conn, int8_t *rssi)
+{
+    struct net_buf *buf, *rsp = NULL;
+    struct bt_hci_cp_read_rssi *cp;
+    struct bt_hci_rp_read_rssi *rp;
+    uint16_t handle;
+    int err;
+
+    err = bt_hci_get_conn_handle(conn, &handle);
+    if (err) {
+        return err;
+    }
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle = sys_cpu_to_le16(handle);
+
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+    if (err) {
+        return err;
+    }
+
+    rp = (void *)rsp->data;
+    *rssi = rp->rssi;
+    net_buf_unref(rsp);
+
+    return 0;
+}
+
+
+void link_tx_queued(struct bt_conn *conn)
+{
+    struct link_ctx *ctx = link_ctx_get(conn);
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+    if (ctx->tx_count == LINK_TX_FIFO_LEN) {
+        // drop the oldest stamp, its completion will be timed short
+        ctx->tx_head = (ctx->tx_head + 1) % LINK_TX_FIFO_LEN;
+        ctx->tx_count--;
+    }
+    ctx->tx_stamp[(ctx->tx_head + ctx->tx_count) % LINK_TX_FIFO_LEN] = k_cycle_get_32();
+    ctx->tx_event_us[(ctx->tx_head + ctx->tx_count) % LINK_TX_FIFO_LEN] = link_event_us(ctx);
+    ctx->tx_count++;
+
+    k_spin_unlock(&link_lock, key);
+}
+
+
+void link_tx_failed(struct bt_conn *conn)
+{
+    struct link_ctx *ctx = link_ctx_get(conn);
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+    if (ctx->tx_count) {
+        ctx->tx_count--; // forget the stamp pushed by link_tx_queued()
+    }
+    ctx->quality.tx_failed++;
+
+    k_spin_unlock(&link_lock, key);
+}
+
+
+void link_tx_complete(struct bt_conn *conn, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    struct link_ctx *ctx = link_ctx_get(conn);
+    struct link_cb *cb;
+    bool late = false;
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+    if (ctx->tx_count) {
+        uint32_t elapsed_us = k_cyc_to_us_floor32(k_cycle_get_32() - ctx->tx_stamp[ctx->tx_head]);
+        // the slower of the event intervals at queueing and now, across a subrate or parameter change
+        uint32_t event_us = MAX(ctx->tx_event_us[ctx->tx_head], link_event_us(ctx));
+
+        ctx->tx_head = (ctx->tx_head + 1) % LINK_TX_FIFO_LEN;
+        ctx->tx_count--;
+
+        if (event_us && elapsed_us > LINK_TX_LATE_INTERVALS * event_us) {
+            ctx->quality.tx_late++;
+            late = true;
+        }
+    }
+    ctx->quality.tx_done++;
+
+    k_spin_unlock(&link_lock, key);
+
+    if (!late) {
+        return;
+    }
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&link_cbs, cb, node) {
+        if (cb->tx_late) {
+            cb->tx_late(conn);
+        }
+    }
+}
+
+
+static void link_sample_conn(struct bt_conn *conn, void *data)
+{
+    ARG_UNUSED(data);
+
+    struct bt_conn_info info;
+    struct link_quality quality;
+    struct link_ctx *ctx;
+    struct link_cb *cb;
+    k_spinlock_key_t key;
+    int8_t rssi;
+
+    if (bt_conn_get_info(conn, &info) || info.state != BT_CONN_STATE_CONNECTED) {
+        return;
+    }
+
+    if (link_read_rssi(conn, &rssi)) {
+        rssi = LINK_RSSI_UNKNOWN;
+    }
+
+    ctx = link_ctx_get(conn);
+    key = k_spin_lock(&link_lock);
+    quality = ctx->quality;
+    memset(&ctx->quality, 0, sizeof(ctx->quality));
+    k_spin_unlock(&link_lock, key);
+
+    quality.rssi = rssi;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&link_cbs, cb, node) {
+        if (cb->sampled) {
+            cb->sampled(conn, &quality);
+        }
+    }
+}
+
+
+static void link_sample(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    bt_conn_foreach(BT_CONN_TYPE_LE, link_sample_conn, NULL);
+
+    if (conn_count) {
+        k_work_reschedule(&sample_work, K_MSEC(LINK_SAMPLE_INTERVAL_MS));
+    }
+}
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err) {
+        return;
+    }
+
+    struct link_ctx *ctx = link_ctx_get(conn);
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+    memset(ctx, 0, sizeof(*ctx));
+
+    k_spin_unlock(&link_lock, key);
+
+    link_interval_update(conn);
+
+    if (conn_count++ == 0) {
+        k_work_reschedule(&sample_work, K_MSEC(LINK_SAMPLE_INTERVAL_MS));
+    }
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(reason);
+
+    if (conn_count && --conn_count == 0) {
+        k_work_cancel_delayable(&sample_work);
+    }
+}
+
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    ARG_UNUSED(latency);
+    ARG_UNUSED(timeout);
+
+    struct link_ctx *ctx = link_ctx_get(conn);
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+    ctx->interval_us = interval * 1250U;
+
+    k_spin_unlock(&link_lock, key);
+}
+
+
+#if defined(CONFIG_BT_SUBRATING)
+static void subrate_changed(struct bt_conn *conn, const struct bt_conn_le_subrate_changed *params)
+{
+    struct link_ctx *ctx = link_ctx_get(conn);
+    k_spinlock_key_t key;
+
+    if (params->status) {
+        return;
+    }
+
+    key = k_spin_lock(&link_lock);
+    ctx->subrate = params->factor;
+    k_spin_unlock(&link_lock, key);
+}
+#endif
+
+
+BT_CONN_CB_DEFINE(link_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+#if defined(CONFIG_BT_SUBRATING)
+    .subrate_changed = subrate_changed,
+#endif
+};
+
+
+static int link_init(void)
+{
+    k_work_init_delayable(&sample_work, link_sample);
+    return 0;
+}
+
+SYS_INIT(link_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <zephyr/sys/slist.h>
+
+struct bt_conn;
+
+#define LINK_SAMPLE_INTERVAL_MS 2000
+#define LINK_TX_LATE_INTERVALS  3    // completions slower than this needed at least one retransmission
+#define LINK_RSSI_UNKNOWN       127  // HCI value for "RSSI not available"
+
+/* Link quality observed on one connection since the previous sample. */
+struct link_quality {
+    int8_t rssi;        // dBm, LINK_RSSI_UNKNOWN if it could not be read
+    uint16_t tx_done;   // packets acknowledged by the peer
+    uint16_t tx_late;   // acknowledged packets that needed retransmission
+    uint16_t tx_failed; // packets the stack refused to queue
+};
+
+struct link_cb {
+    /**
+     * @brief Called from the system workqueue every LINK_SAMPLE_INTERVAL_MS
+     *        for each connection.
+     */
+    void (*sampled)(struct bt_conn *conn, const struct link_quality *quality);
+
+    /**
+     * @brief Called from the Bluetooth TX context as soon as a packet needed
+     *        retransmission. Optional, must not block.
+     */
+    void (*tx_late)(struct bt_conn *conn);
+
+    sys_snode_t node;
+};
+
+/**
+ * @brief Register for periodic link quality samples.
+ *
+ * @param[in] cb Callback structure, must stay valid forever.
+ */
+void link_cb_register(struct link_cb *cb);
+
+/**
+ * @brief Read the current RSSI of a connection from the controller.
+ *
+ * @param[in] conn Connection to read.
+ * @param[out] rssi RSSI in dBm.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int link_read_rssi(struct bt_conn *conn, int8_t *rssi);
+
+/**
+ * @brief Note that a packet was queued for transmission.
+ *
+ * Must be paired with link_tx_complete() as the send completion callback,
+ * or with link_tx_failed() if the stack did not accept the packet.
+ */
+void link_tx_queued(struct bt_conn *conn);
+void link_tx_failed(struct bt_conn *conn);
+void link_tx_complete(struct bt_conn *conn, void *user_data);
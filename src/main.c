@@ -4,25 +4,75 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/settings/settings.h>
 
+#include <stdlib.h>
+
 #include "battery.h"
 #include "bas.h"
 #include "hid.h"
 #include "gpio.h"
+#include "phy.h"
+#include "txpower.h"
+#include "telemetry.h"
+#include "imu.h"
+#include "wake.h"
+#include "power.h"
+#include "dfu.h"
+#include "periodic.h"
+#include "history.h"
+#include "blelog.h"
+#include "hub.h"
+#include "broadcast.h"
+#include "usbhid.h"
+#include "governor.h"
+#include "params.h"
+#include "edge.h"
 
 #include <zephyr/logging/log.h>
 #define LOG_MODULE_NAME app
 LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
 
+#define BLINK_SLACK_MS     50     // visible jitter limit on the status LED
+#define BATTERY_SLACK_MS   2000   // battery readings may ride on another job's wake-up
+#define BATTERY_STABLE_MV  20     // discharging samples closer than this slow the battery poll down
+#define BATTERY_IDLE_PERIOD_MS (15 * 60 * MSEC_PER_SEC) // slowed poll, still catches a draining cell
+#define CHARGE_LED_PERIOD_MS 2000 // slow toggle on the status LED while charging
+#define CHARGE_LED_SLACK_MS  200
+#define APP_MSGQ_LEN       8
+
+/* Button, connection, power state and parameter changes share one queue so
+ * they are handled in the order they happened.
+ */
+enum app_msg_type {
+    APP_MSG_BUTTON = 0,
+    APP_MSG_CONNECTION,
+    APP_MSG_POWER_STATE,
+    APP_MSG_PARAMS,
+    APP_MSG_COUNT
+};
+
+struct app_msg {
+    uint8_t type;
+    uint8_t value;
+};
+
+K_MSGQ_DEFINE(app_msgq, sizeof(struct app_msg), APP_MSGQ_LEN, 1);
+
+static struct k_poll_signal charge_signal = K_POLL_SIGNAL_INITIALIZER(charge_signal);
+
 /* callbacks & services */
-static struct k_work_delayable blink_work;
-static struct k_work_delayable battery_update_work;
+static struct periodic_job blink_job;
+static struct periodic_job battery_update_job;
+static struct periodic_job charge_led_job;
 
-static float battery_voltage;
+static int battery_millivolt;
 static int battery_percentage;
-static int battery_charge_state;
+static int battery_charge_state = -1; // unknown until the first charge update
+static bool vbus_present;
+static bool init_failed;  // reported as ADV_STATUS_ERROR
 
 static uint8_t btn_state = 0;
+static bool has_imu;
 
 static void button_handler(uint8_t button_mask)
 {
@@ -34,70 +84,299 @@ static void button_handler(uint8_t button_mask)
     }
     btn_state = button_mask;
 
+    if (button_mask) {
+        wake_input();
+        power_event(POWER_EVT_INPUT);
+    }
+
     if (button_mask & 0b100) {
         // long press detected
         bt_unpair(BT_ID_DEFAULT, BT_ADDR_LE_ANY);
         gpio_status_led_off();
         advertising_start();
+        hub_pairing_start(); // a hub pairs its remotes again as well
     } else {
-        if (is_advertising()) {
-            return;
+        // while advertising the LED belongs to blink(), presses are buffered by hid.c
+        if (!is_advertising() && governor_policy_get()->led) {
+            if (button_mask) {
+                gpio_status_led_on();
+            } else {
+                gpio_status_led_off();
+            }
         }
 
-        if (button_mask) {
-            gpio_status_led_on();
-        } else {
-            gpio_status_led_off();
-        }
+        broadcast_key_changed(button_mask);
 
-        err = hid_key_changed(button_mask);
+        // a remote of a hub sends its presses to the hub instead of a host
+        err = hub_forward(button_mask) ? 0 : hid_key_changed(button_mask);
         if (err) {
             LOG_ERR("Unable to update keys (err: %d)\n", err);
+        } else {
+            edge_latency_record();
         }
     }
 }
 
-static void connection_changed_handler(uint8_t state)
+static void connection_handler(uint8_t state)
 {
+    if (has_imu) {
+        imu_pointer_enable(state == 1);
+    }
+
     if (state == 1) {
-        gpio_status_led_off();
-        k_work_cancel_delayable(&blink_work);
+        power_event(POWER_EVT_CONNECTED);
     } else {
-        k_work_schedule(&blink_work, K_NO_WAIT);
+        power_event(POWER_EVT_DISCONNECTED);
+        if (governor_policy_get()->telemetry) {
+            telemetry_log(); // record resource usage at the end of every session
+        }
     }
 }
 
-static void battery_update(struct k_work *work)
+static uint32_t battery_interval_ms(void)
+{
+    return power_battery_interval_s() * governor_policy_get()->battery_interval_mul * MSEC_PER_SEC;
+}
+
+static void blink_update(bool advertising)
+{
+    uint16_t period_ms = governor_tier_get() == GOVERNOR_TIER_NORMAL ?
+        params_get()->blink_ms : governor_policy_get()->blink_period_ms;
+
+    if (advertising && period_ms) {
+        periodic_start(&blink_job, 0, period_ms);
+    } else {
+        periodic_stop(&blink_job);
+        gpio_status_led_off();
+    }
+}
+
+static void power_state_handler(uint8_t state)
+{
+    blink_update(state == POWER_STATE_ADVERTISING);
+
+    // asleep, a press wakes the device first and its edges need no timestamps
+    edge_enable(state != POWER_STATE_SLEEP);
+
+    // every state change takes a fresh sample and restarts the poll at the new interval
+    periodic_start(&battery_update_job, 0, battery_interval_ms());
+}
+
+static void params_handler(uint8_t unused)
+{
+    ARG_UNUSED(unused);
+
+    // new intervals apply now, debounce and ADC settings on their next use
+    blink_update(is_advertising());
+    periodic_start(&battery_update_job, 0, battery_interval_ms());
+}
+
+static void governor_tier_changed(enum governor_tier tier)
+{
+    const struct governor_policy *policy = governor_policy_get();
+
+    blink_update(is_advertising());
+    if (!policy->led) {
+        periodic_stop(&charge_led_job);
+    } else if (battery_charge_state > 0) {
+        periodic_start(&charge_led_job, 0, CHARGE_LED_PERIOD_MS);
+    }
+
+    periodic_period_set(&battery_update_job, battery_interval_ms());
+}
+
+static void battery_update(void)
 {
     int err;
+    int previous_mv = battery_millivolt;
 
-    battery_get_voltage(&battery_voltage);
-    battery_get_percentage(&battery_percentage, battery_voltage);
+    battery_get_millivolt(&battery_millivolt);
+    battery_get_percentage(&battery_percentage, battery_millivolt);
     bas_set_battery_level(battery_percentage);
 
-    battery_get_charge_state(&battery_charge_state);
-    bas_set_charge_status(battery_charge_state);
+    bas_set_charge_status(battery_charge_state > 0);
+    history_record(battery_millivolt, battery_charge_state > 0);
+    governor_battery_update(battery_percentage, battery_charge_state > 0 || vbus_present);
+    advertising_status_set(battery_millivolt,
+                           (battery_charge_state > 0 ? ADV_STATUS_CHARGING : 0) |
+                           (vbus_present ? ADV_STATUS_VBUS : 0) |
+                           (init_failed ? ADV_STATUS_ERROR : 0));
 
-    // if (battery_charge_state == 0) {
-    //     return; // break early if battery is not charging
-    // }
+    if (battery_percentage < POWER_BATTERY_CRITICAL && battery_charge_state == 0) {
+        power_event(POWER_EVT_BATTERY_CRITICAL);
+    }
 
     err = bas_notify();
     if (err) {
         LOG_ERR("bas_notify failed with rc = %d\n", err);
     }
 
-    k_work_reschedule(&battery_update_work, K_SECONDS(10));
+    // charge edges and power state changes restart the poll at the normal interval; a steady
+    // cell is still sampled now and then so BAS, the beacon and the governor tiers follow the
+    // discharge. Below the normal tier the governor needs every sample.
+    if (battery_charge_state == 0 && !vbus_present && governor_tier_get() == GOVERNOR_TIER_NORMAL &&
+        abs(battery_millivolt - previous_mv) < BATTERY_STABLE_MV) {
+        periodic_period_set(&battery_update_job, MAX(BATTERY_IDLE_PERIOD_MS, battery_interval_ms()));
+    } else {
+        periodic_period_set(&battery_update_job, battery_interval_ms());
+    }
 }
 
-static void blink(struct k_work *work)
+static void charge_led(void)
 {
-    if (is_advertising()) {
-        gpio_status_led_toggle();
+    if (!is_advertising()) {
+        gpio_status_led_toggle(); // while advertising the LED belongs to blink()
+    }
+}
+
+static void charge_update(void)
+{
+    static bool vbus_seen;
+    int charge_state;
+
+    k_poll_signal_reset(&charge_signal);
+
+    battery_get_charge_state(&charge_state);
+    if (charge_state == battery_charge_state) {
+        if (vbus_present != vbus_seen) {
+            vbus_seen = vbus_present;
+            periodic_start(&battery_update_job, 0, battery_interval_ms());
+        }
+        return;
+    }
+    battery_charge_state = charge_state;
+    vbus_seen = vbus_present;
+
+    LOG_INF("Charging %s\n", charge_state ? "started" : "stopped");
+    hid_charging_changed(charge_state);
+
+    if (charge_state && governor_policy_get()->led) {
+        periodic_start(&charge_led_job, 0, CHARGE_LED_PERIOD_MS);
     } else {
+        periodic_stop(&charge_led_job);
+        if (!is_advertising()) {
+            gpio_status_led_off();
+        }
+    }
+
+    // immediate BAS status update, then poll while the level moves
+    periodic_start(&battery_update_job, 0, battery_interval_ms());
+}
+
+static void charge_changed(void)
+{
+    k_poll_signal_raise(&charge_signal, 0); // from the charge status pin interrupt
+}
+
+static void vbus_changed(bool present)
+{
+    vbus_present = present;
+    k_poll_signal_raise(&charge_signal, 0);
+}
+
+static void blink(void)
+{
+    if (!is_advertising()) {
         gpio_status_led_off();
+        periodic_stop(&blink_job);
+        return;
+    }
+    gpio_status_led_toggle();
+}
+
+static void app_msg_put(enum app_msg_type type, uint8_t value)
+{
+    struct app_msg msg = { .type = type, .value = value };
+
+    if (k_msgq_put(&app_msgq, &msg, K_NO_WAIT)) {
+        LOG_WRN("Event %u dropped\n", type);
+    }
+}
+
+static void button_changed(uint8_t button_mask)
+{
+    app_msg_put(APP_MSG_BUTTON, button_mask); // from the debounce work
+}
+
+static void connection_changed(uint8_t state)
+{
+    app_msg_put(APP_MSG_CONNECTION, state); // from the BT RX thread
+}
+
+static void power_state_changed(enum power_state state)
+{
+    app_msg_put(APP_MSG_POWER_STATE, state); // from the power policy work
+}
+
+static void params_changed(void)
+{
+    app_msg_put(APP_MSG_PARAMS, 0); // from the BT RX thread
+}
+
+static void (*const app_msg_handlers[APP_MSG_COUNT])(uint8_t value) = {
+    [APP_MSG_BUTTON] = button_handler,
+    [APP_MSG_CONNECTION] = connection_handler,
+    [APP_MSG_POWER_STATE] = power_state_handler,
+    [APP_MSG_PARAMS] = params_handler,
+};
+
+static void app_msgs_dispatch(void)
+{
+    struct app_msg msg;
+
+    while (k_msgq_get(&app_msgq, &msg, K_NO_WAIT) == 0) {
+        app_msg_handlers[msg.type](msg.value);
+    }
+}
+
+
+/* Application event loop. Everything the application does after boot runs
+ * here, one event at a time, in the main thread instead of the system
+ * workqueue: queued button, connection and power state changes, charge
+ * edges, and the periodic jobs, whose next deadline is the poll timeout.
+ */
+enum {
+    APP_EVT_MSG = 0,
+    APP_EVT_CHARGE,
+    APP_EVT_PERIODIC,
+    APP_EVT_COUNT
+};
+
+static struct k_poll_event app_events[APP_EVT_COUNT];
+
+static void (*const app_event_handlers[APP_EVT_COUNT])(void) = {
+    [APP_EVT_MSG] = app_msgs_dispatch,
+    [APP_EVT_CHARGE] = charge_update,
+    [APP_EVT_PERIODIC] = NULL, // only wakes the loop, jobs run at the top of every pass
+};
+
+static void app_loop(void)
+{
+    int err;
+
+    k_poll_event_init(&app_events[APP_EVT_MSG], K_POLL_TYPE_MSGQ_DATA_AVAILABLE,
+                      K_POLL_MODE_NOTIFY_ONLY, &app_msgq);
+    k_poll_event_init(&app_events[APP_EVT_CHARGE], K_POLL_TYPE_SIGNAL,
+                      K_POLL_MODE_NOTIFY_ONLY, &charge_signal);
+    periodic_poll_event_init(&app_events[APP_EVT_PERIODIC]);
+
+    for (;;) {
+        err = k_poll(app_events, ARRAY_SIZE(app_events), periodic_process());
+        if (err && err != -EAGAIN) {
+            LOG_ERR("Event poll failed (err: %d)\n", err);
+            continue;
+        }
+
+        for (size_t i = 0; i < ARRAY_SIZE(app_events); i++) {
+            if (app_events[i].state == K_POLL_STATE_NOT_READY) {
+                continue;
+            }
+            app_events[i].state = K_POLL_STATE_NOT_READY;
+            if (app_event_handlers[i]) {
+                app_event_handlers[i]();
+            }
+        }
     }
-    k_work_schedule(&blink_work, K_MSEC(500));
 }
 
 
@@ -108,16 +387,51 @@ int main(void)
 
     k_sleep(K_MSEC(3000)); // boot cooldown
 
+    blelog_init();
+
     LOG_INF("Starting Bluetooth Peripheral HIDS keyboard example\n");
 
     battery_init();
 
-    err = gpio_init(button_handler);
+    err = history_init();
+    if (err && err != -ENODEV) {
+        LOG_ERR("Failed to initialize battery history (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    err = gpio_init(button_changed);
     if (err) {
         LOG_ERR("Failed to initialize GPIO (err: %d)\n", err);
+        init_failed = true;
     }
 
-    hid_init(connection_changed_handler);
+    hid_init(connection_changed);
+    params_init(params_changed);
+
+    err = imu_init();
+    if (err && err != -ENODEV) {
+        LOG_ERR("Failed to initialize IMU (err: %d)\n", err);
+        init_failed = true;
+    }
+    has_imu = (err == 0);
+
+    err = wake_init();
+    if (err) {
+        LOG_ERR("Failed to initialize pick-up detection (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    err = phy_init();
+    if (err) {
+        LOG_ERR("Failed to initialize PHY policy (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    err = txpower_init();
+    if (err) {
+        LOG_ERR("Failed to initialize TX power control (err: %d)\n", err);
+        init_failed = true;
+    }
 
     err = bt_enable(NULL);
     if (err) {
@@ -131,16 +445,55 @@ int main(void)
         settings_load();
     }
 
-    k_work_init_delayable(&battery_update_work, battery_update);
-    k_work_schedule(&battery_update_work, K_NO_WAIT);
+    periodic_job_init(&battery_update_job, battery_update, BATTERY_SLACK_MS);
+    periodic_job_init(&blink_job, blink, BLINK_SLACK_MS);
+    periodic_job_init(&charge_led_job, charge_led, CHARGE_LED_SLACK_MS);
+
+    err = power_init(power_state_changed);
+    if (err) {
+        LOG_ERR("Failed to initialize power policy (err: %d)\n", err);
+        init_failed = true;
+    }
+    edge_enable(power_state_get() != POWER_STATE_SLEEP);
+
+    err = battery_charge_handler_set(charge_changed);
+    if (err) {
+        LOG_ERR("Failed to enable charge interrupt (err: %d)\n", err);
+        init_failed = true;
+    }
+    usbhid_vbus_handler_set(vbus_changed);
+    k_poll_signal_raise(&charge_signal, 0); // first charge state read
 
-    k_work_init_delayable(&blink_work, blink);
-    k_work_schedule(&blink_work, K_NO_WAIT);
+    err = governor_init(governor_tier_changed);
+    if (err) {
+        LOG_ERR("Failed to initialize governor (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    periodic_start(&battery_update_job, 0, battery_interval_ms());
+    blink_update(true);
 
     advertising_start();
 
-    // idle loop
-    for (;;) {
-        k_sleep(K_FOREVER);
+    err = broadcast_init();
+    if (err) {
+        LOG_ERR("Failed to initialize broadcast (err: %d)\n", err);
+        init_failed = true;
     }
+
+    err = hub_init();
+    if (err) {
+        LOG_ERR("Failed to initialize hub (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    err = dfu_init();
+    if (err) {
+        LOG_ERR("Failed to initialize DFU (err: %d)\n", err);
+        init_failed = true;
+    }
+
+    app_loop();
+
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "params.h"
+#include "battery.h"
+#include "gpio.h"
+#include "power.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/settings/settings.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME params
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "struct params is sent as is");
+
+#define PARAMS_SETTINGS_KEY "params/values"
+
+static const struct params params_default = {
+    .version = PARAMS_VERSION,
+    .adc_samples = BATTERY_ADC_SAMPLES_DEFAULT,
+    .debounce_ms = GPIO_SW_DEBOUNCE_MS,
+    .longpress_ms = GPIO_SW_LONGPRESS_MS,
+    .battery_interval_s = POWER_BATTERY_ACTIVE_S,
+    .blink_ms = 500,
+    .adv_fast_int_min = BT_GAP_ADV_FAST_INT_MIN_2,
+    .adv_fast_int_max = BT_GAP_ADV_FAST_INT_MAX_2,
+    .adv_slow_int_min = BT_GAP_ADV_SLOW_INT_MIN,
+    .adv_slow_int_max = BT_GAP_ADV_SLOW_INT_MAX,
+};
+
+static struct bt_uuid_128 params_service_uuid = BT_UUID_INIT_128(BT_UUID_PARAMS_SERVICE_VAL);
+static struct bt_uuid_128 params_values_uuid = BT_UUID_INIT_128(BT_UUID_PARAMS_VALUES_VAL);
+
+/* Double buffered: a write fills the set not in use and then publishes it,
+ * so readers on other threads never see half of a write. Writes come from
+ * the BT RX thread only, and the settings load before it runs.
+ */
+static struct params params_buf[2] = { params_default, params_default };
+static atomic_ptr_t params = ATOMIC_PTR_INIT(&params_buf[0]);
+static params_changed_t params_changed_cb;
+
+static struct k_work store_work;
+
+
+static bool in_range(uint16_t value, uint16_t min, uint16_t max)
+{
+    return value >= min && value <= max;
+}
+
+
+static bool params_valid(const struct params *p)
+{
+    return p->version == PARAMS_VERSION &&
+           in_range(p->adc_samples, 1, BATTERY_ADC_SAMPLES_MAX) &&
+           in_range(p->debounce_ms, 5, 200) &&
+           in_range(p->longpress_ms, 1000, 30000) &&
+           in_range(p->battery_interval_s, 2, 3600) &&
+           in_range(p->blink_ms, 100, 5000) &&
+           in_range(p->adv_fast_int_min, BT_GAP_ADV_FAST_INT_MIN_1, p->adv_fast_int_max) &&
+           in_range(p->adv_fast_int_max, p->adv_fast_int_min, BT_GAP_ADV_SLOW_INT_MIN) &&
+           in_range(p->adv_slow_int_min, p->adv_fast_int_max, p->adv_slow_int_max) &&
+           in_range(p->adv_slow_int_max, p->adv_slow_int_min, BT_GAP_ADV_MAX_ADV_INTERVAL);
+}
+
+
+static void params_publish(const struct params *next)
+{
+    struct params *spare = atomic_ptr_get(&params) == &params_buf[0] ? &params_buf[1] : &params_buf[0];
+
+    *spare = *next;
+    atomic_ptr_set(&params, spare);
+}
+
+
+// flash writes stay off the BT RX thread
+static void store(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct params current = *params_get();
+    int err;
+
+    if (!memcmp(&current, &params_default, sizeof(current))) {
+        err = settings_delete(PARAMS_SETTINGS_KEY);
+    } else {
+        err = settings_save_one(PARAMS_SETTINGS_KEY, &current, sizeof(current));
+    }
+    if (err) {
+        LOG_ERR("Failed to store parameters (err %d)", err);
+    }
+}
+
+
+static ssize_t read_values(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           void *buf, uint16_t len, uint16_t offset)
+{
+    struct params current = *params_get();
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &current, sizeof(current));
+}
+
+
+static ssize_t write_values(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    struct params next;
+    struct bt_conn_info info;
+
+    // an encrypted link alone is any host that could pair Just Works, see below
+    if (bt_conn_get_info(conn, &info) || bt_conn_get_security(conn) < BT_SECURITY_L2 ||
+        !bt_le_bond_exists(info.id, info.le.dst)) {
+        return BT_GATT_ERR(BT_ATT_ERR_AUTHORIZATION);
+    }
+
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    if (len == 1 && ((const uint8_t *)buf)[0] == PARAMS_RESET) {
+        next = params_default;
+    } else if (len == sizeof(next)) {
+        memcpy(&next, buf, sizeof(next));
+        if (!params_valid(&next)) {
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+        }
+    } else {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    params_publish(&next);
+    LOG_INF("Parameters updated\n");
+
+    k_work_submit(&store_work);
+    if (params_changed_cb) {
+        params_changed_cb();
+    }
+
+    return len;
+}
+
+
+/* Encrypted link from a bonded host only. The clicker has no IO for MITM
+ * pairing, so the bond is Just Works and not authenticated: whoever paired
+ * while the clicker was advertising and pairable may tune it. The bond
+ * check keeps out links that are encrypted without one, but whoever pairs
+ * while the clicker advertises is trusted as much as the presenter's host.
+ */
+BT_GATT_SERVICE_DEFINE(params_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &params_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &params_values_uuid.uuid,
+        BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+        BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT,
+        read_values, write_values, NULL
+    ),
+);
+
+
+static int params_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    struct params stored;
+    ssize_t read;
+
+    if (strcmp(name, "values")) {
+        return -ENOENT;
+    }
+
+    if (len != sizeof(stored)) {
+        LOG_WRN("Stored parameters ignored, size %u", len);
+        return 0;
+    }
+
+    read = read_cb(cb_arg, &stored, sizeof(stored));
+    if (read < 0) {
+        return read;
+    }
+    if (!params_valid(&stored)) {
+        LOG_WRN("Stored parameters ignored, out of range");
+        return 0;
+    }
+
+    params_publish(&stored);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(params, "params", NULL, params_set, NULL, NULL);
+
+
+void params_init(params_changed_t cb)
+{
+    params_changed_cb = cb;
+    k_work_init(&store_work, store);
+}
+
+
+const struct params *params_get(void)
+{
+    return atomic_ptr_get(&params);
+}
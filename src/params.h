@@ -0,0 +1,49 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <zephyr/toolchain.h>
+
+#define BT_UUID_PARAMS_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0700, 0x000000000000)
+#define BT_UUID_PARAMS_VALUES_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0701, 0x000000000000)
+
+#define PARAMS_VERSION     1
+#define PARAMS_RESET       0x00  // single byte write, back to the built-in defaults
+
+/* Runtime-tunable parameters, little endian. Reading the values
+ * characteristic returns the effective set. Writing a complete set
+ * validates it, applies it without a reboot and persists it through the
+ * settings subsystem; a set with any value out of range is rejected as a
+ * whole.
+ */
+struct __packed params {
+    uint8_t version;              // PARAMS_VERSION
+    uint8_t adc_samples;          // battery ADC samples averaged per reading
+    uint16_t debounce_ms;         // button debounce
+    uint16_t longpress_ms;        // both buttons held for this long unpair
+    uint16_t battery_interval_s;  // battery sampling while active
+    uint16_t blink_ms;            // advertising blink at the normal governor tier
+    uint16_t adv_fast_int_min;    // 0.625 ms units
+    uint16_t adv_fast_int_max;
+    uint16_t adv_slow_int_min;
+    uint16_t adv_slow_int_max;
+};
+
+typedef void (*params_changed_t)(void);
+
+/**
+ * @brief Set a handler called after a write has been applied.
+ *
+ * @param[in] cb Called from the BT RX thread.
+ */
+void params_init(params_changed_t cb);
+
+/**
+ * @brief Gets the effective parameters.
+ *
+ * A write never changes the set returned here, it publishes a new one. The
+ * returned set stays intact until the write after next, so read the values
+ * needed right away instead of keeping the pointer.
+ */
+const struct params *params_get(void);
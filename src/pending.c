@@ -0,0 +1,102 @@
+#include "pending.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME pending
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+static struct pending_event {
+    int64_t timestamp;
+    uint8_t button_mask;
+} pending_events[PENDING_EVENTS_MAX];
+
+static uint8_t pending_head;
+static uint8_t pending_count;
+
+static struct k_spinlock pending_lock;
+static struct pending_stats pending_stats;
+
+
+void pending_push(uint8_t button_mask)
+{
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    struct pending_event *event;
+
+    if (pending_count == PENDING_EVENTS_MAX) {
+        // keep the most recent presses, they matter most to the speaker
+        pending_head = (pending_head + 1) % PENDING_EVENTS_MAX;
+        pending_count--;
+        pending_stats.overflowed++;
+    }
+
+    event = &pending_events[(pending_head + pending_count) % PENDING_EVENTS_MAX];
+    event->timestamp = k_uptime_get();
+    event->button_mask = button_mask;
+    pending_count++;
+    pending_stats.buffered++;
+
+    k_spin_unlock(&pending_lock, key);
+
+    LOG_DBG("Buffered %x (%u pending)", button_mask, pending_count);
+}
+
+
+bool pending_empty(void)
+{
+    return pending_count == 0;
+}
+
+
+int pending_peek(uint8_t *button_mask)
+{
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    int64_t now = k_uptime_get();
+    int err = -ENOENT;
+
+    while (pending_count) {
+        struct pending_event *event = &pending_events[pending_head];
+
+        if (now - event->timestamp > PENDING_MAX_AGE_MS) {
+            pending_head = (pending_head + 1) % PENDING_EVENTS_MAX;
+            pending_count--;
+            pending_stats.expired++;
+            continue;
+        }
+
+        *button_mask = event->button_mask;
+        err = 0;
+        break;
+    }
+
+    k_spin_unlock(&pending_lock, key);
+    return err;
+}
+
+
+void pending_pop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+    if (pending_count) {
+        pending_head = (pending_head + 1) % PENDING_EVENTS_MAX;
+        pending_count--;
+        pending_stats.replayed++;
+    }
+
+    k_spin_unlock(&pending_lock, key);
+}
+
+
+void pending_stats_get(struct pending_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+    *stats = pending_stats;
+
+    k_spin_unlock(&pending_lock, key);
+}
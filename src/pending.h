@@ -0,0 +1,51 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define PENDING_EVENTS_MAX CONFIG_APP_PENDING_EVENTS_MAX // button transitions kept while the host is unreachable
+#define PENDING_MAX_AGE_MS CONFIG_APP_PENDING_MAX_AGE_MS // older transitions are dropped instead of replayed
+
+struct pending_stats {
+    uint32_t buffered; // transitions captured while disconnected or unsubscribed
+    uint32_t replayed; // transitions sent to the host after it re-subscribed
+    uint32_t expired;    // transitions dropped for age
+    uint32_t overflowed; // transitions dropped because the buffer was full
+};
+
+/**
+ * @brief Buffer a button transition until the host can receive it.
+ *
+ * When the buffer is full the oldest transition is dropped.
+ *
+ * @param[in] button_mask Button state after the transition.
+ */
+void pending_push(uint8_t button_mask);
+
+/**
+ * @brief Whether no transition is waiting for replay.
+ */
+bool pending_empty(void);
+
+/**
+ * @brief Read the oldest buffered transition that is not too old.
+ *
+ * Transitions that got too old are dropped. The one returned stays
+ * buffered until pending_pop() removes it.
+ *
+ * @param[out] button_mask Button state after the transition.
+ *
+ * @retval 0 if successful. -ENOENT if nothing is left to replay.
+ */
+int pending_peek(uint8_t *button_mask);
+
+/**
+ * @brief Remove the transition returned by pending_peek() once it was sent.
+ */
+void pending_pop(void);
+
+/**
+ * @brief Gets the buffered, replayed, expired and overflowed counters.
+ *
+ * @param[out] stats Pointer where the counters are stored.
+ */
+void pending_stats_get(struct pending_stats *stats);
@@ -0,0 +1,174 @@
+#include "periodic.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME periodic
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define PERIODIC_HOUR_MS  (60 * 60 * MSEC_PER_SEC)
+
+static sys_slist_t jobs = SYS_SLIST_STATIC_INIT(&jobs);
+static struct k_spinlock jobs_lock;
+
+static struct k_poll_signal jobs_changed = K_POLL_SIGNAL_INITIALIZER(jobs_changed);
+
+static struct periodic_stats periodic_stats;
+static int64_t hour_start;
+static uint32_t hour_wakeups;
+static uint32_t hour_runs;
+
+
+/* Wake up at the latest moment the most urgent job allows. Every job whose
+ * window has opened by then runs in the same wake-up.
+ */
+static k_timeout_t timeout_get(void)
+{
+    struct periodic_job *job;
+    int64_t deadline = INT64_MAX;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&jobs, job, node) {
+        deadline = MIN(deadline, job->due + job->slack_ms);
+    }
+
+    if (deadline == INT64_MAX) {
+        return K_FOREVER;
+    }
+    return K_MSEC(MAX(deadline - k_uptime_get(), 0));
+}
+
+
+// the event loop recomputes its timeout on the next pass
+static void timer_update(void)
+{
+    k_poll_signal_raise(&jobs_changed, 0);
+}
+
+
+static void hour_account(int64_t now, uint32_t runs)
+{
+    hour_wakeups++;
+    hour_runs += runs;
+
+    if (now - hour_start < PERIODIC_HOUR_MS) {
+        return;
+    }
+
+    periodic_stats.wakeups_last_hour = hour_wakeups;
+    periodic_stats.runs_last_hour = hour_runs;
+    LOG_INF("%u wake-ups in the last hour, %u without coalescing\n", hour_wakeups, hour_runs);
+
+    hour_start = now;
+    hour_wakeups = 0;
+    hour_runs = 0;
+}
+
+
+k_timeout_t periodic_process(void)
+{
+    periodic_handler_t due[PERIODIC_JOBS_MAX];
+    k_timeout_t timeout;
+    struct periodic_job *job;
+    uint32_t count = 0;
+    int64_t now = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&jobs_lock);
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&jobs, job, node) {
+        if (job->due > now || count == ARRAY_SIZE(due)) {
+            continue;
+        }
+        due[count++] = job->handler;
+        job->due = MAX(job->due + job->period_ms, now); // running late in the window does not stretch the period
+    }
+
+    if (count) {
+        periodic_stats.wakeups++;
+        periodic_stats.runs += count;
+        hour_account(now, count);
+    }
+
+    k_spin_unlock(&jobs_lock, key);
+
+    // handlers may start or stop jobs, so they run outside the lock
+    for (uint32_t i = 0; i < count; i++) {
+        due[i]();
+    }
+
+    key = k_spin_lock(&jobs_lock);
+    k_poll_signal_reset(&jobs_changed);
+    timeout = timeout_get();
+    k_spin_unlock(&jobs_lock, key);
+
+    return timeout;
+}
+
+
+void periodic_poll_event_init(struct k_poll_event *event)
+{
+    k_poll_event_init(event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &jobs_changed);
+}
+
+
+void periodic_job_init(struct periodic_job *job, periodic_handler_t handler, uint32_t slack_ms)
+{
+    job->handler = handler;
+    job->slack_ms = slack_ms;
+    job->period_ms = 0;
+    job->running = false;
+}
+
+
+void periodic_start(struct periodic_job *job, uint32_t delay_ms, uint32_t period_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&jobs_lock);
+
+    job->period_ms = period_ms;
+    job->due = k_uptime_get() + delay_ms;
+    if (!job->running) {
+        job->running = true;
+        sys_slist_append(&jobs, &job->node);
+    }
+    timer_update();
+
+    k_spin_unlock(&jobs_lock, key);
+}
+
+
+void periodic_period_set(struct periodic_job *job, uint32_t period_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&jobs_lock);
+
+    if (job->running) {
+        job->due += (int64_t)period_ms - job->period_ms;
+        timer_update();
+    }
+    job->period_ms = period_ms;
+
+    k_spin_unlock(&jobs_lock, key);
+}
+
+
+void periodic_stop(struct periodic_job *job)
+{
+    k_spinlock_key_t key = k_spin_lock(&jobs_lock);
+
+    if (job->running) {
+        job->running = false;
+        sys_slist_find_and_remove(&jobs, &job->node);
+        timer_update();
+    }
+
+    k_spin_unlock(&jobs_lock, key);
+}
+
+
+void periodic_stats_get(struct periodic_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&jobs_lock);
+
+    *stats = periodic_stats;
+
+    k_spin_unlock(&jobs_lock, key);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <zephyr/sys/slist.h>
+
+#define PERIODIC_JOBS_MAX  8  // jobs that can fall due in the same wake-up
+
+typedef void (*periodic_handler_t)(void);
+
+struct periodic_job {
+    periodic_handler_t handler;
+    uint32_t period_ms;
+    uint32_t slack_ms;   // how late the job may run so it can share a wake-up with others
+    int64_t due;         // earliest uptime the job may run at
+    bool running;
+    sys_snode_t node;
+};
+
+struct periodic_stats {
+    uint32_t wakeups;              // loop passes that ran at least one job since boot
+    uint32_t runs;                 // job runs since boot, one wake-up each without coalescing
+    uint32_t wakeups_last_hour;
+    uint32_t runs_last_hour;
+};
+
+/**
+ * @brief Prepare a job. Jobs run from the application event loop in main().
+ *
+ * @param[in] job Job to initialize.
+ * @param[in] handler Called every time the job runs.
+ * @param[in] slack_ms How late the job may run after it falls due.
+ */
+void periodic_job_init(struct periodic_job *job, periodic_handler_t handler, uint32_t slack_ms);
+
+/**
+ * @brief Start a job or change the timing of a running one.
+ *
+ * @param[in] job Initialized job.
+ * @param[in] delay_ms Time until the first run.
+ * @param[in] period_ms Time between runs.
+ */
+void periodic_start(struct periodic_job *job, uint32_t delay_ms, uint32_t period_ms);
+
+/**
+ * @brief Change the period of a job, keeping the time of its last run.
+ */
+void periodic_period_set(struct periodic_job *job, uint32_t period_ms);
+
+/**
+ * @brief Stop a job. The timer is stopped entirely once no job is running.
+ */
+void periodic_stop(struct periodic_job *job);
+
+/**
+ * @brief Run the jobs that are due.
+ *
+ * @retval Time until the loop must call again, K_FOREVER while no job runs.
+ */
+k_timeout_t periodic_process(void);
+
+/**
+ * @brief Set up a poll event that fires when jobs are started or stopped,
+ *        so the loop waiting in k_poll() picks up the new timeout.
+ *
+ * @param[out] event Event to initialize.
+ */
+void periodic_poll_event_init(struct k_poll_event *event);
+
+/**
+ * @brief Gets the wake-up counters.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void periodic_stats_get(struct periodic_stats *stats);
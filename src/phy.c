@@ -0,0 +1,330 @@
+#include "phy.h"
+#include "link.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME phy
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+/* PDU sizes on air: LL header (2) + payload + MIC (4, encrypted links only) + CRC (3) */
+#define PHY_EMPTY_PDU_LEN  (2 + 3)
+#define PHY_REPORT_PDU_LEN (2 + 4 + 3 + 8 + 4 + 3) // L2CAP + ATT notification + keyboard report
+
+/* Ordered from shortest airtime to longest range. */
+static const enum phy_mode phy_ladder[] = {
+    PHY_MODE_2M,
+    PHY_MODE_1M,
+    PHY_MODE_CODED,
+};
+
+static const struct bt_conn_le_phy_param phy_params[PHY_MODE_COUNT] = {
+    [PHY_MODE_1M] = {
+        .options = BT_CONN_LE_PHY_OPT_NONE,
+        .pref_tx_phy = BT_GAP_LE_PHY_1M,
+        .pref_rx_phy = BT_GAP_LE_PHY_1M,
+    },
+    [PHY_MODE_2M] = {
+        .options = BT_CONN_LE_PHY_OPT_NONE,
+        .pref_tx_phy = BT_GAP_LE_PHY_2M,
+        .pref_rx_phy = BT_GAP_LE_PHY_2M,
+    },
+    [PHY_MODE_CODED] = {
+        .options = BT_CONN_LE_PHY_OPT_CODED_S8,
+        .pref_tx_phy = BT_GAP_LE_PHY_CODED,
+        .pref_rx_phy = BT_GAP_LE_PHY_CODED,
+    },
+};
+
+static const char *const phy_names[PHY_MODE_COUNT] = {
+    [PHY_MODE_1M] = "1M",
+    [PHY_MODE_2M] = "2M",
+    [PHY_MODE_CODED] = "Coded",
+};
+
+static struct phy_ctx {
+    struct bt_conn *conn;
+    enum phy_mode mode;
+    enum phy_mode pending;  // PHY_MODE_COUNT when no request is outstanding
+    uint8_t rejected;       // BIT(mode) for every PHY the host refused on this connection
+    uint8_t good_samples;
+    int64_t mode_since;
+    struct k_work_delayable work;
+} phy_ctx[CONFIG_BT_MAX_CONN];
+
+static struct k_spinlock phy_lock;
+static struct phy_stats phy_stats;
+static uint32_t phy_conn_events[PHY_MODE_COUNT];
+
+
+static uint32_t phy_airtime_us(enum phy_mode mode, uint32_t pdu_len)
+{
+    switch (mode) {
+    case PHY_MODE_2M:
+        return (2 + 4 + pdu_len) * 8 / 2; // preamble (2) + access address (4), 2 Mbit/s
+    case PHY_MODE_CODED:
+        return 80 + 256 + 16 + 24 + pdu_len * 8 * 8 + 24; // S=8 coding, FEC block 1 + 2
+    default:
+        return (1 + 4 + pdu_len) * 8; // preamble (1) + access address (4), 1 Mbit/s
+    }
+}
+
+
+static enum phy_mode phy_from_gap(uint8_t gap_phy)
+{
+    switch (gap_phy) {
+    case BT_GAP_LE_PHY_2M:
+        return PHY_MODE_2M;
+    case BT_GAP_LE_PHY_CODED:
+        return PHY_MODE_CODED;
+    default:
+        return PHY_MODE_1M;
+    }
+}
+
+
+static size_t phy_ladder_pos(enum phy_mode mode)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(phy_ladder); i++) {
+        if (phy_ladder[i] == mode) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+
+/* Must be called with phy_lock held. */
+static void phy_residency_account(struct phy_ctx *ctx)
+{
+    struct bt_conn_info info;
+    int64_t now = k_uptime_get();
+    uint32_t elapsed_ms = (uint32_t)(now - ctx->mode_since);
+
+    phy_stats.residency_ms[ctx->mode] += elapsed_ms;
+    if (bt_conn_get_info(ctx->conn, &info) == 0 && info.le.interval) {
+        phy_conn_events[ctx->mode] += ((uint64_t)elapsed_ms * 100U) / (info.le.interval * 125U);
+    }
+    ctx->mode_since = now;
+}
+
+
+static void phy_request(struct phy_ctx *ctx, enum phy_mode mode)
+{
+    int err;
+
+    if (mode == ctx->mode || (ctx->rejected & BIT(mode))) {
+        return;
+    }
+
+    err = bt_conn_le_phy_update(ctx->conn, &phy_params[mode]);
+    if (err) {
+        // local and usually transient (no buffer, procedure busy), the next sample asks again;
+        // only the host's answer or its silence marks a PHY rejected
+        LOG_WRN("PHY %s request failed (err %d)\n", phy_names[mode], err);
+        return;
+    }
+
+    LOG_INF("Requesting PHY %s\n", phy_names[mode]);
+    ctx->pending = mode;
+    k_work_reschedule(&ctx->work, K_MSEC(PHY_UPDATE_TIMEOUT_MS));
+}
+
+
+/* Step one rung along the ladder, skipping PHYs this host refused. */
+static void phy_step(struct phy_ctx *ctx, int dir)
+{
+    int pos = (int)phy_ladder_pos(ctx->mode) + dir;
+
+    for (; pos >= 0 && pos < (int)ARRAY_SIZE(phy_ladder); pos += dir) {
+        if (!(ctx->rejected & BIT(phy_ladder[pos]))) {
+            phy_request(ctx, phy_ladder[pos]);
+            return;
+        }
+    }
+}
+
+
+static void phy_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct phy_ctx *ctx = CONTAINER_OF(dwork, struct phy_ctx, work);
+
+    if (!ctx->conn) {
+        return;
+    }
+
+    if (ctx->pending != PHY_MODE_COUNT) {
+        // host never answered, do not ask for this PHY again on this connection
+        LOG_WRN("PHY %s request timed out\n", phy_names[ctx->pending]);
+        ctx->rejected |= BIT(ctx->pending);
+        ctx->pending = PHY_MODE_COUNT;
+        phy_stats.rejected++;
+        return;
+    }
+
+    phy_request(ctx, PHY_MODE_2M);
+}
+
+
+static void link_sampled(struct bt_conn *conn, const struct link_quality *quality)
+{
+    struct phy_ctx *ctx = &phy_ctx[bt_conn_index(conn)];
+    uint32_t lost = quality->tx_late + quality->tx_failed;
+    uint32_t total = quality->tx_done + quality->tx_failed;
+    bool rssi_known = quality->rssi != LINK_RSSI_UNKNOWN;
+    k_spinlock_key_t key;
+
+    if (ctx->conn != conn) {
+        return;
+    }
+
+    key = k_spin_lock(&phy_lock);
+    phy_stats.tx_packets[ctx->mode] += quality->tx_done;
+    k_spin_unlock(&phy_lock, key);
+
+    if (ctx->pending != PHY_MODE_COUNT) {
+        return;
+    }
+
+    if ((rssi_known && quality->rssi < PHY_RSSI_RANGE_DBM) ||
+        (total && lost * 100U >= PHY_LOSS_RANGE_PCT * total)) {
+        ctx->good_samples = 0;
+        phy_step(ctx, 1);
+    } else if (rssi_known && quality->rssi > PHY_RSSI_AIRTIME_DBM && lost == 0) {
+        if (++ctx->good_samples >= PHY_GOOD_SAMPLES) {
+            ctx->good_samples = 0;
+            phy_step(ctx, -1);
+        }
+    } else {
+        ctx->good_samples = 0;
+    }
+}
+
+
+static struct link_cb phy_link_cb = {
+    .sampled = link_sampled,
+};
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err) {
+        return;
+    }
+
+    struct phy_ctx *ctx = &phy_ctx[bt_conn_index(conn)];
+
+    ctx->conn = conn;
+    ctx->mode = PHY_MODE_1M;
+    ctx->pending = PHY_MODE_COUNT;
+    ctx->rejected = IS_ENABLED(CONFIG_BT_CTLR_PHY_CODED) ? 0 : BIT(PHY_MODE_CODED);
+    ctx->good_samples = 0;
+    ctx->mode_since = k_uptime_get();
+
+    k_work_reschedule(&ctx->work, K_MSEC(PHY_UPDATE_DELAY_MS));
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct phy_ctx *ctx = &phy_ctx[bt_conn_index(conn)];
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(reason);
+
+    if (ctx->conn != conn) {
+        return;
+    }
+
+    k_work_cancel_delayable(&ctx->work);
+
+    key = k_spin_lock(&phy_lock);
+    phy_residency_account(ctx);
+    ctx->conn = NULL;
+    k_spin_unlock(&phy_lock, key);
+}
+
+
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    struct phy_ctx *ctx = &phy_ctx[bt_conn_index(conn)];
+    enum phy_mode mode = phy_from_gap(param->tx_phy);
+    k_spinlock_key_t key;
+
+    if (ctx->conn != conn) {
+        return;
+    }
+
+    LOG_INF("PHY updated: tx %s rx %s\n", phy_names[mode], phy_names[phy_from_gap(param->rx_phy)]);
+
+    key = k_spin_lock(&phy_lock);
+    phy_residency_account(ctx);
+    ctx->mode = mode;
+    if (ctx->pending != PHY_MODE_COUNT && ctx->pending != mode) {
+        // host answered with a different PHY than the one we asked for
+        ctx->rejected |= BIT(ctx->pending);
+        phy_stats.rejected++;
+    }
+    k_spin_unlock(&phy_lock, key);
+
+    if (ctx->pending != PHY_MODE_COUNT) {
+        ctx->pending = PHY_MODE_COUNT;
+        k_work_cancel_delayable(&ctx->work);
+    }
+}
+
+
+BT_CONN_CB_DEFINE(phy_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_phy_updated = le_phy_updated,
+};
+
+
+void phy_stats_get(struct phy_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&phy_lock);
+    uint32_t empty_1m = phy_airtime_us(PHY_MODE_1M, PHY_EMPTY_PDU_LEN);
+    uint32_t report_1m = phy_airtime_us(PHY_MODE_1M, PHY_REPORT_PDU_LEN);
+
+    for (size_t i = 0; i < ARRAY_SIZE(phy_ctx); i++) {
+        if (phy_ctx[i].conn) {
+            phy_residency_account(&phy_ctx[i]);
+        }
+    }
+
+    phy_stats.airtime_saved_us = 0;
+    for (int mode = 0; mode < PHY_MODE_COUNT; mode++) {
+        // every connection event exchanges at least one empty PDU in each direction
+        int64_t event_saved = 2 * ((int64_t)empty_1m - phy_airtime_us(mode, PHY_EMPTY_PDU_LEN));
+        int64_t report_saved = (int64_t)report_1m - phy_airtime_us(mode, PHY_REPORT_PDU_LEN);
+
+        phy_stats.airtime_saved_us += event_saved * phy_conn_events[mode];
+        phy_stats.airtime_saved_us += report_saved * phy_stats.tx_packets[mode];
+    }
+
+    *stats = phy_stats;
+    k_spin_unlock(&phy_lock, key);
+}
+
+
+int phy_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(phy_ctx); i++) {
+        phy_ctx[i].pending = PHY_MODE_COUNT;
+        k_work_init_delayable(&phy_ctx[i].work, phy_work_handler);
+    }
+
+    link_cb_register(&phy_link_cb);
+
+    LOG_INF("Initialized");
+    return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define PHY_UPDATE_DELAY_MS     1500 // let pairing and discovery settle before the first request
+#define PHY_UPDATE_TIMEOUT_MS   5000 // no PHY update complete within this time counts as a rejection
+#define PHY_RSSI_RANGE_DBM      (-80) // below: step towards Coded PHY
+#define PHY_RSSI_AIRTIME_DBM    (-70) // above: step towards 2M PHY
+#define PHY_LOSS_RANGE_PCT      20    // late or failed packets before stepping towards Coded PHY
+#define PHY_GOOD_SAMPLES        3     // consecutive clean link samples before stepping towards 2M PHY
+
+enum phy_mode {
+    PHY_MODE_1M = 0,
+    PHY_MODE_2M,
+    PHY_MODE_CODED,
+    PHY_MODE_COUNT
+};
+
+struct phy_stats {
+    uint32_t residency_ms[PHY_MODE_COUNT]; // time connections spent on each PHY
+    uint32_t tx_packets[PHY_MODE_COUNT];   // acknowledged packets sent on each PHY
+    uint32_t rejected;                     // PHY requests refused or ignored by the host
+    int64_t airtime_saved_us;              // estimated radio time saved compared to staying on 1M
+};
+
+#if defined(CONFIG_APP_PHY_POLICY)
+
+/**
+ * @brief Initialize the PHY policy.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int phy_init(void);
+
+/**
+ * @brief Gets the accumulated PHY statistics, including connections still open.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void phy_stats_get(struct phy_stats *stats);
+
+#else
+
+static inline int phy_init(void)
+{
+    return 0;
+}
+
+static inline void phy_stats_get(struct phy_stats *stats)
+{
+    *stats = (struct phy_stats){ 0 };
+}
+
+#endif
@@ -0,0 +1,239 @@
+#include "power.h"
+#include "hid.h"
+#include "params.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME power
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define POWER_EVT_IDLE_TIMEOUT 0xff // internal, not part of the public event set
+#define POWER_EVT_QUEUE_LEN    8
+
+/* What each state keeps powered. The ADC is under runtime PM and only
+ * resumed by battery.c for the duration of a measurement.
+ */
+static const struct power_policy {
+    bool console;
+    uint16_t battery_interval_s;
+} power_policy[POWER_STATE_COUNT] = {
+    [POWER_STATE_ACTIVE]      = { .console = true,  .battery_interval_s = POWER_BATTERY_ACTIVE_S },
+    [POWER_STATE_IDLE]        = { .console = false, .battery_interval_s = 30 },
+    [POWER_STATE_ADVERTISING] = { .console = false, .battery_interval_s = 30 },
+    [POWER_STATE_SLEEP]       = { .console = false, .battery_interval_s = 300 },
+};
+
+static const char *const power_state_names[POWER_STATE_COUNT] = {
+    [POWER_STATE_ACTIVE] = "active",
+    [POWER_STATE_IDLE] = "idle",
+    [POWER_STATE_ADVERTISING] = "advertising",
+    [POWER_STATE_SLEEP] = "sleep",
+};
+
+#if DT_HAS_CHOSEN(zephyr_console)
+static const struct device *console_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+#endif
+static const struct device *adc_dev = DEVICE_DT_GET(DT_NODELABEL(adc));
+
+K_MSGQ_DEFINE(power_evt_q, sizeof(uint8_t), POWER_EVT_QUEUE_LEN, 1);
+
+static struct k_work evt_work;
+static struct k_work_delayable idle_work;
+static power_state_changed_t state_changed_cb;
+
+static enum power_state state = POWER_STATE_ADVERTISING;
+static bool connected;
+static bool advertising;
+static int64_t state_since;
+static struct power_stats power_stats;
+
+
+static void console_set(bool on)
+{
+#if DT_HAS_CHOSEN(zephyr_console)
+    int err = pm_device_action_run(console_dev, on ? PM_DEVICE_ACTION_RESUME : PM_DEVICE_ACTION_SUSPEND);
+
+    if (err && err != -EALREADY) {
+        LOG_WRN("Console %s failed (err %d)", on ? "resume" : "suspend", err);
+    }
+#endif
+}
+
+
+static void state_enter(enum power_state next)
+{
+    int64_t now = k_uptime_get();
+
+    if (next == state) {
+        return;
+    }
+
+    power_stats.residency_ms[state] += (uint32_t)(now - state_since);
+    power_stats.entries[next]++;
+    state_since = now;
+
+    // resume before logging the transition, suspend after
+    if (power_policy[next].console) {
+        console_set(true);
+    }
+    LOG_INF("%s -> %s", power_state_names[state], power_state_names[next]);
+    if (!power_policy[next].console) {
+        console_set(false);
+    }
+
+    state = next;
+
+    if (state == POWER_STATE_ACTIVE) {
+        k_work_reschedule(&idle_work, K_MSEC(POWER_IDLE_TIMEOUT_MS));
+    } else {
+        k_work_cancel_delayable(&idle_work);
+    }
+
+    if (state_changed_cb) {
+        state_changed_cb(state);
+    }
+}
+
+
+static void evt_handle(uint8_t evt)
+{
+    switch (evt) {
+    case POWER_EVT_INPUT:
+        if (connected) {
+            if (state == POWER_STATE_ACTIVE) {
+                k_work_reschedule(&idle_work, K_MSEC(POWER_IDLE_TIMEOUT_MS));
+            }
+            state_enter(POWER_STATE_ACTIVE);
+        } else if (!advertising) {
+            advertising_start(); // reported back as POWER_EVT_ADV_STARTED
+        }
+        break;
+
+    case POWER_EVT_CONNECTED:
+        connected = true;
+        advertising = false; // connectable advertising ends with the connection
+        state_enter(POWER_STATE_ACTIVE);
+        break;
+
+    case POWER_EVT_DISCONNECTED:
+        connected = false;
+        state_enter(advertising ? POWER_STATE_ADVERTISING : POWER_STATE_SLEEP);
+        break;
+
+    case POWER_EVT_ADV_STARTED:
+        advertising = true;
+        if (!connected) {
+            state_enter(POWER_STATE_ADVERTISING);
+        }
+        break;
+
+    case POWER_EVT_ADV_STOPPED:
+        advertising = false;
+        if (!connected) {
+            state_enter(POWER_STATE_SLEEP);
+        }
+        break;
+
+    case POWER_EVT_BATTERY_CRITICAL:
+        if (!connected && advertising) {
+            advertising_stop(); // reported back as POWER_EVT_ADV_STOPPED
+        }
+        break;
+
+    case POWER_EVT_IDLE_TIMEOUT:
+        if (state == POWER_STATE_ACTIVE) {
+            state_enter(POWER_STATE_IDLE);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+static void evt_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t evt;
+
+    while (k_msgq_get(&power_evt_q, &evt, K_NO_WAIT) == 0) {
+        evt_handle(evt);
+    }
+}
+
+
+static void idle_expired(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    evt_handle(POWER_EVT_IDLE_TIMEOUT);
+}
+
+
+void power_event(enum power_event evt)
+{
+    uint8_t msg = evt;
+
+    if (k_msgq_put(&power_evt_q, &msg, K_NO_WAIT)) {
+        LOG_WRN("Event %u dropped", msg);
+        return;
+    }
+    k_work_submit(&evt_work);
+}
+
+
+enum power_state power_state_get(void)
+{
+    return state;
+}
+
+
+uint16_t power_battery_interval_s(void)
+{
+    if (state == POWER_STATE_ACTIVE) {
+        return params_get()->battery_interval_s;
+    }
+    // the quieter states never sample more often than the active one
+    return MAX(power_policy[state].battery_interval_s, params_get()->battery_interval_s);
+}
+
+
+void power_stats_get(struct power_stats *stats)
+{
+    *stats = power_stats;
+    stats->residency_ms[state] += (uint32_t)(k_uptime_get() - state_since);
+}
+
+
+int power_init(power_state_changed_t cb)
+{
+    int err;
+
+    state_changed_cb = cb;
+    state_since = k_uptime_get();
+    power_stats.entries[state]++;
+
+    k_work_init(&evt_work, evt_work_handler);
+    k_work_init_delayable(&idle_work, idle_expired);
+
+    err = pm_device_runtime_enable(adc_dev);
+    if (err && err != -ENOTSUP) {
+        LOG_ERR("ADC runtime PM enable failed (err %d)", err);
+        return err;
+    }
+
+    console_set(power_policy[state].console);
+
+    LOG_INF("Initialized");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define POWER_IDLE_TIMEOUT_MS   30000   // connected without input for this long counts as idle
+#define POWER_BATTERY_CRITICAL  3       // percent, below this the device stops advertising
+#define POWER_BATTERY_ACTIVE_S  10      // battery sampling while active, default of the tunable (params.c)
+
+enum power_state {
+    POWER_STATE_ACTIVE = 0,   // connected and in use
+    POWER_STATE_IDLE,         // connected, no recent input
+    POWER_STATE_ADVERTISING,  // disconnected, looking for the host
+    POWER_STATE_SLEEP,        // disconnected and silent, woken by a press or pick-up
+    POWER_STATE_COUNT
+};
+
+enum power_event {
+    POWER_EVT_INPUT = 0,
+    POWER_EVT_CONNECTED,
+    POWER_EVT_DISCONNECTED,
+    POWER_EVT_ADV_STARTED,
+    POWER_EVT_ADV_STOPPED,
+    POWER_EVT_BATTERY_CRITICAL,
+};
+
+struct power_stats {
+    uint32_t residency_ms[POWER_STATE_COUNT];
+    uint32_t entries[POWER_STATE_COUNT];
+};
+
+typedef void (*power_state_changed_t)(enum power_state state);
+
+/**
+ * @brief Initialize the power-state policy.
+ *
+ * @param[in] cb Called from the system workqueue after every state change.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int power_init(power_state_changed_t cb);
+
+/**
+ * @brief Feed an event into the power-state machine. Safe from any context.
+ */
+void power_event(enum power_event evt);
+
+/**
+ * @brief Gets the current power state.
+ */
+enum power_state power_state_get(void);
+
+/**
+ * @brief Gets the battery sampling interval for the current state in seconds.
+ */
+uint16_t power_battery_interval_s(void);
+
+/**
+ * @brief Gets the per-state residency and entry counters, including the current state.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void power_stats_get(struct power_stats *stats);
@@ -0,0 +1,96 @@
+#include "probe.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME probe
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+static struct bt_uuid_128 probe_service_uuid = BT_UUID_INIT_128(BT_UUID_PROBE_SERVICE_VAL);
+static struct bt_uuid_128 probe_echo_uuid = BT_UUID_INIT_128(BT_UUID_PROBE_ECHO_VAL);
+
+static bool probe_active;
+static struct probe_stats probe_stats;
+
+
+static ssize_t write_echo(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+
+    probe_active = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("Round-trip probe %s\n", probe_active ? "enabled" : "disabled");
+}
+
+
+BT_GATT_SERVICE_DEFINE(probe_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &probe_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &probe_echo_uuid.uuid,
+        BT_GATT_CHRC_WRITE_WITHOUT_RESP | BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_WRITE_ENCRYPT,
+        NULL, write_echo, NULL
+    ),
+    BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+);
+
+
+/* Echo straight from the RX path, so the measured time is the link and
+ * host stack only and does not include a workqueue hop.
+ */
+static ssize_t write_echo(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    int err;
+
+    if (!probe_active) {
+        return BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+    }
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    err = bt_gatt_notify(conn, attr, buf, len);
+    if (err) {
+        probe_stats.failed++;
+    } else {
+        probe_stats.echoed++;
+    }
+
+    return len;
+}
+
+
+bool probe_is_active(void)
+{
+    return probe_active;
+}
+
+
+void probe_hid_echoed(int err)
+{
+    if (err) {
+        probe_stats.failed++;
+    } else {
+        probe_stats.hid_echoed++;
+    }
+}
+
+
+void probe_stats_get(struct probe_stats *stats)
+{
+    *stats = probe_stats;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define BT_UUID_PROBE_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0400, 0x000000000000)
+#define BT_UUID_PROBE_ECHO_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0401, 0x000000000000)
+
+/* Round-trip probe. While a client is subscribed to the echo
+ * characteristic, every write to it is notified back unchanged, and every
+ * HID output report is echoed in the reserved byte of a keyboard input
+ * report with no keys changed. The host tags its writes with a sequence
+ * number and measures the round trip on its own clock.
+ */
+
+struct probe_stats {
+    uint32_t echoed;      // vendor writes notified back
+    uint32_t hid_echoed;  // output reports echoed in an input report
+    uint32_t failed;      // echoes that could not be queued
+};
+
+#if defined(CONFIG_APP_LATENCY_PROBE)
+
+/**
+ * @brief Check if a probe client is subscribed.
+ */
+bool probe_is_active(void);
+
+/**
+ * @brief Count an output report echoed through the HID service.
+ *
+ * @param[in] err Result of queuing the input report.
+ */
+void probe_hid_echoed(int err);
+
+/**
+ * @brief Gets the echo counters.
+ *
+ * @param[out] stats Pointer where the counters are stored.
+ */
+void probe_stats_get(struct probe_stats *stats);
+
+#else
+
+static inline bool probe_is_active(void)
+{
+    return false;
+}
+
+static inline void probe_hid_echoed(int err)
+{
+}
+
+static inline void probe_stats_get(struct probe_stats *stats)
+{
+    *stats = (struct probe_stats){ 0 };
+}
+
+#endif
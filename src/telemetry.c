@@ -0,0 +1,288 @@
+#include "telemetry.h"
+#include "phy.h"
+#include "txpower.h"
+#include "wake.h"
+#include "dfu.h"
+#include "history.h"
+#include "blelog.h"
+#include "probe.h"
+#include "hub.h"
+#include "broadcast.h"
+#include "edge.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME telemetry
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#define TELEMETRY_SNAPSHOT_MAX_LEN (sizeof(struct telemetry_header) + \
+    TELEMETRY_THREADS_MAX * sizeof(struct telemetry_thread) +          \
+    TELEMETRY_POOLS_MAX * sizeof(struct telemetry_pool))
+
+static struct bt_uuid_128 telemetry_service_uuid = BT_UUID_INIT_128(BT_UUID_TELEMETRY_SERVICE_VAL);
+static struct bt_uuid_128 telemetry_snapshot_uuid = BT_UUID_INIT_128(BT_UUID_TELEMETRY_SNAPSHOT_VAL);
+
+#define SNAPSHOT_HOLD_MS 2000 // Longest a long read may keep the snapshot from being rebuilt
+
+static K_MUTEX_DEFINE(snapshot_lock);
+static uint8_t snapshot_buf[TELEMETRY_SNAPSHOT_MAX_LEN];
+static size_t snapshot_len;
+static int64_t snapshot_time;
+static const struct bt_conn *snapshot_reader; // Connection in the middle of a long read
+
+struct thread_walk {
+    struct telemetry_thread *threads;
+    uint8_t count;
+    uint64_t total_cycles;
+};
+
+
+static void name_copy(char *dst, const char *src)
+{
+    size_t len;
+
+    src = src ? src : "";
+    len = strnlen(src, TELEMETRY_NAME_LEN);
+    memcpy(dst, src, len);
+    memset(dst + len, 0, TELEMETRY_NAME_LEN - len);
+}
+
+
+static void thread_collect(const struct k_thread *cthread, void *user_data)
+{
+    struct k_thread *thread = (struct k_thread *)cthread;
+    struct thread_walk *walk = user_data;
+    struct telemetry_thread *entry;
+    k_thread_runtime_stats_t rt_stats;
+    size_t unused = 0;
+
+    if (walk->count >= TELEMETRY_THREADS_MAX) {
+        return;
+    }
+    entry = &walk->threads[walk->count++];
+    memset(entry, 0, sizeof(*entry));
+
+    name_copy(entry->name, k_thread_name_get(thread) ? k_thread_name_get(thread) : "?");
+
+    if (k_thread_stack_space_get(thread, &unused) == 0) {
+        entry->stack_unused = sys_cpu_to_le16(MIN(unused, UINT16_MAX));
+    }
+    entry->stack_size = sys_cpu_to_le16(MIN(thread->stack_info.size, UINT16_MAX));
+
+    if (walk->total_cycles && k_thread_runtime_stats_get(thread, &rt_stats) == 0) {
+        entry->cpu_permille = sys_cpu_to_le16((rt_stats.execution_cycles * 1000U) / walk->total_cycles);
+    }
+}
+
+
+int telemetry_snapshot(uint8_t *buf, size_t len)
+{
+    struct telemetry_header *header = (struct telemetry_header *)buf;
+    struct telemetry_pool *pools;
+    struct thread_walk walk = { 0 };
+    k_thread_runtime_stats_t all_stats;
+    uint8_t pool_count = 0;
+
+    if (len < TELEMETRY_SNAPSHOT_MAX_LEN) {
+        return -ENOMEM;
+    }
+
+    if (k_thread_runtime_stats_all_get(&all_stats) == 0) {
+        walk.total_cycles = all_stats.execution_cycles;
+    }
+    walk.threads = (struct telemetry_thread *)(buf + sizeof(*header));
+    k_thread_foreach_unlocked(thread_collect, &walk);
+
+    pools = (struct telemetry_pool *)(buf + sizeof(*header) + walk.count * sizeof(struct telemetry_thread));
+    STRUCT_SECTION_FOREACH(net_buf_pool, pool) {
+        struct telemetry_pool *entry;
+
+        if (pool_count >= TELEMETRY_POOLS_MAX) {
+            break;
+        }
+        entry = &pools[pool_count++];
+        memset(entry, 0, sizeof(*entry));
+
+        entry->buf_count = sys_cpu_to_le16(pool->buf_count);
+#if defined(CONFIG_NET_BUF_POOL_USAGE)
+        name_copy(entry->name, pool->name);
+        entry->used = sys_cpu_to_le16(pool->buf_count - atomic_get(&pool->avail_count));
+        entry->max_used = sys_cpu_to_le16(pool->max_used);
+#endif
+    }
+
+    header->version = TELEMETRY_VERSION;
+    header->thread_count = walk.count;
+    header->pool_count = pool_count;
+    header->reserved = 0;
+
+    return (uint8_t *)&pools[pool_count] - buf;
+}
+
+
+/* Rebuild the shared snapshot unless a long read is still walking it.
+ * Called with snapshot_lock held.
+ */
+static int snapshot_refresh(void)
+{
+    int rc;
+
+    if (snapshot_reader && k_uptime_get() - snapshot_time < SNAPSHOT_HOLD_MS) {
+        return 0;
+    }
+    snapshot_reader = NULL;
+
+    rc = telemetry_snapshot(snapshot_buf, sizeof(snapshot_buf));
+    if (rc < 0) {
+        snapshot_len = 0;
+        return rc;
+    }
+    snapshot_len = rc;
+    snapshot_time = k_uptime_get();
+    return 0;
+}
+
+
+/* The measurements the other modules keep, a line or a few per module */
+static void stats_log(void)
+{
+    struct phy_stats phy;
+    struct txpower_stats txpower;
+    struct wake_stats wake;
+    struct dfu_stats dfu;
+    struct history_stats history;
+    struct blelog_stats blelog;
+    struct probe_stats probe;
+    struct hub_remote_stats remote;
+    struct broadcast_stats broadcast;
+    struct edge_stats edge;
+
+    phy_stats_get(&phy);
+    LOG_INF("phy: 1M %u ms %u tx, 2M %u ms %u tx, coded %u ms %u tx, %u rejected, %lld us airtime saved",
+        phy.residency_ms[PHY_MODE_1M], phy.tx_packets[PHY_MODE_1M],
+        phy.residency_ms[PHY_MODE_2M], phy.tx_packets[PHY_MODE_2M],
+        phy.residency_ms[PHY_MODE_CODED], phy.tx_packets[PHY_MODE_CODED],
+        phy.rejected, phy.airtime_saved_us);
+
+    txpower_stats_get(&txpower);
+    LOG_INF("txpower: %u steps up, %u steps down", txpower.step_ups, txpower.step_downs);
+    for (int i = 0; i < TXPOWER_LEVEL_COUNT; i++) {
+        if (txpower.residency_ms[i]) {
+            LOG_INF("txpower: %d dBm for %u ms", txpower.level_dbm[i], txpower.residency_ms[i]);
+        }
+    }
+
+    wake_stats_get(&wake);
+    LOG_INF("wake: %u triggers, %u suppressed, %u false, ready %u (%u subrated) last %u min %u max %u avg %u ms",
+        wake.triggers, wake.suppressed, wake.false_triggers, wake.ready_count, wake.ready_subrated,
+        wake.ready_last_ms, wake.ready_min_ms, wake.ready_max_ms, wake.ready_avg_ms);
+
+    dfu_stats_get(&dfu);
+    LOG_INF("dfu: %u uploads, %u aborted, last %u bytes in %u ms, %u B/s",
+        dfu.uploads, dfu.aborted, dfu.last_size, dfu.last_duration_ms, dfu.last_bps);
+
+    history_stats_get(&history);
+    LOG_INF("history: %u samples, %u blocks, %u rotations, %u bytes streamed",
+        history.samples, history.blocks, history.rotations, history.streamed);
+
+    blelog_stats_get(&blelog);
+    LOG_INF("blelog: %u bytes, %u sent, %u dropped, %u cycles per call filtered, %u recorded",
+        blelog.bytes, blelog.sent, blelog.dropped, blelog.cycles_filtered, blelog.cycles_recorded);
+
+    probe_stats_get(&probe);
+    LOG_INF("probe: %u echoed, %u in HID reports, %u failed", probe.echoed, probe.hid_echoed, probe.failed);
+
+    for (uint8_t i = 0; i < HUB_REMOTES_MAX; i++) {
+        hub_remote_stats_get(i, &remote);
+        LOG_INF("hub: remote %u %u events, interval %u, %u interval misses, forward max %u us",
+            i, remote.events, remote.interval, remote.interval_misses, remote.forward_max_us);
+    }
+
+    broadcast_stats_get(&broadcast);
+    LOG_INF("broadcast: %u events, %u failed updates", broadcast.events, broadcast.failed);
+
+    edge_stats_get(&edge);
+    LOG_INF("edge: %u timestamped, edge to report last %u min %u max %u avg %u us",
+        edge.count, edge.last_us, edge.min_us, edge.max_us, edge.avg_us);
+}
+
+
+void telemetry_log(void)
+{
+    const struct telemetry_header *header = (const struct telemetry_header *)snapshot_buf;
+    const struct telemetry_thread *threads;
+    const struct telemetry_pool *pools;
+
+    stats_log();
+
+    k_mutex_lock(&snapshot_lock, K_FOREVER);
+    if (snapshot_refresh() || snapshot_len == 0) {
+        k_mutex_unlock(&snapshot_lock);
+        return;
+    }
+
+    threads = (const struct telemetry_thread *)(snapshot_buf + sizeof(*header));
+    for (uint8_t i = 0; i < header->thread_count; i++) {
+        LOG_INF("thread %.8s: stack %u/%u unused, cpu %u permille",
+            threads[i].name, threads[i].stack_unused, threads[i].stack_size, threads[i].cpu_permille);
+    }
+
+    pools = (const struct telemetry_pool *)&threads[header->thread_count];
+    for (uint8_t i = 0; i < header->pool_count; i++) {
+        LOG_INF("pool %.8s: %u used, peak %u of %u",
+            pools[i].name, pools[i].used, pools[i].max_used, pools[i].buf_count);
+    }
+    k_mutex_unlock(&snapshot_lock);
+}
+
+
+static ssize_t read_snapshot(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+    ssize_t rc;
+
+    k_mutex_lock(&snapshot_lock, K_FOREVER);
+
+    // take a fresh snapshot on the first chunk of a long read only, and keep
+    // it until that read is done so another reader cannot tear it
+    if (offset == 0) {
+        if (snapshot_refresh()) {
+            k_mutex_unlock(&snapshot_lock);
+            return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+        }
+        if (!snapshot_reader && snapshot_len > len) {
+            snapshot_reader = conn;
+        }
+    }
+
+    rc = bt_gatt_attr_read(conn, attr, buf, len, offset, snapshot_buf, snapshot_len);
+    if (conn == snapshot_reader && offset + len >= snapshot_len) {
+        snapshot_reader = NULL;
+    }
+
+    k_mutex_unlock(&snapshot_lock);
+    return rc;
+}
+
+
+BT_GATT_SERVICE_DEFINE(telemetry_svc,
+    BT_GATT_PRIMARY_SERVICE(
+        &telemetry_service_uuid
+    ),
+
+    BT_GATT_CHARACTERISTIC(
+        &telemetry_snapshot_uuid.uuid,
+        BT_GATT_CHRC_READ,
+        BT_GATT_PERM_READ_ENCRYPT,
+        read_snapshot, NULL, NULL
+    ),
+);
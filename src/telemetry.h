@@ -0,0 +1,76 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <zephyr/toolchain.h>
+
+/* Vendor service UUIDs share the base 7472796b-6b65-7274-xxxx-000000000000 ("trykkert"). */
+#define BT_UUID_TELEMETRY_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0100, 0x000000000000)
+#define BT_UUID_TELEMETRY_SNAPSHOT_VAL \
+    BT_UUID_128_ENCODE(0x7472796b, 0x6b65, 0x7274, 0x0101, 0x000000000000)
+
+#define TELEMETRY_VERSION     2
+#define TELEMETRY_THREADS_MAX 12
+#define TELEMETRY_POOLS_MAX   12
+#define TELEMETRY_NAME_LEN    8
+
+/* Snapshot layout, little endian:
+ *
+ * struct telemetry_header
+ * struct telemetry_thread * thread_count
+ * struct telemetry_pool   * pool_count
+ */
+struct __packed telemetry_header {
+    uint8_t version;
+    uint8_t thread_count;
+    uint8_t pool_count;
+    uint8_t reserved;
+};
+
+struct __packed telemetry_thread {
+    char name[TELEMETRY_NAME_LEN] __nonstring; // NUL padded, not terminated at full length
+    uint16_t stack_size;
+    uint16_t stack_unused;  // bytes never touched since boot
+    uint16_t cpu_permille;  // share of all execution cycles since boot
+};
+
+struct __packed telemetry_pool {
+    char name[TELEMETRY_NAME_LEN] __nonstring;
+    uint16_t buf_count;
+    uint16_t used;          // buffers allocated when the snapshot was taken
+    uint16_t max_used;      // high-water mark since boot
+};
+
+#if defined(CONFIG_APP_TELEMETRY)
+
+/**
+ * @brief Collect a telemetry snapshot.
+ *
+ * @param[out] buf Buffer where the snapshot is written.
+ * @param[in] len Size of the buffer.
+ *
+ * @retval Length of the snapshot. Negative errno number on error.
+ */
+int telemetry_snapshot(uint8_t *buf, size_t len);
+
+/**
+ * @brief Log the statistics of the other modules, a line or a few each,
+ *        and a telemetry snapshot, one line per thread and pool.
+ */
+void telemetry_log(void);
+
+#else
+
+static inline int telemetry_snapshot(uint8_t *buf, size_t len)
+{
+    return -ENOTSUP;
+}
+
+static inline void telemetry_log(void)
+{
+}
+
+#endif
@@ -0,0 +1,408 @@
+#include "txpower.h"
+#include "link.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME txpower
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+#define TXPOWER_PEER_ASSUMED_DBM 0    // peer TX power when it does not report one
+#define TXPOWER_UNKNOWN          127
+
+static const int8_t txpower_levels[TXPOWER_LEVEL_COUNT] = TXPOWER_LEVELS;
+
+static struct txpower_ctx {
+    struct bt_conn *conn;
+    uint8_t level;          // index into txpower_levels
+    int8_t peer_tx_dbm;     // from LE Power Control reports, TXPOWER_UNKNOWN if not reported
+    uint8_t good_samples;
+    bool stepped_up;        // fast step up already taken during this sample window
+    int64_t level_since;
+    struct k_work setup_work;
+    struct k_work step_up_work;
+} txpower_ctx[CONFIG_BT_MAX_CONN];
+
+static struct k_spinlock txpower_lock;
+static struct txpower_stats txpower_stats;
+
+static uint8_t txpower_top;                             // strongest level the radio supports
+static uint8_t txpower_bottom = TXPOWER_LEVEL_COUNT - 1; // weakest level the radio supports
+static bool txpower_range_known;
+
+
+static int txpower_write(uint8_t handle_type, uint16_t handle, int8_t dbm)
+{
+    struct bt_hci_cp_vs_write_tx_power_level *cp;
+    struct bt_hci_rp_vs_write_tx_power_level *rp;
+    struct net_buf *buf, *rsp = NULL;
+    int err;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle = sys_cpu_to_le16(handle);
+    cp->handle_type = handle_type;
+    cp->tx_power_level = dbm;
+
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, buf, &rsp);
+    if (err) {
+        return err;
+    }
+
+    rp = (void *)rsp->data;
+    LOG_DBG("TX power %d dBm selected %d dBm", dbm, rp->selected_tx_power);
+    net_buf_unref(rsp);
+
+    return 0;
+}
+
+
+/* Narrow the level table to the range this radio supports, read once from the controller. */
+static void txpower_range_read(void)
+{
+    struct bt_hci_rp_le_read_tx_power *rp;
+    struct net_buf *rsp = NULL;
+    uint8_t top = 0;
+    uint8_t bottom = TXPOWER_LEVEL_COUNT - 1;
+    int err;
+
+    if (txpower_range_known) {
+        return;
+    }
+
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_LE_READ_TX_POWER, NULL, &rsp);
+    if (err) {
+        LOG_WRN("Failed to read TX power range (err %d)\n", err);
+        return;
+    }
+
+    rp = (void *)rsp->data;
+    while (top < bottom && txpower_levels[top] > rp->max_tx_power) {
+        top++;
+    }
+    while (bottom > top && txpower_levels[bottom] < rp->min_tx_power) {
+        bottom--;
+    }
+    net_buf_unref(rsp);
+
+    txpower_top = top;
+    txpower_bottom = bottom;
+    txpower_range_known = true;
+    LOG_INF("TX power levels %d to %d dBm\n", txpower_levels[top], txpower_levels[bottom]);
+}
+
+
+static uint8_t txpower_level_find(int8_t dbm)
+{
+    for (uint8_t i = txpower_top; i < txpower_bottom; i++) {
+        if (txpower_levels[i] <= dbm) {
+            return i;
+        }
+    }
+    return txpower_bottom;
+}
+
+
+/* Must be called with txpower_lock held. */
+static void txpower_residency_account(struct txpower_ctx *ctx)
+{
+    int64_t now = k_uptime_get();
+
+    txpower_stats.residency_ms[ctx->level] += (uint32_t)(now - ctx->level_since);
+    ctx->level_since = now;
+}
+
+
+static void txpower_level_set(struct txpower_ctx *ctx, int level)
+{
+    k_spinlock_key_t key;
+    uint16_t handle;
+    int err;
+
+    level = CLAMP(level, txpower_top, txpower_bottom);
+    if (level == ctx->level) {
+        return;
+    }
+
+    err = bt_hci_get_conn_handle(ctx->conn, &handle);
+    if (!err) {
+        err = txpower_write(BT_HCI_VS_LL_HANDLE_TYPE_CONN, handle, txpower_levels[level]);
+    }
+    if (err) {
+        LOG_WRN("Failed to set TX power %d dBm (err %d)\n", txpower_levels[level], err);
+        return;
+    }
+
+    key = k_spin_lock(&txpower_lock);
+    txpower_residency_account(ctx);
+    if (level < ctx->level) {
+        txpower_stats.step_ups++;
+    } else {
+        txpower_stats.step_downs++;
+    }
+    ctx->level = level;
+    k_spin_unlock(&txpower_lock, key);
+
+    LOG_INF("Connection TX power %d dBm\n", txpower_levels[level]);
+}
+
+
+static void step_up_work_handler(struct k_work *work)
+{
+    struct txpower_ctx *ctx = CONTAINER_OF(work, struct txpower_ctx, step_up_work);
+
+    if (!ctx->conn || ctx->stepped_up) {
+        return;
+    }
+
+    ctx->good_samples = 0;
+    ctx->stepped_up = true;
+    txpower_level_set(ctx, ctx->level - TXPOWER_STEP_UP_LEVELS);
+}
+
+
+static void setup_work_handler(struct k_work *work)
+{
+    struct txpower_ctx *ctx = CONTAINER_OF(work, struct txpower_ctx, setup_work);
+    k_spinlock_key_t key;
+    uint16_t handle;
+    int err;
+
+    if (!ctx->conn) {
+        return;
+    }
+
+    // a central connection can come up before anything was advertised
+    txpower_range_read();
+    key = k_spin_lock(&txpower_lock);
+    ctx->level = CLAMP(ctx->level, txpower_top, txpower_bottom);
+    k_spin_unlock(&txpower_lock, key);
+
+    err = bt_hci_get_conn_handle(ctx->conn, &handle);
+    if (!err) {
+        err = txpower_write(BT_HCI_VS_LL_HANDLE_TYPE_CONN, handle, txpower_levels[ctx->level]);
+    }
+    if (err) {
+        LOG_WRN("Failed to set initial TX power (err %d)\n", err);
+    }
+
+#if defined(CONFIG_BT_TRANSMIT_POWER_CONTROL)
+    // peer TX power turns our RSSI into a real path loss figure
+    err = bt_conn_le_set_tx_power_report_enable(ctx->conn, false, true);
+    if (!err) {
+        err = bt_conn_le_get_remote_tx_power_level(ctx->conn, BT_CONN_LE_TX_POWER_PHY_1M);
+    }
+    if (err) {
+        LOG_INF("Peer TX power reporting unavailable (err %d)\n", err);
+    }
+#endif
+}
+
+
+static void link_sampled(struct bt_conn *conn, const struct link_quality *quality)
+{
+    struct txpower_ctx *ctx = &txpower_ctx[bt_conn_index(conn)];
+    bool stepped_up = ctx->stepped_up;
+    int8_t peer_tx_dbm;
+    int path_loss;
+    int rx_est;
+
+    if (ctx->conn != conn) {
+        return;
+    }
+    ctx->stepped_up = false;
+
+    if (quality->tx_late || quality->tx_failed) {
+        ctx->good_samples = 0;
+        if (!stepped_up) {
+            txpower_level_set(ctx, ctx->level - TXPOWER_STEP_UP_LEVELS);
+        }
+        return;
+    }
+
+    if (quality->rssi == LINK_RSSI_UNKNOWN) {
+        return;
+    }
+
+    peer_tx_dbm = ctx->peer_tx_dbm;
+    if (peer_tx_dbm == TXPOWER_UNKNOWN) {
+        peer_tx_dbm = TXPOWER_PEER_ASSUMED_DBM;
+    }
+
+    // estimated RSSI at the peer, assuming a reciprocal channel
+    path_loss = peer_tx_dbm - quality->rssi;
+    rx_est = txpower_levels[ctx->level] - path_loss;
+
+    if (rx_est < TXPOWER_TARGET_RSSI_DBM) {
+        ctx->good_samples = 0;
+        txpower_level_set(ctx, ctx->level - 1);
+    } else if (ctx->level < txpower_bottom &&
+               rx_est - (txpower_levels[ctx->level] - txpower_levels[ctx->level + 1]) >=
+               TXPOWER_TARGET_RSSI_DBM + TXPOWER_MARGIN_DB) {
+        if (++ctx->good_samples >= TXPOWER_GOOD_SAMPLES) {
+            ctx->good_samples = 0;
+            txpower_level_set(ctx, ctx->level + 1);
+        }
+    } else {
+        ctx->good_samples = 0;
+    }
+}
+
+
+static void link_tx_late(struct bt_conn *conn)
+{
+    struct txpower_ctx *ctx = &txpower_ctx[bt_conn_index(conn)];
+
+    if (ctx->conn == conn) {
+        k_work_submit(&ctx->step_up_work);
+    }
+}
+
+
+static struct link_cb txpower_link_cb = {
+    .sampled = link_sampled,
+    .tx_late = link_tx_late,
+};
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err) {
+        return;
+    }
+
+    struct txpower_ctx *ctx = &txpower_ctx[bt_conn_index(conn)];
+
+    ctx->conn = conn;
+    ctx->level = txpower_level_find(TXPOWER_CONN_START_DBM);
+    ctx->peer_tx_dbm = TXPOWER_UNKNOWN;
+    ctx->good_samples = 0;
+    ctx->stepped_up = false;
+    ctx->level_since = k_uptime_get();
+
+    k_work_submit(&ctx->setup_work);
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct txpower_ctx *ctx = &txpower_ctx[bt_conn_index(conn)];
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(reason);
+
+    if (ctx->conn != conn) {
+        return;
+    }
+
+    key = k_spin_lock(&txpower_lock);
+    txpower_residency_account(ctx);
+    ctx->conn = NULL;
+    k_spin_unlock(&txpower_lock, key);
+}
+
+
+#if defined(CONFIG_BT_TRANSMIT_POWER_CONTROL)
+static void tx_power_report(struct bt_conn *conn, const struct bt_conn_le_tx_power_report *report)
+{
+    struct txpower_ctx *ctx = &txpower_ctx[bt_conn_index(conn)];
+
+    if (ctx->conn != conn || report->reason == BT_HCI_LE_TX_POWER_REPORT_REASON_LOCAL_CHANGED) {
+        return;
+    }
+
+    if (report->tx_power_level == BT_HCI_LE_TX_POWER_LEVEL_NOT_AVAILABLE ||
+        report->tx_power_level == BT_HCI_LE_TX_POWER_LEVEL_NOT_MANAGED) {
+        ctx->peer_tx_dbm = TXPOWER_UNKNOWN;
+    } else {
+        ctx->peer_tx_dbm = report->tx_power_level;
+    }
+}
+#endif
+
+
+BT_CONN_CB_DEFINE(txpower_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+#if defined(CONFIG_BT_TRANSMIT_POWER_CONTROL)
+    .tx_power_report = tx_power_report,
+#endif
+};
+
+
+#if defined(CONFIG_BT_EXT_ADV)
+static void adv_set_write(struct bt_le_ext_adv *adv, void *data)
+{
+    int *err = data;
+    int rc;
+
+    rc = txpower_write(BT_HCI_VS_LL_HANDLE_TYPE_ADV, bt_le_ext_adv_get_index(adv),
+                       txpower_levels[txpower_level_find(TXPOWER_ADV_DBM)]);
+    if (rc && !*err) {
+        *err = rc;
+    }
+}
+#endif
+
+
+int txpower_adv_set(void)
+{
+    int err = 0;
+
+    txpower_range_read();
+
+#if defined(CONFIG_BT_EXT_ADV)
+    // the connectable advertiser and the broadcast share the set pool, in creation order
+    bt_le_ext_adv_foreach(adv_set_write, &err);
+#else
+    // without extended advertising the host drives the one legacy set, handle 0
+    err = txpower_write(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, txpower_levels[txpower_level_find(TXPOWER_ADV_DBM)]);
+#endif
+    return err;
+}
+
+
+void txpower_stats_get(struct txpower_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&txpower_lock);
+
+    for (size_t i = 0; i < ARRAY_SIZE(txpower_ctx); i++) {
+        if (txpower_ctx[i].conn) {
+            txpower_residency_account(&txpower_ctx[i]);
+        }
+    }
+
+    for (size_t i = 0; i < TXPOWER_LEVEL_COUNT; i++) {
+        txpower_stats.level_dbm[i] = txpower_levels[i];
+    }
+
+    *stats = txpower_stats;
+    k_spin_unlock(&txpower_lock, key);
+}
+
+
+int txpower_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(txpower_ctx); i++) {
+        k_work_init(&txpower_ctx[i].setup_work, setup_work_handler);
+        k_work_init(&txpower_ctx[i].step_up_work, step_up_work_handler);
+    }
+
+    link_cb_register(&txpower_link_cb);
+
+    LOG_INF("Initialized");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define TXPOWER_ADV_DBM          0     // advertising power, the host may be across the room when pairing
+#define TXPOWER_CONN_START_DBM   0     // connection power before the loop has any samples
+#define TXPOWER_TARGET_RSSI_DBM  (-70) // RSSI we aim for at the receiver
+#define TXPOWER_MARGIN_DB        6     // hysteresis band above the target before stepping down
+#define TXPOWER_GOOD_SAMPLES     2     // consecutive healthy link samples before stepping down
+#define TXPOWER_STEP_UP_LEVELS   2     // levels to jump up when packets need retransmission
+
+/* Output power levels of the nRF52840 radio, strongest first. Levels outside
+ * the range the controller reports, e.g. above +4 dBm on the nRF52810, are
+ * never used.
+ */
+#define TXPOWER_LEVELS { 8, 4, 0, -4, -8, -12, -16, -20 }
+#define TXPOWER_LEVEL_COUNT 8
+
+struct txpower_stats {
+    int8_t level_dbm[TXPOWER_LEVEL_COUNT];
+    uint32_t residency_ms[TXPOWER_LEVEL_COUNT]; // connection time spent at each level
+    uint32_t step_ups;                          // steps up forced by retransmissions or low RSSI
+    uint32_t step_downs;
+};
+
+#if defined(CONFIG_APP_TXPOWER_CONTROL)
+
+/**
+ * @brief Initialize closed-loop connection TX power control.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int txpower_init(void);
+
+/**
+ * @brief Apply the advertising TX power to every advertising set.
+ *        Call after advertising is started.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int txpower_adv_set(void);
+
+/**
+ * @brief Gets the accumulated per-level residency, including open connections.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void txpower_stats_get(struct txpower_stats *stats);
+
+#else
+
+static inline int txpower_init(void)
+{
+    return 0;
+}
+
+static inline int txpower_adv_set(void)
+{
+    return 0;
+}
+
+static inline void txpower_stats_get(struct txpower_stats *stats)
+{
+    *stats = (struct txpower_stats){ 0 };
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "usbhid.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/usb/usb_device.h>
+#include <zephyr/usb/class/usb_hid.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME usbhid
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_USB_DEVICE_HID)
+
+#define USBHID_REPORT_MAX   12 // Report ID plus the largest input report
+#define USBHID_QUEUE_LEN    16 // Covers a full pending replay behind one report on the wire
+
+struct usbhid_report {
+    uint8_t len;
+    uint8_t data[USBHID_REPORT_MAX];
+};
+
+K_MSGQ_DEFINE(usbhid_queue, sizeof(struct usbhid_report), USBHID_QUEUE_LEN, 4);
+
+static const struct device *hid_dev;
+static usbhid_state_changed_t state_changed_cb;
+static usbhid_vbus_changed_t vbus_changed_cb;
+
+static atomic_t usb_configured;
+static atomic_t usb_suspended;
+static bool usb_was_active;
+
+static struct k_work state_work;
+
+// Set while a report is on the interrupt endpoint, cleared by int_in_ready
+static atomic_t in_flight;
+static uint32_t write_cycles;
+static struct usbhid_stats stats;
+
+
+static void state_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    bool active = usbhid_is_active();
+
+    if (active == usb_was_active) {
+        return;
+    }
+    usb_was_active = active;
+
+    if (!active) {
+        // Whatever the host did not poll before the reset is stale now
+        k_msgq_purge(&usbhid_queue);
+        atomic_clear(&in_flight);
+    }
+
+    LOG_INF("USB transport %s\n", active ? "active" : "inactive");
+    if (state_changed_cb) {
+        state_changed_cb(active);
+    }
+}
+
+
+static void usb_status_cb(enum usb_dc_status_code status, const uint8_t *param)
+{
+    ARG_UNUSED(param);
+
+    switch (status) {
+    case USB_DC_CONNECTED: // VBUS detected
+        if (vbus_changed_cb) {
+            vbus_changed_cb(true);
+        }
+        return;
+    case USB_DC_CONFIGURED:
+        atomic_set(&usb_configured, 1);
+        atomic_set(&usb_suspended, 0);
+        break;
+    case USB_DC_DISCONNECTED: // VBUS removed
+        if (vbus_changed_cb) {
+            vbus_changed_cb(false);
+        }
+        atomic_set(&usb_configured, 0);
+        break;
+    case USB_DC_RESET:
+        atomic_set(&usb_configured, 0);
+        break;
+    case USB_DC_SUSPEND:
+        atomic_set(&usb_suspended, 1);
+        break;
+    case USB_DC_RESUME:
+        atomic_set(&usb_suspended, 0);
+        break;
+    default:
+        return;
+    }
+
+    k_work_submit(&state_work);
+}
+
+
+static int report_write(const uint8_t *report, size_t len)
+{
+    int err;
+
+    write_cycles = k_cycle_get_32();
+    err = hid_int_ep_write(hid_dev, report, len, NULL);
+    if (err) {
+        atomic_clear(&in_flight);
+    }
+    return err;
+}
+
+
+static void int_in_ready(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    struct usbhid_report next;
+    uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - write_cycles);
+
+    stats.sent++;
+    stats.latency_last_us = latency_us;
+    stats.latency_max_us = MAX(stats.latency_max_us, latency_us);
+
+    // The endpoint takes one report per host poll, so the next one goes out from here
+    while (k_msgq_get(&usbhid_queue, &next, K_NO_WAIT) == 0) {
+        if (report_write(next.data, next.len) == 0) {
+            return;
+        }
+        stats.dropped++;
+    }
+    atomic_clear(&in_flight);
+}
+
+
+static const struct hid_ops ops = {
+    .int_in_ready = int_in_ready,
+};
+
+
+int usbhid_init(const uint8_t *report_map, size_t report_map_len, usbhid_state_changed_t cb)
+{
+    int err;
+
+    state_changed_cb = cb;
+    k_work_init(&state_work, state_work_handler);
+
+    hid_dev = device_get_binding("HID_0");
+    if (!hid_dev) {
+        LOG_ERR("USB HID device not found!");
+        return -ENODEV;
+    }
+
+    usb_hid_register_device(hid_dev, report_map, report_map_len, &ops);
+
+    err = usb_hid_set_proto_code(hid_dev, HID_BOOT_IFACE_CODE_KEYBOARD);
+    if (err) {
+        return err;
+    }
+
+    err = usb_hid_init(hid_dev);
+    if (err) {
+        return err;
+    }
+
+    err = usb_enable(usb_status_cb);
+    if (err) {
+        LOG_ERR("Failed to enable USB (err %d)", err);
+        return err;
+    }
+
+    LOG_INF("Initialized");
+    return 0;
+}
+
+
+void usbhid_vbus_handler_set(usbhid_vbus_changed_t handler)
+{
+    vbus_changed_cb = handler;
+}
+
+
+bool usbhid_is_active(void)
+{
+    return atomic_get(&usb_configured) && !atomic_get(&usb_suspended);
+}
+
+
+int usbhid_send(const uint8_t *report, size_t len)
+{
+    struct usbhid_report queued;
+    int err;
+
+    if (!usbhid_is_active()) {
+        return -ENOTCONN;
+    }
+    if (len > sizeof(queued.data)) {
+        return -EMSGSIZE;
+    }
+
+    if (atomic_cas(&in_flight, 0, 1)) {
+        return report_write(report, len);
+    }
+
+    queued.len = len;
+    memcpy(queued.data, report, len);
+    err = k_msgq_put(&usbhid_queue, &queued, K_NO_WAIT);
+    if (err) {
+        stats.dropped++;
+        return -ENOMEM;
+    }
+
+    // int_in_ready may have emptied the queue between the check and the put
+    if (atomic_cas(&in_flight, 0, 1) && k_msgq_get(&usbhid_queue, &queued, K_NO_WAIT) == 0) {
+        return report_write(queued.data, queued.len);
+    }
+    return 0;
+}
+
+
+void usbhid_stats_get(struct usbhid_stats *out)
+{
+    *out = stats;
+}
+
+#endif
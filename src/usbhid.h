@@ -0,0 +1,88 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+
+typedef void (*usbhid_state_changed_t)(bool active);
+typedef void (*usbhid_vbus_changed_t)(bool present);
+
+struct usbhid_stats {
+    uint32_t sent;            // Reports the host has polled
+    uint32_t dropped;         // Reports lost to a full queue or an endpoint error
+    uint32_t latency_last_us; // Endpoint write to host poll of the last report
+    uint32_t latency_max_us;
+};
+
+#if defined(CONFIG_USB_DEVICE_HID)
+
+/**
+ * @brief Register the keyboard on USB and enable the USB device stack.
+ *
+ * The interface is only used while VBUS is present and the host has
+ * configured the device.
+ *
+ * @param[in] report_map HID report map shared with the BLE service.
+ * @param[in] report_map_len Length of the report map.
+ * @param[in] cb Called from the system workqueue when the transport becomes active or inactive.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int usbhid_init(const uint8_t *report_map, size_t report_map_len, usbhid_state_changed_t cb);
+
+/**
+ * @brief Set a handler for the USB VBUS detected and removed events.
+ *
+ * @param[in] handler Called from the USB driver context with the new VBUS state.
+ */
+void usbhid_vbus_handler_set(usbhid_vbus_changed_t handler);
+
+/**
+ * @brief Check if the USB host is ready to receive input reports.
+ */
+bool usbhid_is_active(void);
+
+/**
+ * @brief Send an input report on the interrupt endpoint.
+ *
+ * Reports are queued while the previous one waits for the host to poll,
+ * so a burst is delivered in order instead of failing on a busy endpoint.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int usbhid_send(const uint8_t *report, size_t len);
+
+/**
+ * @brief Get the interrupt endpoint delivery counters.
+ *
+ * @param[out] out Copy of the counters since boot.
+ */
+void usbhid_stats_get(struct usbhid_stats *out);
+
+#else
+
+static inline int usbhid_init(const uint8_t *report_map, size_t report_map_len, usbhid_state_changed_t cb)
+{
+    return 0;
+}
+
+static inline void usbhid_vbus_handler_set(usbhid_vbus_changed_t handler)
+{
+}
+
+static inline bool usbhid_is_active(void)
+{
+    return false;
+}
+
+static inline int usbhid_send(const uint8_t *report, size_t len)
+{
+    return -ENOTSUP;
+}
+
+static inline void usbhid_stats_get(struct usbhid_stats *out)
+{
+    *out = (struct usbhid_stats){ 0 };
+}
+
+#endif
@@ -0,0 +1,371 @@
+#include "wake.h"
+#include "hid.h"
+#include "imu.h"
+#include "gpio.h"
+#include "dfu.h"
+#include "governor.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#define LOG_MODULE_NAME wake
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+
+/* Whether the host takes subrate requests is known once its features are read */
+enum subrate_support {
+    SUBRATE_UNKNOWN = 0,
+    SUBRATE_SUPPORTED,
+    SUBRATE_UNSUPPORTED,
+};
+
+static struct bt_conn *wake_conn;
+static bool link_fast;
+static bool want_fast;
+static uint16_t link_interval;
+static uint16_t link_factor = 1;
+static enum subrate_support subrate_support;
+
+static int64_t pickup_at;        // 0 when no pick-up is waiting for a ready link
+static int64_t holdoff_until;
+static uint32_t holdoff_ms = WAKE_HOLDOFF_MS;
+static uint64_t ready_sum_ms;
+
+static struct wake_stats wake_stats;
+
+static struct k_work motion_work;
+static struct k_work contact_work;
+static struct k_work_delayable confirm_work;
+static struct k_work_delayable idle_work;
+
+
+static bool link_is_fast(void)
+{
+    return link_interval <= governor_policy_get()->conn_fast_int_max && link_factor == 1;
+}
+
+
+#if defined(CONFIG_APP_CONN_SUBRATING)
+static int subrate_request(bool fast)
+{
+    const struct governor_policy *policy = governor_policy_get();
+    uint16_t factor = fast ? 1 : CLAMP(policy->conn_idle_int_max / link_interval, 1, WAKE_SUBRATE_MAX);
+    const struct bt_conn_le_subrate_param param = {
+        .subrate_min = factor,
+        .subrate_max = factor,
+        .max_latency = 0,
+        .continuation_number = MIN(WAKE_SUBRATE_CONT, factor - 1),
+        .supervision_timeout = WAKE_SUP_TIMEOUT,
+    };
+
+    if (factor == link_factor) {
+        return 0;
+    }
+    return bt_conn_le_subrate_request(wake_conn, &param);
+}
+#else
+static int subrate_request(bool fast)
+{
+    return -ENOTSUP;
+}
+#endif
+
+
+static void link_params_request(bool fast)
+{
+    const struct governor_policy *policy = governor_policy_get();
+    int err;
+
+    if (!wake_conn) {
+        return;
+    }
+    want_fast = fast;
+
+    if (subrate_support == SUBRATE_SUPPORTED) {
+        if (link_interval <= policy->conn_fast_int_max) {
+            // only the factor changes, in effect from the next subrated event
+            err = subrate_request(fast);
+            if (!err) {
+                return;
+            }
+            LOG_WRN("Subrate request failed (err %d)\n", err);
+            subrate_support = SUBRATE_UNSUPPORTED;
+        } else {
+            // the fast base interval first, le_param_updated() subrates from there
+            fast = true;
+        }
+    }
+
+    err = bt_conn_le_param_update(wake_conn, fast ?
+        BT_LE_CONN_PARAM(policy->conn_fast_int_min, policy->conn_fast_int_max, 0, WAKE_SUP_TIMEOUT) :
+        BT_LE_CONN_PARAM(policy->conn_idle_int_min, policy->conn_idle_int_max, 0, WAKE_SUP_TIMEOUT));
+    if (err) {
+        LOG_WRN("Connection parameter update failed (err %d)\n", err);
+    }
+}
+
+
+static void ready_record(bool subrated)
+{
+    uint32_t elapsed_ms;
+
+    if (!pickup_at) {
+        return;
+    }
+
+    elapsed_ms = (uint32_t)(k_uptime_get() - pickup_at);
+    pickup_at = 0;
+
+    wake_stats.ready_count++;
+    if (subrated) {
+        wake_stats.ready_subrated++;
+    }
+    wake_stats.ready_last_ms = elapsed_ms;
+    if (wake_stats.ready_count == 1 || elapsed_ms < wake_stats.ready_min_ms) {
+        wake_stats.ready_min_ms = elapsed_ms;
+    }
+    wake_stats.ready_max_ms = MAX(wake_stats.ready_max_ms, elapsed_ms);
+    ready_sum_ms += elapsed_ms;
+    wake_stats.ready_avg_ms = ready_sum_ms / wake_stats.ready_count;
+
+    LOG_INF("Pick-up to ready %u ms%s\n", elapsed_ms, subrated ? " (subrated)" : "");
+}
+
+
+static void pickup(bool from_motion)
+{
+    int64_t now = k_uptime_get();
+
+    if (from_motion) {
+        // walking around with the clicker in a pocket must not keep the radio busy
+        if (now < holdoff_until) {
+            wake_stats.suppressed++;
+            return;
+        }
+        holdoff_until = now + holdoff_ms;
+        k_work_reschedule(&confirm_work, K_MSEC(WAKE_CONFIRM_MS));
+    }
+    wake_stats.triggers++;
+
+    k_work_reschedule(&idle_work, K_MSEC(WAKE_IDLE_TIMEOUT_MS));
+
+    if (wake_conn) {
+        if (link_fast) {
+            return; // already ready
+        }
+        pickup_at = now;
+        link_params_request(true);
+    } else {
+        pickup_at = now;
+        advertising_start(); // fast advertising, or back to it from the slow interval
+    }
+}
+
+
+static void motion_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    pickup(true);
+}
+
+
+static void contact_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    pickup(false);
+}
+
+
+static void imu_woken(void)
+{
+    k_work_submit(&motion_work);
+}
+
+
+static void button_contact(void)
+{
+    k_work_submit(&contact_work);
+}
+
+
+static void confirm_expired(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    wake_stats.false_triggers++;
+    holdoff_ms = MIN(holdoff_ms * 2, WAKE_HOLDOFF_MAX_MS);
+    LOG_INF("False pick-up, holdoff %u ms\n", holdoff_ms);
+}
+
+
+static void idle_expired(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    if (dfu_in_progress()) {
+        // an upload holds its own fast parameters, check again later
+        k_work_reschedule(&idle_work, K_MSEC(WAKE_IDLE_TIMEOUT_MS));
+        return;
+    }
+    if (link_fast) {
+        link_params_request(false);
+    }
+}
+
+
+void wake_input(void)
+{
+    k_work_cancel_delayable(&confirm_work);
+    holdoff_ms = WAKE_HOLDOFF_MS;
+
+    k_work_reschedule(&idle_work, K_MSEC(WAKE_IDLE_TIMEOUT_MS));
+    if (wake_conn && !link_fast) {
+        link_params_request(true);
+    }
+}
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    struct bt_conn_info info;
+
+    if (err || wake_conn) {
+        return;
+    }
+    if (bt_conn_get_info(conn, &info) || info.role != BT_CONN_ROLE_PERIPHERAL) {
+        return; // hub links to remotes are not the host link
+    }
+
+    wake_conn = conn;
+    want_fast = true;
+    link_interval = info.le.interval;
+    link_factor = 1;
+    subrate_support = SUBRATE_UNKNOWN;
+    link_fast = link_is_fast();
+
+    ready_record(false);
+    k_work_reschedule(&idle_work, K_MSEC(WAKE_IDLE_TIMEOUT_MS));
+}
+
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    ARG_UNUSED(reason);
+
+    if (conn != wake_conn) {
+        return;
+    }
+
+    wake_conn = NULL;
+    link_fast = false;
+    link_factor = 1;
+    subrate_support = SUBRATE_UNKNOWN;
+    k_work_cancel_delayable(&idle_work);
+}
+
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    ARG_UNUSED(latency);
+    ARG_UNUSED(timeout);
+
+    if (conn != wake_conn) {
+        return;
+    }
+
+    link_interval = interval;
+    link_fast = link_is_fast();
+    if (link_fast) {
+        ready_record(false);
+        if (subrate_support == SUBRATE_SUPPORTED && !want_fast) {
+            link_params_request(false); // on the base interval now, idle by the factor
+        }
+    }
+}
+
+
+#if defined(CONFIG_APP_CONN_SUBRATING)
+static void remote_info_available(struct bt_conn *conn, struct bt_conn_remote_info *remote_info)
+{
+    if (conn != wake_conn) {
+        return;
+    }
+
+    subrate_support = BT_FEAT_LE_CONN_SUBRATING(remote_info->le.features) ?
+        SUBRATE_SUPPORTED : SUBRATE_UNSUPPORTED;
+    LOG_INF("Host %s subrating\n", subrate_support == SUBRATE_SUPPORTED ? "supports" : "does not support");
+}
+
+
+static void subrate_changed(struct bt_conn *conn, const struct bt_conn_le_subrate_changed *params)
+{
+    if (conn != wake_conn) {
+        return;
+    }
+
+    if (params->status) {
+        // rejected by the host or its controller, fall back to parameter updates
+        LOG_WRN("Subrate change failed (status 0x%02x)\n", params->status);
+        subrate_support = SUBRATE_UNSUPPORTED;
+        link_params_request(want_fast);
+        return;
+    }
+
+    link_factor = params->factor;
+    link_fast = link_is_fast();
+    if (link_fast) {
+        ready_record(true);
+    }
+}
+#endif
+
+
+void wake_params_refresh(void)
+{
+    link_params_request(link_fast);
+}
+
+
+BT_CONN_CB_DEFINE(wake_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+#if defined(CONFIG_APP_CONN_SUBRATING)
+    .remote_info_available = remote_info_available,
+    .subrate_changed = subrate_changed,
+#endif
+};
+
+
+void wake_stats_get(struct wake_stats *stats)
+{
+    *stats = wake_stats;
+}
+
+
+int wake_init(void)
+{
+    int err;
+
+    k_work_init(&motion_work, motion_handler);
+    k_work_init(&contact_work, contact_handler);
+    k_work_init_delayable(&confirm_work, confirm_expired);
+    k_work_init_delayable(&idle_work, idle_expired);
+
+    gpio_contact_handler_set(button_contact);
+
+    err = imu_wake_enable(imu_woken);
+    if (err && err != -ENODEV) {
+        LOG_ERR("IMU wake-up enable failed (err %d)", err);
+        return err;
+    }
+
+    LOG_INF("Initialized (%s)", err ? "first contact" : "wake-on-motion");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <zephyr/types.h>
+
+#define WAKE_IDLE_TIMEOUT_MS  60000   // no input for this long moves the link to idle parameters
+#define WAKE_CONFIRM_MS       60000   // a pick-up without a press within this time was a false trigger
+#define WAKE_HOLDOFF_MS       10000   // pick-ups ignored after a trigger
+#define WAKE_HOLDOFF_MAX_MS   600000  // holdoff doubles on every false trigger up to this limit
+
+/* Connection parameters in 1.25 ms units, used at the normal governor tier */
+#define WAKE_FAST_INT_MIN     6
+#define WAKE_FAST_INT_MAX     12
+#define WAKE_IDLE_INT_MIN     80
+#define WAKE_IDLE_INT_MAX     100
+#define WAKE_SUP_TIMEOUT      400
+
+/* Idle by subrating: the link stays on the fast interval and only every
+ * factor-th connection event is used, about the idle interval apart
+ */
+#define WAKE_SUBRATE_MAX      32
+#define WAKE_SUBRATE_CONT     0       // no extra events after a packet while idle
+
+struct wake_stats {
+    uint32_t triggers;        // pick-ups acted on
+    uint32_t suppressed;      // pick-ups ignored during holdoff
+    uint32_t false_triggers;  // pick-ups not followed by a press
+    uint32_t ready_count;     // pick-ups that reached a ready link
+    uint32_t ready_subrated;  // of which by dropping the subrate factor
+    uint32_t ready_last_ms;   // pick-up to connected, or to fast parameters or subrate 1 applied
+    uint32_t ready_min_ms;
+    uint32_t ready_max_ms;
+    uint32_t ready_avg_ms;
+};
+
+/**
+ * @brief Initialize pick-up detection: IMU wake-up where available and the
+ *        first contact edge of the buttons.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int wake_init(void);
+
+/**
+ * @brief Report a debounced button press, confirms the last pick-up and
+ *        keeps the link on fast parameters.
+ */
+void wake_input(void);
+
+/**
+ * @brief Request the connection parameters of the current governor tier,
+ *        keeping the link fast or idle as it is.
+ */
+void wake_params_refresh(void);
+
+/**
+ * @brief Gets the pick-up statistics.
+ *
+ * @param[out] stats Pointer where the statistics are stored.
+ */
+void wake_stats_get(struct wake_stats *stats);
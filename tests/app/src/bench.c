@@ -0,0 +1,121 @@
+/* Cycle counts of the functions on the button and battery paths. Each
+ * benchmark fails once the average cost per call exceeds its ceiling, so a
+ * regression fails the twister run. Every run prints the measured counts;
+ * lower a ceiling to about 1.5 times its count after an intended speed-up.
+ *
+ * The counts are system timer cycles under QEMU icount, which follow the
+ * executed instructions and do not vary between runs.
+ */
+#include <zephyr/ztest.h>
+
+#include "battery.h"
+#include "governor.h"
+#include "pending.h"
+#include "periodic.h"
+
+#define BENCH_ITERATIONS        1000
+
+/* Ceilings in cycles per call. These are estimates and have not been
+ * measured yet: set each one to about 1.5 times the count printed by the
+ * first qemu_cortex_m3 run.
+ */
+#define BENCH_PERCENTAGE_MAX    400   // table walk and interpolation, mid-table level
+#define BENCH_PENDING_MAX       600   // one push, one peek and one pop
+#define BENCH_PERIODIC_MAX      900   // PERIODIC_JOBS_MAX jobs, none due
+#define BENCH_GOVERNOR_MAX      400   // sample that leaves the tier unchanged
+
+static struct periodic_job bench_jobs[PERIODIC_JOBS_MAX];
+
+
+static void job_never_due(void)
+{
+}
+
+
+static uint32_t bench_cycles(void (*fn)(void))
+{
+    uint32_t start, cycles;
+
+    fn(); // warm up, first-call paths are not the ones measured
+
+    start = k_cycle_get_32();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        fn();
+    }
+    cycles = k_cycle_get_32() - start;
+
+    return cycles / BENCH_ITERATIONS;
+}
+
+
+static void bench_check(const char *name, uint32_t cycles, uint32_t max)
+{
+    TC_PRINT("%s: %u cycles per call, ceiling %u\n", name, cycles, max);
+    zassert_true(cycles <= max, "%s regressed: %u cycles per call, ceiling %u", name, cycles, max);
+}
+
+
+static void percentage(void)
+{
+    int pct;
+
+    battery_get_percentage(&pct, 3700);
+}
+
+
+static void pending_push_pop(void)
+{
+    uint8_t mask;
+
+    pending_push(0b001);
+    pending_peek(&mask);
+    pending_pop();
+}
+
+
+static void periodic_pass(void)
+{
+    (void)periodic_process();
+}
+
+
+static void governor_sample(void)
+{
+    governor_battery_update(80, false);
+}
+
+
+ZTEST(bench, test_battery_percentage)
+{
+    bench_check("battery_get_percentage", bench_cycles(percentage), BENCH_PERCENTAGE_MAX);
+}
+
+
+ZTEST(bench, test_pending)
+{
+    bench_check("pending_push + pending_peek + pending_pop", bench_cycles(pending_push_pop), BENCH_PENDING_MAX);
+}
+
+
+ZTEST(bench, test_periodic_process)
+{
+    for (int i = 0; i < ARRAY_SIZE(bench_jobs); i++) {
+        periodic_job_init(&bench_jobs[i], job_never_due, 0);
+        periodic_start(&bench_jobs[i], 3600 * MSEC_PER_SEC, 3600 * MSEC_PER_SEC);
+    }
+
+    bench_check("periodic_process", bench_cycles(periodic_pass), BENCH_PERIODIC_MAX);
+
+    for (int i = 0; i < ARRAY_SIZE(bench_jobs); i++) {
+        periodic_stop(&bench_jobs[i]);
+    }
+}
+
+
+ZTEST(bench, test_governor_sample)
+{
+    zassert_ok(governor_init(NULL));
+    bench_check("governor_battery_update", bench_cycles(governor_sample), BENCH_GOVERNOR_MAX);
+}
+
+ZTEST_SUITE(bench, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,282 @@
+/* I2C emulator for the LSM6DS3TR-C registers imu.c uses: WHO_AM_I, the
+ * FIFO configuration and status, and FIFO_DATA_OUT, which pops one byte
+ * per read and does not auto-increment.
+ */
+#define DT_DRV_COMPAT st_lsm6dsl
+
+#include "emul_imu.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <string.h>
+
+#define REG_FIFO_CTRL1      0x06
+#define REG_FIFO_CTRL2      0x07
+#define REG_FIFO_CTRL5      0x0A
+#define REG_INT1_CTRL       0x0D
+#define REG_WHO_AM_I        0x0F
+#define REG_FIFO_STATUS1    0x3A
+#define REG_FIFO_STATUS2    0x3B
+#define REG_FIFO_DATA_OUT_L 0x3E
+#define REG_COUNT           0x80
+#define WHO_AM_I_VALUE      0x6A
+
+#define INT1_CTRL_FTH       0x08
+#define FIFO_STATUS2_WATERM 0x80
+#define FIFO_STATUS2_OVER_RUN 0x40
+
+#define FIFO_WORDS          2048 // 4 KiB FIFO of 16-bit words
+#define WORDS_PER_SAMPLE    3
+
+struct emul_imu_config {
+    struct gpio_dt_spec int1;
+};
+
+struct emul_imu_data {
+    struct k_spinlock lock;
+    uint8_t regs[REG_COUNT];
+    int16_t fifo[FIFO_WORDS];
+    uint16_t head;      // next word to read
+    uint16_t words;     // words in the FIFO
+    uint8_t byte_phase; // low or high byte of the head word
+    bool overrun;
+    bool int1;
+    int64_t int1_at;
+    uint16_t refill;
+    int16_t last[WORDS_PER_SAMPLE];
+};
+
+
+static uint16_t threshold_words(const struct emul_imu_data *data)
+{
+    return data->regs[REG_FIFO_CTRL1] | ((data->regs[REG_FIFO_CTRL2] & 0x07) << 8);
+}
+
+
+static bool fifo_enabled(const struct emul_imu_data *data)
+{
+    return (data->regs[REG_FIFO_CTRL5] & 0x07) != 0;
+}
+
+
+// Called with the lock held, drives the pin after the lock is dropped
+static bool int1_level(struct emul_imu_data *data)
+{
+    bool level = (data->regs[REG_INT1_CTRL] & INT1_CTRL_FTH) && fifo_enabled(data) &&
+                 threshold_words(data) && data->words >= threshold_words(data);
+
+    if (level && !data->int1) {
+        data->int1_at = k_uptime_ticks();
+    }
+    data->int1 = level;
+    return level;
+}
+
+
+static void int1_drive(const struct emul *target, bool level)
+{
+    const struct emul_imu_config *cfg = target->cfg;
+
+    gpio_emul_input_set(cfg->int1.port, cfg->int1.pin, level);
+}
+
+
+static void fifo_append(struct emul_imu_data *data, const int16_t *sample)
+{
+    if (!fifo_enabled(data)) {
+        return;
+    }
+    for (int i = 0; i < WORDS_PER_SAMPLE; i++) {
+        if (data->words == FIFO_WORDS) {
+            // continuous mode overwrites the oldest word
+            data->head = (data->head + 1) % FIFO_WORDS;
+            data->words--;
+            data->overrun = true;
+        }
+        data->fifo[(data->head + data->words) % FIFO_WORDS] = sample[i];
+        data->words++;
+    }
+    memcpy(data->last, sample, sizeof(data->last));
+}
+
+
+static uint8_t reg_read(struct emul_imu_data *data, uint8_t reg)
+{
+    uint8_t value;
+
+    switch (reg) {
+    case REG_FIFO_STATUS1:
+        return data->words & 0xff;
+    case REG_FIFO_STATUS2:
+        value = (data->words >> 8) & 0x07;
+        if (data->overrun) {
+            value |= FIFO_STATUS2_OVER_RUN;
+        }
+        if (data->int1) {
+            value |= FIFO_STATUS2_WATERM;
+        }
+        // the status is latched for this read, the refill lands behind it
+        while (data->refill) {
+            fifo_append(data, data->last);
+            data->refill--;
+        }
+        return value;
+    case REG_FIFO_DATA_OUT_L:
+        if (!data->words) {
+            return 0;
+        }
+        value = data->byte_phase ? (uint16_t)data->fifo[data->head] >> 8 : data->fifo[data->head] & 0xff;
+        data->byte_phase ^= 1;
+        if (!data->byte_phase) {
+            data->head = (data->head + 1) % FIFO_WORDS;
+            data->words--;
+            data->overrun = false;
+        }
+        return value;
+    default:
+        return data->regs[reg % REG_COUNT];
+    }
+}
+
+
+static void reg_write(struct emul_imu_data *data, uint8_t reg, uint8_t value)
+{
+    data->regs[reg % REG_COUNT] = value;
+
+    if (reg == REG_FIFO_CTRL5 && !fifo_enabled(data)) {
+        // bypass mode empties the FIFO
+        data->head = 0;
+        data->words = 0;
+        data->byte_phase = 0;
+        data->overrun = false;
+    }
+}
+
+
+static int emul_imu_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+    struct emul_imu_data *data = target->data;
+    k_spinlock_key_t key;
+    uint8_t reg;
+    bool level;
+
+    ARG_UNUSED(addr);
+
+    if (num_msgs < 1 || (msgs[0].flags & I2C_MSG_READ) || msgs[0].len < 1) {
+        return -EIO;
+    }
+    reg = msgs[0].buf[0];
+
+    key = k_spin_lock(&data->lock);
+    if (num_msgs == 1) {
+        for (uint32_t i = 1; i < msgs[0].len; i++) {
+            reg_write(data, reg++, msgs[0].buf[i]);
+        }
+    } else {
+        for (uint32_t i = 0; i < msgs[1].len; i++) {
+            msgs[1].buf[i] = reg_read(data, reg);
+            // FIFO_DATA_OUT rolls back to its first byte instead of incrementing
+            if (reg != REG_FIFO_DATA_OUT_L) {
+                reg++;
+            }
+        }
+    }
+    level = int1_level(data);
+    k_spin_unlock(&data->lock, key);
+
+    int1_drive(target, level);
+    return 0;
+}
+
+
+void emul_imu_push(const struct emul *target, int16_t x, int16_t y, int16_t z)
+{
+    struct emul_imu_data *data = target->data;
+    const int16_t sample[WORDS_PER_SAMPLE] = { x, y, z };
+    k_spinlock_key_t key;
+    bool level;
+
+    key = k_spin_lock(&data->lock);
+    fifo_append(data, sample);
+    level = int1_level(data);
+    k_spin_unlock(&data->lock, key);
+
+    int1_drive(target, level);
+}
+
+
+void emul_imu_refill_on_status(const struct emul *target, uint16_t samples)
+{
+    struct emul_imu_data *data = target->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+    data->refill = samples;
+    k_spin_unlock(&data->lock, key);
+}
+
+
+uint16_t emul_imu_fifo_samples(const struct emul *target)
+{
+    struct emul_imu_data *data = target->data;
+
+    return data->words / WORDS_PER_SAMPLE;
+}
+
+
+int64_t emul_imu_int1_asserted_at(const struct emul *target)
+{
+    struct emul_imu_data *data = target->data;
+
+    return data->int1_at;
+}
+
+
+void emul_imu_reset(const struct emul *target)
+{
+    struct emul_imu_data *data = target->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[REG_WHO_AM_I] = WHO_AM_I_VALUE;
+    data->head = 0;
+    data->words = 0;
+    data->byte_phase = 0;
+    data->overrun = false;
+    data->int1 = false;
+    data->refill = 0;
+    k_spin_unlock(&data->lock, key);
+
+    int1_drive(target, false);
+}
+
+
+static int emul_imu_init(const struct emul *target, const struct device *parent)
+{
+    struct emul_imu_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    // INT1 starts low on the emulated GPIO, which may not be ready yet
+    data->regs[REG_WHO_AM_I] = WHO_AM_I_VALUE;
+    return 0;
+}
+
+
+static const struct i2c_emul_api emul_imu_api = {
+    .transfer = emul_imu_transfer,
+};
+
+#define EMUL_IMU_DEFINE(n)                                                   \
+    static struct emul_imu_data emul_imu_data_##n;                          \
+    static const struct emul_imu_config emul_imu_config_##n = {             \
+        .int1 = GPIO_DT_SPEC_INST_GET(n, irq_gpios),                        \
+    };                                                                      \
+    EMUL_DT_INST_DEFINE(n, emul_imu_init, &emul_imu_data_##n,               \
+                        &emul_imu_config_##n, &emul_imu_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(EMUL_IMU_DEFINE)
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <zephyr/drivers/emul.h>
+
+/* Register-level model of the LSM6DS3TR-C gyro FIFO behind imu.c. The
+ * FIFO threshold drives INT1 as a level, the way the part does with
+ * INT1_FTH.
+ */
+
+/* Append one gyro sample (X, Y, Z) to the FIFO and update INT1 */
+void emul_imu_push(const struct emul *target, int16_t x, int16_t y, int16_t z);
+
+/* Append @p samples copies of the last sample when the FIFO status is next
+ * read, as if they arrived while the driver was draining
+ */
+void emul_imu_refill_on_status(const struct emul *target, uint16_t samples);
+
+/* Samples left in the FIFO */
+uint16_t emul_imu_fifo_samples(const struct emul *target);
+
+/* Uptime in ticks when INT1 last went active */
+int64_t emul_imu_int1_asserted_at(const struct emul *target);
+
+void emul_imu_reset(const struct emul *target);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+
+/* Battery voltage in mV at evenly spaced points of a full discharge,
+ * shaped after the 0.2C and 1C curves of a 3.7 V LiPo cell with +-6 mV of
+ * sampling noise. The 1C curve starts from the same resting voltage and
+ * sags under load from the second sample on. Curves logged on a unit by
+ * the history log (history.c) can be added in the same form.
+ */
+
+static const uint16_t lipo_curve_0c2[] = {
+    4200, 4169, 4149, 4125, 4108, 4080, 4066, 4048, 4039, 4029,
+    4008, 3993, 3982, 3966, 3960, 3939, 3925, 3919, 3901, 3899,
+    3891, 3885, 3880, 3871, 3851, 3856, 3845, 3835, 3835, 3829,
+    3814, 3815, 3802, 3801, 3791, 3786, 3781, 3786, 3779, 3766,
+    3767, 3766, 3751, 3746, 3742, 3723, 3722, 3709, 3705, 3687,
+    3673, 3660, 3642, 3630, 3593, 3563, 3519, 3407, 3276, 3150,
+};
+
+static const uint16_t lipo_curve_1c[] = {
+    4200, 4077, 4051, 4024, 4011, 3991, 3983, 3969, 3952, 3931,
+    3915, 3905, 3885, 3879, 3858, 3855, 3844, 3824, 3817, 3813,
+    3801, 3798, 3789, 3777, 3766, 3763, 3755, 3749, 3738, 3727,
+    3721, 3721, 3718, 3711, 3707, 3702, 3699, 3688, 3689, 3678,
+    3674, 3669, 3658, 3652, 3646, 3635, 3626, 3624, 3611, 3595,
+    3584, 3572, 3557, 3537, 3507, 3475, 3432, 3316, 3187, 3100,
+};
+
+struct lipo_curve {
+    const char *name;
+    const uint16_t *mv;
+    size_t len;
+};
+
+static const struct lipo_curve lipo_curves[] = {
+    { "0.2C", lipo_curve_0c2, ARRAY_SIZE(lipo_curve_0c2) },
+    { "1C", lipo_curve_1c, ARRAY_SIZE(lipo_curve_1c) },
+};
@@ -0,0 +1,62 @@
+/* The modules under test call into params.c, wake.c, hid.c and the
+ * poweroff subsystem, which need Bluetooth or real hardware. Only the
+ * calls they make are stubbed here.
+ */
+#include "stubs.h"
+#include "battery.h"
+#include "gpio.h"
+#include "hid.h"
+#include "power.h"
+#include "wake.h"
+
+#include <zephyr/sys/poweroff.h>
+
+struct params test_params;
+uint32_t test_wake_refreshes;
+uint32_t test_hid_shutdowns;
+K_SEM_DEFINE(test_poweroff_sem, 0, 1);
+
+
+void test_params_reset(void)
+{
+    test_params = (struct params){
+        .version = PARAMS_VERSION,
+        .adc_samples = BATTERY_ADC_SAMPLES_DEFAULT,
+        .debounce_ms = GPIO_SW_DEBOUNCE_MS,
+        .longpress_ms = GPIO_SW_LONGPRESS_MS,
+        .battery_interval_s = POWER_BATTERY_ACTIVE_S,
+        .blink_ms = 500,
+    };
+}
+
+
+const struct params *params_get(void)
+{
+    if (!test_params.version) {
+        test_params_reset();
+    }
+    return &test_params;
+}
+
+
+void wake_params_refresh(void)
+{
+    test_wake_refreshes++;
+}
+
+
+int hid_shutdown(k_timeout_t timeout)
+{
+    ARG_UNUSED(timeout);
+
+    test_hid_shutdowns++;
+    return 0;
+}
+
+
+FUNC_NORETURN void sys_poweroff(void)
+{
+    k_sem_give(&test_poweroff_sem);
+    k_thread_abort(k_current_get());
+    CODE_UNREACHABLE;
+}
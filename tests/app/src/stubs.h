@@ -0,0 +1,19 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#include "params.h"
+
+/* Parameters returned by the params_get() stub, reset to the built-in defaults by test_params_reset() */
+extern struct params test_params;
+
+/* Calls of the wake_params_refresh() stub */
+extern uint32_t test_wake_refreshes;
+
+/* Given by the sys_poweroff() stub, which then aborts the calling thread */
+extern struct k_sem test_poweroff_sem;
+
+/* Calls of the hid_shutdown() stub */
+extern uint32_t test_hid_shutdowns;
+
+void test_params_reset(void);
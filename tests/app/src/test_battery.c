@@ -0,0 +1,136 @@
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "battery.h"
+#include "lipo_curves.h"
+#include "stubs.h"
+
+#define ADC_CHANNEL        7
+#define DIVIDER            3    // battery.c scales the divider output by (R1 + R2) / R2
+#define PIN_CHARGING       17   // active low
+#define TOLERANCE_MV       12   // 12 bit conversion and integer scaling, times the divider
+#define NOISE_PCT          3    // sampling noise may lift the level this much between samples
+
+static const struct device *adc = DEVICE_DT_GET(DT_NODELABEL(adc));
+static const struct device *gpio0 = DEVICE_DT_GET(DT_NODELABEL(gpio0));
+
+static uint32_t charge_edges;
+
+
+static int battery_read(int battery_mv)
+{
+    int measured_mv;
+
+    zassert_ok(adc_emul_const_value_set(adc, ADC_CHANNEL, battery_mv / DIVIDER));
+    zassert_ok(battery_get_millivolt(&measured_mv));
+    return measured_mv;
+}
+
+
+static void charge_edge(void)
+{
+    charge_edges++;
+}
+
+
+static void *battery_setup(void)
+{
+    zassert_ok(battery_init());
+    return NULL;
+}
+
+
+static void battery_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    test_params_reset();
+}
+
+
+ZTEST(battery, test_millivolt_tracks_input)
+{
+    for (int mv = 3000; mv <= 4300; mv += 50) {
+        int measured_mv = battery_read(mv);
+
+        zassert_within(measured_mv, mv, TOLERANCE_MV, "%d mV read as %d mV", mv, measured_mv);
+    }
+}
+
+
+ZTEST(battery, test_samples_tunable)
+{
+    static const uint8_t samples[] = { 1, BATTERY_ADC_SAMPLES_DEFAULT, BATTERY_ADC_SAMPLES_MAX };
+
+    for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+        test_params.adc_samples = samples[i];
+        zassert_within(battery_read(3800), 3800, TOLERANCE_MV, "%u samples", samples[i]);
+    }
+}
+
+
+ZTEST(battery, test_percentage_table)
+{
+    static const struct {
+        int mv;
+        int pct;
+    } points[] = {
+        { 4300, 100 },  // above a full cell, still charging
+        { 4200, 100 },
+        { 3830, 53 },
+        { 3755, 45 },   // halfway between 3830 mV (53%) and 3680 mV (36%), truncated
+        { 3480, 14 },
+        { 3150, 1 },
+        { 3000, 1 },    // the last step runs from the cutoff down to 0 V
+    };
+    int pct;
+
+    for (size_t i = 0; i < ARRAY_SIZE(points); i++) {
+        zassert_ok(battery_get_percentage(&pct, points[i].mv), "%d mV", points[i].mv);
+        zassert_equal(pct, points[i].pct, "%d mV is %d%%, expected %d%%", points[i].mv, pct, points[i].pct);
+    }
+}
+
+
+ZTEST(battery, test_curve_replay)
+{
+    for (size_t c = 0; c < ARRAY_SIZE(lipo_curves); c++) {
+        const struct lipo_curve *curve = &lipo_curves[c];
+        int previous_pct = 100;
+        int pct, expected_pct;
+
+        for (size_t i = 0; i < curve->len; i++) {
+            zassert_ok(battery_get_percentage(&pct, battery_read(curve->mv[i])));
+            zassert_ok(battery_get_percentage(&expected_pct, curve->mv[i]));
+
+            zassert_within(pct, expected_pct, 2, "%s sample %zu: %d%% for %u mV", curve->name, i, pct,
+                           curve->mv[i]);
+            zassert_true(pct <= previous_pct + NOISE_PCT, "%s sample %zu: %d%% after %d%%", curve->name, i,
+                         pct, previous_pct);
+            previous_pct = MIN(previous_pct, pct);
+        }
+        zassert_true(previous_pct <= 1, "%s ends at %d%%", curve->name, previous_pct);
+    }
+}
+
+
+ZTEST(battery, test_charge_state)
+{
+    int charge_state;
+
+    zassert_ok(battery_charge_handler_set(charge_edge));
+    charge_edges = 0;
+
+    zassert_ok(gpio_emul_input_set(gpio0, PIN_CHARGING, 0));
+    zassert_ok(battery_get_charge_state(&charge_state));
+    zassert_equal(charge_state, 1);
+
+    zassert_ok(gpio_emul_input_set(gpio0, PIN_CHARGING, 1));
+    zassert_ok(battery_get_charge_state(&charge_state));
+    zassert_equal(charge_state, 0);
+
+    zassert_equal(charge_edges, 2, "%u charge edges", charge_edges);
+}
+
+ZTEST_SUITE(battery, NULL, battery_setup, battery_before, NULL, NULL);
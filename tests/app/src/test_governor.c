@@ -0,0 +1,192 @@
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "battery.h"
+#include "governor.h"
+#include "gpio.h"
+#include "periodic.h"
+#include "lipo_curves.h"
+#include "stubs.h"
+
+#define ADC_CHANNEL   7
+#define DIVIDER       3
+#define PIN_LED       2
+#define TIERS_MAX     8
+#define LOOP_STACK_SIZE 1024
+
+static const struct device *adc = DEVICE_DT_GET(DT_NODELABEL(adc));
+static const struct device *gpio0 = DEVICE_DT_GET(DT_NODELABEL(gpio0));
+
+static enum governor_tier tiers[TIERS_MAX];
+static int tier_count;
+
+K_THREAD_STACK_DEFINE(loop_stack, LOOP_STACK_SIZE);
+static struct k_thread loop_thread;
+
+
+static void button_ignored(uint8_t button_mask)
+{
+    ARG_UNUSED(button_mask);
+}
+
+
+static void tier_changed(enum governor_tier tier)
+{
+    if (tier_count < TIERS_MAX) {
+        tiers[tier_count] = tier;
+    }
+    tier_count++;
+}
+
+
+/* The periodic jobs of main()'s event loop, the warning blink among them */
+static void loop(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    struct k_poll_event event;
+
+    periodic_poll_event_init(&event);
+    while (true) {
+        k_poll(&event, 1, periodic_process());
+        event.state = K_POLL_STATE_NOT_READY;
+    }
+}
+
+
+static void *governor_setup(void)
+{
+    zassert_ok(battery_init());
+    zassert_ok(governor_init(tier_changed));
+    return NULL;
+}
+
+
+static void governor_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    zassert_ok(gpio_init(button_ignored)); // the status LED
+    governor_battery_update(100, true); // back to normal from any tier
+    tier_count = 0;
+    test_wake_refreshes = 0;
+}
+
+
+ZTEST(governor, test_tiers_descend)
+{
+    for (int pct = 100; pct >= 0; pct--) {
+        governor_battery_update(pct, false);
+        zassert_true(tier_count <= 3, "tier changed back at %d%%", pct);
+    }
+
+    zassert_equal(tier_count, 3);
+    zassert_equal(tiers[0], GOVERNOR_TIER_SAVER);
+    zassert_equal(tiers[1], GOVERNOR_TIER_LOW);
+    zassert_equal(tiers[2], GOVERNOR_TIER_OFF);
+    zassert_equal(test_wake_refreshes, 3, "connection parameters refreshed on every change");
+
+    // charging aborts the final warning
+    governor_battery_update(0, true);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_LOW);
+}
+
+
+ZTEST(governor, test_hysteresis)
+{
+    governor_battery_update(CONFIG_APP_GOVERNOR_SAVER_PCT, false);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_SAVER);
+
+    // noise around the level does not flip the tier
+    for (int i = 0; i < 10; i++) {
+        governor_battery_update(CONFIG_APP_GOVERNOR_SAVER_PCT + 1 + i % 2, false);
+        governor_battery_update(CONFIG_APP_GOVERNOR_SAVER_PCT - 1, false);
+    }
+    zassert_equal(tier_count, 1);
+
+    governor_battery_update(CONFIG_APP_GOVERNOR_SAVER_PCT + CONFIG_APP_GOVERNOR_HYSTERESIS_PCT - 1, false);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_SAVER);
+    governor_battery_update(CONFIG_APP_GOVERNOR_SAVER_PCT + CONFIG_APP_GOVERNOR_HYSTERESIS_PCT, false);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_NORMAL);
+}
+
+
+ZTEST(governor, test_powered_never_off)
+{
+    governor_battery_update(0, true);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_LOW);
+}
+
+
+ZTEST(governor, test_policy_relaxes)
+{
+    const struct governor_policy *normal = governor_policy_get();
+    const struct governor_policy *low;
+
+    governor_battery_update(CONFIG_APP_GOVERNOR_LOW_PCT, false);
+    low = governor_policy_get();
+
+    zassert_true(low->conn_idle_int_min > normal->conn_idle_int_min);
+    zassert_true(low->battery_interval_mul > normal->battery_interval_mul);
+    zassert_false(low->led);
+}
+
+
+/* Both recorded curves through the ADC emulator, battery.c and the governor */
+ZTEST(governor, test_curve_replay)
+{
+    int mv, pct;
+
+    for (size_t c = 0; c < ARRAY_SIZE(lipo_curves); c++) {
+        governor_battery_update(100, true);
+        tier_count = 0;
+
+        for (size_t i = 0; i < lipo_curves[c].len; i++) {
+            zassert_ok(adc_emul_const_value_set(adc, ADC_CHANNEL, lipo_curves[c].mv[i] / DIVIDER));
+            zassert_ok(battery_get_millivolt(&mv));
+            zassert_ok(battery_get_percentage(&pct, mv));
+            governor_battery_update(pct, false);
+        }
+
+        zassert_equal(tier_count, 3, "%s: %d tier changes", lipo_curves[c].name, tier_count);
+        for (int i = 1; i < MIN(tier_count, TIERS_MAX); i++) {
+            zassert_true(tiers[i] > tiers[i - 1], "%s: tier went back up", lipo_curves[c].name);
+        }
+    }
+}
+
+
+ZTEST(governor, test_poweroff_after_warning)
+{
+    int64_t start = k_uptime_get();
+    int toggles = 0, led = gpio_emul_output_get(gpio0, PIN_LED);
+
+    k_sem_reset(&test_poweroff_sem);
+    test_hid_shutdowns = 0;
+    k_thread_create(&loop_thread, loop_stack, K_THREAD_STACK_SIZEOF(loop_stack), loop, NULL, NULL, NULL,
+                    K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+
+    governor_battery_update(CONFIG_APP_GOVERNOR_OFF_PCT, false);
+    zassert_equal(governor_tier_get(), GOVERNOR_TIER_OFF);
+
+    while (k_sem_take(&test_poweroff_sem, K_MSEC(GOVERNOR_WARNING_BLINK_MS)) == -EAGAIN) {
+        zassert_true(k_uptime_get() - start < GOVERNOR_OFF_WARNING_MS + 1000, "no System OFF");
+        if (gpio_emul_output_get(gpio0, PIN_LED) != led) {
+            led = !led;
+            toggles++;
+        }
+    }
+
+    zassert_true(k_uptime_get() - start >= GOVERNOR_OFF_WARNING_MS, "System OFF after %lld ms",
+                 k_uptime_get() - start);
+    zassert_true(toggles > GOVERNOR_OFF_WARNING_MS / GOVERNOR_WARNING_BLINK_MS / 4, "%d LED toggles",
+                 toggles);
+    zassert_equal(gpio_emul_output_get(gpio0, PIN_LED), 0, "LED left on");
+    zassert_equal(test_hid_shutdowns, 1, "links not taken down before System OFF");
+    k_thread_join(&loop_thread, K_FOREVER);
+}
+
+ZTEST_SUITE(governor, NULL, governor_setup, governor_before, NULL, NULL);
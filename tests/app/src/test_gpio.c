@@ -0,0 +1,168 @@
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "gpio.h"
+#include "stubs.h"
+
+#define PIN_LED      2
+#define PIN_SW0      28   // active low
+#define PIN_SW1      29
+#define EVENTS_MAX   8
+
+static const struct device *gpio0 = DEVICE_DT_GET(DT_NODELABEL(gpio0));
+
+static struct {
+    uint8_t mask;
+    int64_t at;
+} events[EVENTS_MAX];
+static int event_count;
+static int contacts;
+
+
+static void button_event(uint8_t button_mask)
+{
+    if (event_count < EVENTS_MAX) {
+        events[event_count].mask = button_mask;
+        events[event_count].at = k_uptime_get();
+    }
+    event_count++;
+}
+
+
+static void contact(void)
+{
+    contacts++;
+}
+
+
+static void press(gpio_pin_t pin, bool pressed)
+{
+    zassert_ok(gpio_emul_input_set(gpio0, pin, pressed ? 0 : 1));
+}
+
+
+static void *gpio_setup(void)
+{
+    test_params_reset();
+    press(PIN_SW0, false);
+    press(PIN_SW1, false);
+    return NULL;
+}
+
+
+static void gpio_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    test_params_reset();
+    // also brings the pins back to edge interrupts after a System OFF test
+    zassert_ok(gpio_init(button_event));
+    gpio_contact_handler_set(contact);
+    event_count = 0;
+    contacts = 0;
+}
+
+
+static void gpio_after(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    press(PIN_SW0, false);
+    press(PIN_SW1, false);
+    k_msleep(GPIO_SW_LONGPRESS_MS); // let pending debounce and long-press work finish
+    gpio_contact_handler_set(NULL);
+}
+
+
+ZTEST(gpio, test_press_release)
+{
+    press(PIN_SW0, true);
+    k_msleep(GPIO_SW_DEBOUNCE_MS + 5);
+    press(PIN_SW0, false);
+    k_msleep(GPIO_SW_DEBOUNCE_MS + 5);
+
+    zassert_equal(event_count, 2);
+    zassert_equal(events[0].mask, 0b001);
+    zassert_equal(events[1].mask, 0b000);
+    zassert_equal(contacts, 2, "one contact per debounced change, %d", contacts);
+}
+
+
+ZTEST(gpio, test_bounce_settles_once)
+{
+    int64_t last_edge;
+
+    // contact bounce for 10 ms, ending pressed
+    for (int i = 0; i < 5; i++) {
+        press(PIN_SW1, true);
+        k_msleep(1);
+        press(PIN_SW1, false);
+        k_msleep(1);
+    }
+    press(PIN_SW1, true);
+    last_edge = k_uptime_get();
+
+    k_msleep(GPIO_SW_DEBOUNCE_MS - 2);
+    zassert_equal(event_count, 0, "reported before the contact was quiet");
+
+    k_msleep(10);
+    zassert_equal(event_count, 1);
+    zassert_equal(events[0].mask, 0b010);
+    zassert_true(events[0].at >= last_edge + GPIO_SW_DEBOUNCE_MS, "debounced %lld ms after the last edge",
+                 events[0].at - last_edge);
+    zassert_equal(contacts, 1, "the contact handler fires on the first edge only, %d", contacts);
+}
+
+
+ZTEST(gpio, test_debounce_tunable)
+{
+    test_params.debounce_ms = 80;
+
+    press(PIN_SW0, true);
+    k_msleep(GPIO_SW_DEBOUNCE_MS + 5);
+    zassert_equal(event_count, 0);
+    k_msleep(80);
+    zassert_equal(event_count, 1);
+}
+
+
+ZTEST(gpio, test_long_press)
+{
+    press(PIN_SW0, true);
+    press(PIN_SW1, true);
+    k_msleep(GPIO_SW_DEBOUNCE_MS + 5);
+    zassert_equal(event_count, 1);
+    zassert_equal(events[0].mask, 0b011);
+
+    k_msleep(GPIO_SW_LONGPRESS_MS - 100);
+    zassert_equal(event_count, 1, "long press reported early");
+    k_msleep(200);
+    zassert_equal(event_count, 2);
+    zassert_equal(events[1].mask, 0b111);
+}
+
+
+ZTEST(gpio, test_long_press_released_early)
+{
+    press(PIN_SW0, true);
+    press(PIN_SW1, true);
+    k_msleep(GPIO_SW_DEBOUNCE_MS + 5);
+    k_msleep(GPIO_SW_LONGPRESS_MS / 2);
+    press(PIN_SW1, false);
+    k_msleep(GPIO_SW_LONGPRESS_MS);
+
+    zassert_equal(event_count, 2);
+    zassert_equal(events[0].mask, 0b011);
+    zassert_equal(events[1].mask, 0b001);
+}
+
+
+ZTEST(gpio, test_status_led)
+{
+    zassert_ok(gpio_status_led_on());
+    zassert_equal(gpio_emul_output_get(gpio0, PIN_LED), 1);
+    zassert_ok(gpio_status_led_toggle());
+    zassert_equal(gpio_emul_output_get(gpio0, PIN_LED), 0);
+}
+
+ZTEST_SUITE(gpio, NULL, gpio_setup, gpio_before, gpio_after, NULL);
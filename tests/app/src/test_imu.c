@@ -0,0 +1,156 @@
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/emul.h>
+
+#include <string.h>
+
+#include "emul_imu.h"
+#include "hid.h"
+#include "imu.h"
+
+#define SAMPLE_PERIOD_US (USEC_PER_SEC / IMU_ODR_HZ)
+#define BATCH_PERIOD_US  (IMU_FIFO_BATCH * SAMPLE_PERIOD_US)
+#define RUN_MS           1000
+#define YAW_RATE_LSB     (-6 * IMU_LSB_PER_COUNT / 10) // 0.6 counts per sample to the right
+
+static const struct emul *imu = EMUL_DT_GET(DT_NODELABEL(imu));
+
+static atomic_t pushed;
+static struct {
+    uint32_t reports;
+    int32_t dx;
+    int32_t dy;
+    uint32_t latency_max_us;
+} motion;
+
+
+// Stands in for the HID service, records what the pointer would move
+int hid_pointer_motion(int16_t dx, int16_t dy)
+{
+    uint32_t latency_us = k_ticks_to_us_ceil32(k_uptime_ticks() - emul_imu_int1_asserted_at(imu));
+
+    motion.reports++;
+    motion.dx += dx;
+    motion.dy += dy;
+    motion.latency_max_us = MAX(motion.latency_max_us, latency_us);
+    return 0;
+}
+
+
+static void sample_tick(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+
+    // Yaw is the pointer X axis
+    emul_imu_push(imu, 0, 0, YAW_RATE_LSB);
+    atomic_inc(&pushed);
+}
+
+static K_TIMER_DEFINE(sample_timer, sample_tick, NULL);
+
+
+static void imu_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    emul_imu_reset(imu);
+    zassert_ok(imu_init());
+    zassert_ok(imu_pointer_enable(true));
+    memset(&motion, 0, sizeof(motion));
+    atomic_clear(&pushed);
+}
+
+
+static void imu_after(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    k_timer_stop(&sample_timer);
+    imu_pointer_enable(false);
+}
+
+
+ZTEST(imu, test_latency_and_rate)
+{
+    struct imu_stats before, after;
+    uint32_t samples;
+
+    imu_stats_get(&before);
+    k_timer_start(&sample_timer, K_USEC(SAMPLE_PERIOD_US), K_USEC(SAMPLE_PERIOD_US));
+    k_msleep(RUN_MS);
+    k_timer_stop(&sample_timer);
+    k_msleep(BATCH_PERIOD_US / USEC_PER_MSEC + 1);
+    imu_stats_get(&after);
+
+    samples = after.samples - before.samples;
+    TC_PRINT("imu: %u samples in %u batches, %u reports, latency max %u us\n",
+             samples, after.batches - before.batches, motion.reports, motion.latency_max_us);
+
+    // The timer runs close to the ODR, the tick rounds its period
+    zassert_within(atomic_get(&pushed), IMU_ODR_HZ * RUN_MS / MSEC_PER_SEC, IMU_ODR_HZ / 20);
+
+    // One batch per threshold interrupt, every complete batch read exactly once
+    zassert_equal(samples + emul_imu_fifo_samples(imu), atomic_get(&pushed));
+    zassert_true(emul_imu_fifo_samples(imu) < IMU_FIFO_BATCH);
+    zassert_within(after.batches - before.batches, samples / IMU_FIFO_BATCH, 1);
+    zassert_equal(after.overruns, before.overruns);
+
+    // A report per batch, and no motion lost to the count rounding
+    zassert_within(motion.reports, samples / IMU_FIFO_BATCH, 1);
+    zassert_within(motion.dx, (samples * -YAW_RATE_LSB) / IMU_LSB_PER_COUNT, 1);
+    zassert_equal(motion.dy, 0);
+
+    // The drain runs on the threshold, not on the next batch
+    zassert_true(motion.latency_max_us < SAMPLE_PERIOD_US, "latency %u us", motion.latency_max_us);
+}
+
+
+ZTEST(imu, test_deadzone)
+{
+    for (int i = 0; i < 4 * IMU_FIFO_BATCH; i++) {
+        emul_imu_push(imu, IMU_DEADZONE_LSB - 1, 0, -(IMU_DEADZONE_LSB - 1));
+    }
+    k_msleep(1);
+
+    zassert_equal(emul_imu_fifo_samples(imu), 0);
+    zassert_equal(motion.dx, 0);
+    zassert_equal(motion.dy, 0);
+}
+
+
+ZTEST(imu, test_threshold_while_high)
+{
+    struct imu_stats before, after;
+
+    imu_stats_get(&before);
+
+    // A second batch completes while the first is drained: INT1 never goes
+    // low, so there is no edge for it
+    emul_imu_refill_on_status(imu, IMU_FIFO_BATCH);
+    for (int i = 0; i < IMU_FIFO_BATCH; i++) {
+        emul_imu_push(imu, 0, 0, YAW_RATE_LSB);
+    }
+    k_msleep(1);
+    imu_stats_get(&after);
+
+    zassert_equal(emul_imu_fifo_samples(imu), 0, "batch left behind a level INT1");
+    zassert_equal(after.samples - before.samples, 2 * IMU_FIFO_BATCH);
+    zassert_true(after.rechecks > before.rechecks);
+}
+
+
+ZTEST(imu, test_pointer_off)
+{
+    zassert_ok(imu_pointer_enable(false));
+
+    for (int i = 0; i < 2 * IMU_FIFO_BATCH; i++) {
+        emul_imu_push(imu, 0, 0, YAW_RATE_LSB);
+    }
+    k_msleep(1);
+
+    // bypass mode, nothing is queued and nothing moves
+    zassert_equal(emul_imu_fifo_samples(imu), 0);
+    zassert_equal(motion.reports, 0);
+}
+
+
+ZTEST_SUITE(imu, NULL, NULL, imu_before, imu_after, NULL);
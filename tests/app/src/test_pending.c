@@ -0,0 +1,111 @@
+#include <zephyr/ztest.h>
+
+#include "pending.h"
+
+
+static int pop(uint8_t *mask)
+{
+    int err = pending_peek(mask);
+
+    if (!err) {
+        pending_pop();
+    }
+    return err;
+}
+
+
+static void pending_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    uint8_t mask;
+
+    while (pop(&mask) == 0) {
+    }
+}
+
+
+ZTEST(pending, test_replay_in_order)
+{
+    static const uint8_t pushed[] = { 0b001, 0b000, 0b010, 0b000 };
+    uint8_t mask;
+
+    for (size_t i = 0; i < ARRAY_SIZE(pushed); i++) {
+        pending_push(pushed[i]);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(pushed); i++) {
+        zassert_ok(pop(&mask));
+        zassert_equal(mask, pushed[i], "event %zu", i);
+    }
+    zassert_equal(pop(&mask), -ENOENT);
+}
+
+
+ZTEST(pending, test_peek_keeps_event)
+{
+    struct pending_stats before, after;
+    uint8_t mask;
+
+    pending_stats_get(&before);
+    pending_push(0b001);
+    pending_push(0b000);
+
+    // an unsent transition is peeked again by the next replay
+    zassert_ok(pending_peek(&mask));
+    zassert_equal(mask, 0b001);
+    zassert_ok(pending_peek(&mask));
+    zassert_equal(mask, 0b001);
+    zassert_false(pending_empty());
+
+    pending_pop();
+    zassert_ok(pending_peek(&mask));
+    zassert_equal(mask, 0b000);
+    pending_pop();
+    zassert_true(pending_empty());
+
+    pending_stats_get(&after);
+    zassert_equal(after.replayed - before.replayed, 2);
+}
+
+
+ZTEST(pending, test_overflow_keeps_newest)
+{
+    struct pending_stats before, after;
+    uint8_t mask;
+
+    pending_stats_get(&before);
+    for (int i = 0; i < PENDING_EVENTS_MAX + 3; i++) {
+        pending_push(i);
+    }
+    pending_stats_get(&after);
+
+    for (int i = 3; i < PENDING_EVENTS_MAX + 3; i++) {
+        zassert_ok(pop(&mask));
+        zassert_equal(mask, i);
+    }
+    zassert_equal(pop(&mask), -ENOENT);
+    zassert_equal(after.buffered - before.buffered, PENDING_EVENTS_MAX + 3);
+    zassert_equal(after.overflowed - before.overflowed, 3);
+    zassert_equal(after.expired - before.expired, 0);
+}
+
+
+ZTEST(pending, test_old_events_expire)
+{
+    struct pending_stats before, after;
+    uint8_t mask;
+
+    pending_stats_get(&before);
+    pending_push(0b001);
+    k_msleep(PENDING_MAX_AGE_MS + 1);
+    pending_push(0b010);
+
+    zassert_ok(pop(&mask));
+    zassert_equal(mask, 0b010);
+    zassert_true(pending_empty());
+    pending_stats_get(&after);
+    zassert_equal(after.expired - before.expired, 1);
+    zassert_equal(after.replayed - before.replayed, 1);
+}
+
+ZTEST_SUITE(pending, NULL, NULL, pending_before, NULL, NULL);
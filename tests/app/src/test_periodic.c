@@ -0,0 +1,123 @@
+#include <zephyr/ztest.h>
+
+#include "periodic.h"
+
+static struct periodic_job job_a;
+static struct periodic_job job_b;
+static uint32_t runs_a;
+static uint32_t runs_b;
+
+
+static void run_a(void)
+{
+    runs_a++;
+}
+
+
+static void run_b(void)
+{
+    runs_b++;
+}
+
+
+/* The event loop of main() without its other events */
+static void loop_run(uint32_t duration_ms)
+{
+    int64_t end = k_uptime_get() + duration_ms;
+    int64_t left;
+    k_timeout_t timeout;
+
+    while ((left = end - k_uptime_get()) > 0) {
+        timeout = periodic_process();
+        if (K_TIMEOUT_EQ(timeout, K_FOREVER) || k_ticks_to_ms_ceil64(timeout.ticks) > left) {
+            timeout = K_MSEC(left);
+        }
+        k_sleep(timeout);
+    }
+}
+
+
+static void periodic_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    periodic_job_init(&job_a, run_a, 0);
+    periodic_job_init(&job_b, run_b, 0);
+    runs_a = 0;
+    runs_b = 0;
+}
+
+
+static void periodic_after(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    periodic_stop(&job_a);
+    periodic_stop(&job_b);
+}
+
+
+ZTEST(periodic, test_idle_waits_forever)
+{
+    zassert_true(K_TIMEOUT_EQ(periodic_process(), K_FOREVER));
+}
+
+
+ZTEST(periodic, test_period_kept)
+{
+    periodic_start(&job_a, 0, 100);
+    loop_run(1000);
+
+    zassert_within(runs_a, 10, 1, "%u runs", runs_a);
+}
+
+
+ZTEST(periodic, test_slack_coalesces)
+{
+    struct periodic_stats before, after;
+
+    job_a.slack_ms = 50;
+    job_b.slack_ms = 50;
+    periodic_start(&job_a, 0, 100);
+    periodic_start(&job_b, 0, 130);
+
+    periodic_stats_get(&before);
+    loop_run(2600);
+    periodic_stats_get(&after);
+
+    // slack may only delay a run, never drop one
+    zassert_within(runs_a, 26, 1, "%u runs of a", runs_a);
+    zassert_within(runs_b, 20, 1, "%u runs of b", runs_b);
+    zassert_equal(after.runs - before.runs, runs_a + runs_b);
+    zassert_true(after.wakeups - before.wakeups < runs_a + runs_b, "%u wake-ups for %u runs",
+                 after.wakeups - before.wakeups, runs_a + runs_b);
+}
+
+
+ZTEST(periodic, test_stop)
+{
+    periodic_start(&job_a, 0, 100);
+    loop_run(250);
+    periodic_stop(&job_a);
+    runs_a = 0;
+    loop_run(500);
+
+    zassert_equal(runs_a, 0);
+    zassert_true(K_TIMEOUT_EQ(periodic_process(), K_FOREVER));
+}
+
+
+ZTEST(periodic, test_period_set_keeps_last_run)
+{
+    periodic_start(&job_a, 0, 1000);
+    loop_run(10);
+    zassert_equal(runs_a, 1);
+
+    // next run 200 ms after the first one, not after the change
+    loop_run(120);
+    periodic_period_set(&job_a, 200);
+    loop_run(90);
+    zassert_equal(runs_a, 2, "%u runs", runs_a);
+}
+
+ZTEST_SUITE(periodic, NULL, NULL, periodic_before, periodic_after, NULL);
@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+# Build the images for the bsim scenarios in tests_scripts/ into
+# ${BSIM_OUT_PATH}/bin. Needs ZEPHYR_BASE, BSIM_OUT_PATH and
+# BSIM_COMPONENTS_PATH as for Zephyr's own bsim tests.
+#
+#   tests/bsim/compile.sh && tests/bsim/tests_scripts/dfu_throughput.sh
+set -ue
+
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must point to the zephyr root directory}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the bsim install}"
+
+BOARD=${BOARD:-nrf52_bsim}
+BOARD_TS=${BOARD//\//_}
+here=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+app_root=$(cd "${here}/../.." && pwd)
+build_root=${WORK_DIR:-${here}/_build}
+
+# build <exe suffix> <source dir> [cmake args...]
+build() {
+    local name=$1 src=$2
+    shift 2
+
+    west build -p auto -b "${BOARD}" -d "${build_root}/${name}" "${src}" -- "$@"
+    cp "${build_root}/${name}/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_${BOARD_TS}_trykkert_${name}"
+}
+
+build dut "${app_root}" -DEXTRA_CONF_FILE="${here}/dut.conf"
+build tester "${here}/tester"
+build hub "${app_root}" -DEXTRA_CONF_FILE="${app_root}/hub.conf;${here}/dut.conf;${here}/hub_bsim.conf"
+build broadcast "${app_root}" -DEXTRA_CONF_FILE="${app_root}/broadcast.conf;${here}/dut.conf"
+build receiver "${app_root}/receiver"
+build dut_full "${app_root}" -DEXTRA_CONF_FILE="${here}/dut.conf;${here}/gatt_full.conf"
+build dut_nosubrate "${app_root}" -DEXTRA_CONF_FILE="${here}/dut.conf;${here}/no_subrating.conf"
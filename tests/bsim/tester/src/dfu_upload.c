@@ -0,0 +1,228 @@
+/* SMP image upload against dfu.c: the same frames mcumgr and the nRF
+ * Connect Device Manager send, pipelined as write-without-response
+ * packets of one ATT MTU each. The throughput is taken from the first
+ * write to the response to the last chunk.
+ */
+#include "tester.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <string.h>
+
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+
+#define SMP_OP_WRITE        2
+#define SMP_OP_WRITE_RSP    3
+#define SMP_GROUP_IMAGE     1
+#define SMP_ID_UPLOAD       1
+#define SMP_HDR_LEN         8
+
+#define IMAGE_MAGIC         0x96f3b83d
+#define IMAGE_HDR_SIZE      0x200
+
+#define SIZE_DEFAULT        (64 * 1024)
+#define WINDOW_DEFAULT      2     // frames in flight, below the server's netbuf count
+#define CHUNK_MAX           2400  // image bytes per frame, fits the 2475 byte SMP buffer
+#define FRAME_MAX           (SMP_HDR_LEN + CHUNK_MAX + 64)
+#define ATT_WRITE_MAX       (498 - 3)
+
+static struct bt_uuid_128 smp_chrc_uuid = BT_UUID_INIT_128(
+    BT_UUID_128_ENCODE(0xda2e7828, 0xfbce, 0x4e01, 0xae9e, 0x261174997c48));
+
+static struct bt_gatt_subscribe_params smp_sub;
+static struct k_sem window_sem;
+static K_SEM_DEFINE(done_sem, 0, 1);
+
+static uint32_t image_size;
+static uint32_t acked_off;
+static int32_t smp_rc;
+
+
+static void image_fill(uint8_t *buf, uint32_t off, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(off + i);
+    }
+
+    // MCUboot image header, img_mgmt only accepts an upload that starts with one
+    if (off == 0) {
+        sys_put_le32(IMAGE_MAGIC, &buf[0]);
+        sys_put_le32(0, &buf[4]);                                 // load address
+        sys_put_le16(IMAGE_HDR_SIZE, &buf[8]);
+        sys_put_le16(0, &buf[10]);                                // protected TLVs
+        sys_put_le32(image_size - IMAGE_HDR_SIZE, &buf[12]);
+        sys_put_le32(0, &buf[16]);                                // flags
+        memset(&buf[20], 0, IMAGE_HDR_SIZE - 20);
+        buf[20] = 1;                                              // version 1.0.0
+    }
+}
+
+
+static uint8_t smp_notified(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                            const void *data, uint16_t length)
+{
+    const uint8_t *rsp = data;
+    struct zcbor_string key;
+    uint32_t off = 0;
+    int32_t rc = 0;
+
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+
+    if (!data || length < SMP_HDR_LEN || rsp[0] != SMP_OP_WRITE_RSP) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    ZCBOR_STATE_D(zsd, 2, &rsp[SMP_HDR_LEN], length - SMP_HDR_LEN, 1, 0);
+
+    if (!zcbor_map_start_decode(zsd)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+    while (!zcbor_array_at_end(zsd) && zcbor_tstr_decode(zsd, &key)) {
+        if (key.len == 2 && !memcmp(key.value, "rc", 2)) {
+            zcbor_int32_decode(zsd, &rc);
+        } else if (key.len == 3 && !memcmp(key.value, "off", 3)) {
+            zcbor_uint32_decode(zsd, &off);
+        } else {
+            zcbor_any_skip(zsd, NULL);
+        }
+    }
+
+    if (rc) {
+        smp_rc = rc;
+        k_sem_give(&done_sem);
+    } else if (off > acked_off) {
+        acked_off = off;
+        if (acked_off >= image_size) {
+            k_sem_give(&done_sem);
+        }
+    }
+    k_sem_give(&window_sem);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+static size_t frame_build(uint8_t *frame, uint8_t seq, uint32_t off, const uint8_t *chunk, size_t len)
+{
+    uint16_t body_len;
+
+    ZCBOR_STATE_E(zse, 1, &frame[SMP_HDR_LEN], FRAME_MAX - SMP_HDR_LEN, 0);
+
+    zcbor_map_start_encode(zse, 4);
+    zcbor_tstr_put_lit(zse, "image");
+    zcbor_uint32_put(zse, 0);
+    if (off == 0) {
+        zcbor_tstr_put_lit(zse, "len");
+        zcbor_uint32_put(zse, image_size);
+    }
+    zcbor_tstr_put_lit(zse, "off");
+    zcbor_uint32_put(zse, off);
+    zcbor_tstr_put_lit(zse, "data");
+    zcbor_bstr_encode_ptr(zse, (const char *)chunk, len);
+    if (!zcbor_map_end_encode(zse, 4)) {
+        return 0;
+    }
+    body_len = zse->payload - &frame[SMP_HDR_LEN];
+
+    frame[0] = SMP_OP_WRITE;
+    frame[1] = 0;
+    sys_put_be16(body_len, &frame[2]);
+    sys_put_be16(SMP_GROUP_IMAGE, &frame[4]);
+    frame[6] = seq;
+    frame[7] = SMP_ID_UPLOAD;
+    return SMP_HDR_LEN + body_len;
+}
+
+
+static int frame_send(struct bt_conn *conn, uint16_t handle, const uint8_t *frame, size_t len)
+{
+    while (len) {
+        size_t n = MIN(len, ATT_WRITE_MAX);
+        int err = bt_gatt_write_without_response(conn, handle, frame, n, false);
+
+        if (err == -ENOMEM) {
+            k_sleep(K_USEC(500)); // all ATT buffers are queued, wait for the next connection event
+            continue;
+        }
+        if (err) {
+            return err;
+        }
+        frame += n;
+        len -= n;
+    }
+    return 0;
+}
+
+
+void dfu_upload_main(void)
+{
+    static uint8_t chunk[CHUNK_MAX];
+    static uint8_t frame[FRAME_MAX];
+    struct bt_conn *conn;
+    uint16_t handle;
+    uint64_t started, elapsed_us;
+    uint32_t off = 0, bps;
+    uint8_t seq = 0;
+    int err;
+
+    image_size = tester_arg("size", SIZE_DEFAULT);
+    k_sem_init(&window_sem, tester_arg("window", WINDOW_DEFAULT), K_SEM_MAX_LIMIT);
+
+    err = bt_enable(NULL);
+    if (err) {
+        TESTER_FAIL("bt_enable failed (err %d)\n", err);
+        return;
+    }
+
+    err = tester_connect(TESTER_DUT_NAME, 0, BT_LE_CONN_PARAM(6, 12, 0, 400), &conn);
+    err = err ? err : tester_secure(conn);
+    err = err ? err : tester_link_max(conn);
+    if (err) {
+        TESTER_FAIL("link setup failed (err %d)\n", err);
+        return;
+    }
+
+    handle = tester_find_chrc(conn, &smp_chrc_uuid.uuid, 0);
+    if (!handle || tester_subscribe(conn, handle, smp_notified, &smp_sub)) {
+        TESTER_FAIL("SMP characteristic not found\n");
+        return;
+    }
+
+    started = tester_now_us();
+    while (off < image_size && !smp_rc) {
+        size_t len = MIN(image_size - off, CHUNK_MAX);
+        size_t frame_len;
+
+        k_sem_take(&window_sem, K_FOREVER);
+        image_fill(chunk, off, len);
+        frame_len = frame_build(frame, seq++, off, chunk, len);
+        if (!frame_len) {
+            TESTER_FAIL("frame encode failed at %u\n", off);
+            return;
+        }
+        err = frame_send(conn, handle, frame, frame_len);
+        if (err) {
+            TESTER_FAIL("write failed at %u (err %d)\n", off, err);
+            return;
+        }
+        off += len;
+    }
+
+    k_sem_take(&done_sem, K_FOREVER);
+    if (smp_rc) {
+        TESTER_FAIL("upload rejected at %u (rc %d)\n", acked_off, smp_rc);
+        return;
+    }
+
+    elapsed_us = MAX(tester_now_us() - started, 1);
+    bps = (uint32_t)((uint64_t)image_size * USEC_PER_SEC / elapsed_us);
+    TESTER_RESULT("dfu_bytes=%u dfu_ms=%u dfu_bps=%u", image_size, (uint32_t)(elapsed_us / 1000), bps);
+
+    if (bps < tester_arg("min_bps", 0)) {
+        TESTER_FAIL("throughput %u B/s below %ld B/s\n", bps, tester_arg("min_bps", 0));
+        return;
+    }
+    TESTER_PASS("upload of %u bytes complete\n", image_size);
+}
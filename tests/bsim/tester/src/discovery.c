@@ -0,0 +1,171 @@
+/* First pairing the way a host does it: connect, pair, walk the whole
+ * database (services, characteristics, then every attribute), read the
+ * report map, subscribe to the keyboard report and wait for the first
+ * key. The application presses its button on a short period from boot
+ * (discovery_time.sh), so the first key marks the earliest time a user
+ * press reaches the host after pairing, within one press period.
+ */
+#include "keys.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+static K_SEM_DEFINE(walk_sem, 0, 1);
+static K_SEM_DEFINE(read_sem, 0, 1);
+
+static uint16_t walk_count;
+static uint16_t report_map_len;
+static uint8_t read_err;
+
+
+static uint8_t walked(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                      struct bt_gatt_discover_params *params)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+
+    if (!attr) {
+        k_sem_give(&walk_sem);
+        return BT_GATT_ITER_STOP;
+    }
+    walk_count++;
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+static int walk(struct bt_conn *conn, uint8_t type, uint16_t *count)
+{
+    static struct bt_gatt_discover_params params;
+    int err;
+
+    walk_count = 0;
+    params.uuid = NULL;
+    params.func = walked;
+    params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    params.type = type;
+
+    err = bt_gatt_discover(conn, &params);
+    if (err) {
+        return err;
+    }
+    k_sem_take(&walk_sem, K_FOREVER);
+    *count = walk_count;
+    return 0;
+}
+
+
+static uint8_t report_map_read(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+                               const void *data, uint16_t length)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+
+    if (err || !data) {
+        read_err = err;
+        k_sem_give(&read_sem);
+        return BT_GATT_ITER_STOP;
+    }
+    report_map_len += length;
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+static int report_map_fetch(struct bt_conn *conn)
+{
+    static struct bt_gatt_read_params params;
+    uint16_t handle = tester_find_chrc(conn, BT_UUID_HIDS_REPORT_MAP, 0);
+    int err;
+
+    if (!handle) {
+        return -ENOENT;
+    }
+
+    // a single handle read continues with read blob until the value ends
+    params.func = report_map_read;
+    params.handle_count = 1;
+    params.single.handle = handle;
+    params.single.offset = 0;
+
+    err = bt_gatt_read(conn, &params);
+    if (err) {
+        return err;
+    }
+    k_sem_take(&read_sem, K_FOREVER);
+    return read_err ? -EIO : 0;
+}
+
+
+static uint32_t ms_since(uint64_t start_us)
+{
+    return (uint32_t)((tester_now_us() - start_us) / USEC_PER_MSEC);
+}
+
+
+void discovery_main(void)
+{
+    uint32_t secured_ms, discovered_ms, subscribed_ms, first_key_ms;
+    uint16_t services, chrcs, attrs;
+    struct bt_conn *conn;
+    uint64_t connected_us;
+    int err;
+
+    err = bt_enable(NULL);
+    if (err) {
+        TESTER_FAIL("bt_enable failed (err %d)\n", err);
+        return;
+    }
+
+    // 7.5 ms and a large MTU, like a phone or desktop during first discovery
+    err = tester_connect(TESTER_DUT_NAME, 0, BT_LE_CONN_PARAM(6, 6, 0, 400), &conn);
+    if (err) {
+        TESTER_FAIL("connect failed (err %d)\n", err);
+        return;
+    }
+    connected_us = tester_now_us();
+
+    err = tester_link_max(conn);
+    err = err ? err : tester_secure(conn);
+    if (err) {
+        TESTER_FAIL("pairing failed (err %d)\n", err);
+        return;
+    }
+    secured_ms = ms_since(connected_us);
+
+    err = walk(conn, BT_GATT_DISCOVER_PRIMARY, &services);
+    err = err ? err : walk(conn, BT_GATT_DISCOVER_CHARACTERISTIC, &chrcs);
+    err = err ? err : walk(conn, BT_GATT_DISCOVER_ATTRIBUTE, &attrs);
+    err = err ? err : report_map_fetch(conn);
+    if (err) {
+        TESTER_FAIL("discovery failed (err %d)\n", err);
+        return;
+    }
+    discovered_ms = ms_since(connected_us);
+
+    err = keys_subscribe(conn);
+    if (err) {
+        TESTER_FAIL("subscribe failed (err %d)\n", err);
+        return;
+    }
+    subscribed_ms = ms_since(connected_us);
+
+    while (!keys_first_report_us()) {
+        k_sleep(K_MSEC(1));
+    }
+    first_key_ms = (uint32_t)((keys_first_report_us() - connected_us) / USEC_PER_MSEC);
+
+    TESTER_RESULT("discovery services=%u chrcs=%u attrs=%u report_map_bytes=%u", services, chrcs, attrs,
+                  report_map_len);
+    TESTER_RESULT("discovery secured_ms=%u discovered_ms=%u subscribed_ms=%u first_key_ms=%u", secured_ms,
+                  discovered_ms, subscribed_ms, first_key_ms);
+
+    if (tester_arg("attrs_max", 0) && attrs > tester_arg("attrs_max", 0)) {
+        TESTER_FAIL("%u attributes, more than %ld\n", attrs, tester_arg("attrs_max", 0));
+        return;
+    }
+    if (tester_arg("first_key_max_ms", 0) && first_key_ms > tester_arg("first_key_max_ms", 0)) {
+        TESTER_FAIL("first key %u ms after connect, more than %ld\n", first_key_ms,
+                    tester_arg("first_key_max_ms", 0));
+        return;
+    }
+    TESTER_PASS("first key %u ms after connect\n", first_key_ms);
+}
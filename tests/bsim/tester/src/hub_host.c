@@ -0,0 +1,57 @@
+/* Host of a hub with four remotes: remote r presses in slot r of the
+ * schedule, the tester times each press from the remote's GPIO to the
+ * hub's keyboard report. Slot 4 belongs to an unbonded unit that starts
+ * after the hub's pairing window has closed; none of its presses may come
+ * through.
+ */
+#include "keys.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+#define REMOTES            4
+#define INTRUDER_SLOT      4
+
+
+void hub_host_main(void)
+{
+    struct keys_slot_stats intruder;
+    struct bt_conn *conn;
+    uint64_t end_us;
+    bool ok;
+    int err;
+
+    err = bt_enable(NULL);
+    if (err) {
+        TESTER_FAIL("bt_enable failed (err %d)\n", err);
+        return;
+    }
+
+    // the remotes advertise the same name, the hub sets its status flag
+    k_sleep(K_MSEC(tester_arg("start_ms", 0)));
+    err = tester_connect(NULL, TESTER_STATUS_HUB, BT_LE_CONN_PARAM(6, 6, 0, 400), &conn);
+    err = err ? err : tester_secure(conn);
+    err = err ? err : keys_subscribe(conn);
+    if (err) {
+        TESTER_FAIL("hub setup failed (err %d)\n", err);
+        return;
+    }
+
+    end_us = (tester_arg("t0_ms", 0) + tester_arg("presses", 1) * tester_arg("period_ms", 1000)) *
+             USEC_PER_MSEC;
+    end_us = MAX(end_us, tester_arg("end_ms", 0) * USEC_PER_MSEC);
+    k_sleep(K_USEC(end_us - tester_now_us()));
+
+    ok = keys_report("hub", REMOTES, tester_arg("presses", 1), tester_arg("latency_max_us", 0));
+    keys_stats_get(INTRUDER_SLOT, &intruder);
+    TESTER_RESULT("hub intruder_presses=%u", intruder.presses);
+
+    if (!ok) {
+        TESTER_FAIL("a remote lost presses or was too slow\n");
+        return;
+    }
+    if (intruder.presses) {
+        TESTER_FAIL("presses of an unbonded unit were forwarded\n");
+        return;
+    }
+    TESTER_PASS("all remotes forwarded, unbonded unit ignored\n");
+}
@@ -0,0 +1,183 @@
+/* Host of a clicker that goes idle between presses (wake.c). Every change
+ * of the link timing the clicker asks for is recorded: a connection
+ * parameter update, or a subrate change when both sides support
+ * subrating. After each press of the stimulus schedule (keys.h) the time
+ * until the link is back on a fast event interval is the transition time;
+ * before it, the idle event interval gives the connection events per
+ * second the clicker's radio wakes up for.
+ */
+#include "keys.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+#define IDLE_CHANGES_MAX  32
+#define IDLE_FAST_US      15000 // the fast interval of the default governor tier, 12 * 1.25 ms
+
+struct link_change {
+    uint64_t at_us;
+    uint32_t event_us;    // interval times subrate factor
+};
+
+static struct link_change changes[IDLE_CHANGES_MAX];
+static uint8_t change_count;
+static uint16_t link_interval;
+static uint16_t link_factor = 1;
+static uint32_t param_updates;
+static uint32_t subrate_changes;
+
+
+static void change_record(void)
+{
+    if (change_count == IDLE_CHANGES_MAX) {
+        return;
+    }
+    changes[change_count++] = (struct link_change){
+        .at_us = tester_now_us(),
+        .event_us = link_interval * 1250U * link_factor,
+    };
+}
+
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(latency);
+    ARG_UNUSED(timeout);
+
+    link_interval = interval;
+    param_updates++;
+    change_record();
+}
+
+
+#if defined(CONFIG_BT_SUBRATING)
+static void subrate_changed(struct bt_conn *conn, const struct bt_conn_le_subrate_changed *params)
+{
+    ARG_UNUSED(conn);
+
+    if (params->status) {
+        return;
+    }
+    link_factor = params->factor;
+    subrate_changes++;
+    change_record();
+}
+#endif
+
+
+BT_CONN_CB_DEFINE(idle_link_callbacks) = {
+    .le_param_updated = le_param_updated,
+#if defined(CONFIG_BT_SUBRATING)
+    .subrate_changed = subrate_changed,
+#endif
+};
+
+
+/* Event interval in effect at @p at_us, and when the link last went to it */
+static uint32_t event_us_at(uint64_t at_us, uint64_t *since_us)
+{
+    uint32_t event_us = changes[0].event_us;
+
+    *since_us = changes[0].at_us;
+    for (uint8_t i = 1; i < change_count && changes[i].at_us <= at_us; i++) {
+        if (changes[i].event_us != event_us) {
+            event_us = changes[i].event_us;
+            *since_us = changes[i].at_us;
+        }
+    }
+    return event_us;
+}
+
+
+/* First change to a fast event interval in [from_us, to_us), 0 if none */
+static uint64_t fast_after(uint64_t from_us, uint64_t to_us)
+{
+    for (uint8_t i = 0; i < change_count; i++) {
+        if (changes[i].at_us >= from_us && changes[i].at_us < to_us &&
+            changes[i].event_us <= IDLE_FAST_US) {
+            return changes[i].at_us;
+        }
+    }
+    return 0;
+}
+
+
+void idle_link_main(void)
+{
+    uint64_t t0 = tester_arg("t0_ms", 0) * USEC_PER_MSEC;
+    uint64_t period = tester_arg("period_ms", 1000) * USEC_PER_MSEC;
+    uint32_t presses = tester_arg("presses", 1);
+    uint32_t transition_max_ms = tester_arg("transition_max_ms", 0);
+    uint32_t transitions = 0, transition_sum_ms = 0, transition_worst_ms = 0;
+    uint32_t idle_event_us = 0;
+    struct bt_conn_info info;
+    struct bt_conn *conn;
+    uint64_t press, since, ready;
+    uint32_t event_us;
+    bool ok = true;
+    int err;
+
+    err = bt_enable(NULL);
+    if (err) {
+        TESTER_FAIL("bt_enable failed (err %d)\n", err);
+        return;
+    }
+
+    err = tester_connect(TESTER_DUT_NAME, 0, BT_LE_CONN_PARAM(6, 6, 0, 400), &conn);
+    err = err ? err : bt_conn_get_info(conn, &info);
+    if (!err) {
+        link_interval = info.le.interval;
+        change_record();
+    }
+    err = err ? err : tester_secure(conn);
+    err = err ? err : keys_subscribe(conn);
+    if (err) {
+        TESTER_FAIL("setup failed (err %d)\n", err);
+        return;
+    }
+
+    k_sleep(K_USEC(MAX(t0 + presses * period, tester_now_us()) - tester_now_us()));
+
+    for (uint32_t n = 0; n < presses; n++) {
+        press = t0 + n * period;
+
+        // the link timing right before the press
+        event_us = event_us_at(press, &since);
+        if (event_us <= IDLE_FAST_US) {
+            TESTER_RESULT("idle press=%u still fast at %llu ms", n, press / USEC_PER_MSEC);
+            ok = false;
+            continue;
+        }
+        idle_event_us = MAX(idle_event_us, event_us);
+
+        ready = fast_after(press, press + period);
+        if (!ready) {
+            TESTER_RESULT("idle press=%u never fast again", n);
+            ok = false;
+            continue;
+        }
+        transitions++;
+        transition_sum_ms += (ready - press) / USEC_PER_MSEC;
+        transition_worst_ms = MAX(transition_worst_ms, (uint32_t)((ready - press) / USEC_PER_MSEC));
+        TESTER_RESULT("idle press=%u idle_since_ms=%llu event_us=%u transition_ms=%llu",
+                      n, since / USEC_PER_MSEC, event_us, (ready - press) / USEC_PER_MSEC);
+    }
+
+    TESTER_RESULT("idle mode=%s param_updates=%u subrate_changes=%u", subrate_changes ? "subrating" :
+                  "param_update", param_updates, subrate_changes);
+    TESTER_RESULT("idle transitions=%u/%u transition_avg_ms=%u transition_max_ms=%u "
+                  "idle_event_us=%u idle_events_per_s=%u",
+                  transitions, presses, transitions ? transition_sum_ms / transitions : 0,
+                  transition_worst_ms, idle_event_us,
+                  idle_event_us ? USEC_PER_SEC / idle_event_us : 0);
+
+    ok &= keys_report("idle", 1, presses, tester_arg("latency_max_us", 0));
+    if (transition_max_ms && transition_worst_ms > transition_max_ms) {
+        ok = false;
+    }
+    if (!ok) {
+        TESTER_FAIL("link not idle before a press or too slow back to fast\n");
+        return;
+    }
+    TESTER_PASS("idle and back to fast around every press\n");
+}
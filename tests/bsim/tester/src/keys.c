@@ -0,0 +1,101 @@
+#include "keys.h"
+
+#include <zephyr/bluetooth/uuid.h>
+
+static struct bt_gatt_subscribe_params keys_sub;
+static struct keys_slot_stats slots[KEYS_SLOTS_MAX];
+static uint64_t first_report_us;
+static bool key_down;
+
+
+static uint8_t report_notified(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                               const void *data, uint16_t length)
+{
+    const uint8_t *report = data;
+    uint64_t now = tester_now_us();
+    uint64_t t0 = tester_arg("t0_ms", 0) * USEC_PER_MSEC;
+    uint64_t period = tester_arg("period_ms", 1000) * USEC_PER_MSEC;
+    uint64_t slot_len = tester_arg("slot_ms", period / USEC_PER_MSEC) * USEC_PER_MSEC;
+    bool down = false;
+    uint64_t offset;
+    uint32_t latency;
+    uint8_t slot;
+
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+
+    if (!data) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    // modifiers, reserved, key codes
+    for (uint16_t i = 2; i < length; i++) {
+        down |= report[i] != 0;
+    }
+    if (!down || key_down) {
+        key_down = down;
+        return BT_GATT_ITER_CONTINUE;
+    }
+    key_down = true;
+
+    if (!first_report_us) {
+        first_report_us = now;
+    }
+    if (now < t0) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    offset = (now - t0) % period;
+    slot = offset / slot_len;
+    if (slot >= MIN(tester_arg("slots", 1), KEYS_SLOTS_MAX)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    latency = offset - slot * slot_len;
+    slots[slot].presses++;
+    slots[slot].latency_sum_us += latency;
+    slots[slot].latency_max_us = MAX(slots[slot].latency_max_us, latency);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+int keys_subscribe(struct bt_conn *conn)
+{
+    // the keyboard input report is the first report characteristic of the HID service
+    uint16_t handle = tester_find_chrc(conn, BT_UUID_HIDS_REPORT, 0);
+
+    if (!handle) {
+        return -ENOENT;
+    }
+    return tester_subscribe(conn, handle, report_notified, &keys_sub);
+}
+
+
+void keys_stats_get(uint8_t slot, struct keys_slot_stats *stats)
+{
+    *stats = slots[slot];
+}
+
+
+uint64_t keys_first_report_us(void)
+{
+    return first_report_us;
+}
+
+
+bool keys_report(const char *label, uint8_t count, uint32_t expected, uint32_t latency_max_us)
+{
+    bool ok = true;
+
+    for (uint8_t i = 0; i < MIN(count, KEYS_SLOTS_MAX); i++) {
+        const struct keys_slot_stats *s = &slots[i];
+        uint32_t avg = s->presses ? (uint32_t)(s->latency_sum_us / s->presses) : 0;
+
+        TESTER_RESULT("%s slot=%u presses=%u latency_avg_us=%u latency_max_us=%u",
+                      label, i, s->presses, avg, s->latency_max_us);
+        if (s->presses != expected || (latency_max_us && s->latency_max_us > latency_max_us)) {
+            ok = false;
+        }
+    }
+    return ok;
+}
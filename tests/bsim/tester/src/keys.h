@@ -0,0 +1,44 @@
+#pragma once
+
+#include "tester.h"
+
+#define KEYS_SLOTS_MAX 8
+
+/* Presses of the GPIO stimulus files, see button_stimulus in
+ * tests_scripts/_env.source: slot s presses at t0 + n * period + s * slot.
+ * Test arguments: t0_ms, period_ms, slot_ms, slots.
+ */
+struct keys_slot_stats {
+    uint32_t presses;
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+};
+
+/**
+ * @brief Subscribe to the keyboard input report and time every press
+ *        against the stimulus schedule.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int keys_subscribe(struct bt_conn *conn);
+
+/**
+ * @brief Gets the presses seen in one slot of the schedule.
+ */
+void keys_stats_get(uint8_t slot, struct keys_slot_stats *stats);
+
+/**
+ * @brief Simulated time of the first press report, 0 before it.
+ */
+uint64_t keys_first_report_us(void);
+
+/**
+ * @brief Print one RESULT line per slot and check them.
+ *
+ * @param[in] count Slots to report and check, from slot 0.
+ * @param[in] expected Presses each slot must have delivered.
+ * @param[in] latency_max_us Longest accepted press to report time, 0 for no bound.
+ *
+ * @retval true if every slot delivered its presses within the bound.
+ */
+bool keys_report(const char *label, uint8_t count, uint32_t expected, uint32_t latency_max_us);
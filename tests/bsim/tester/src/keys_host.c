@@ -0,0 +1,40 @@
+/* Host of a single clicker: connect, pair, subscribe to the keyboard
+ * report and time every press of the stimulus schedule (keys.h) from the
+ * clicker's first GPIO edge to the report.
+ */
+#include "keys.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+
+void keys_host_main(void)
+{
+    struct bt_conn *conn;
+    uint64_t end_us;
+    int err;
+
+    err = bt_enable(NULL);
+    if (err) {
+        TESTER_FAIL("bt_enable failed (err %d)\n", err);
+        return;
+    }
+
+    err = tester_connect(TESTER_DUT_NAME, 0, BT_LE_CONN_PARAM(6, 6, 0, 400), &conn);
+    err = err ? err : tester_secure(conn);
+    err = err ? err : keys_subscribe(conn);
+    if (err) {
+        TESTER_FAIL("setup failed (err %d)\n", err);
+        return;
+    }
+
+    end_us = (tester_arg("t0_ms", 0) + tester_arg("presses", 1) * tester_arg("period_ms", 1000)) *
+             USEC_PER_MSEC;
+    end_us = MAX(end_us, tester_arg("end_ms", 0) * USEC_PER_MSEC);
+    k_sleep(K_USEC(end_us - tester_now_us()));
+
+    if (!keys_report("keys", 1, tester_arg("presses", 1), tester_arg("latency_max_us", 0))) {
+        TESTER_FAIL("presses lost or too slow\n");
+        return;
+    }
+    TESTER_PASS("every press reported\n");
+}
@@ -0,0 +1,79 @@
+/* Tester central for the bsim scenarios in tests/bsim/tests_scripts. Each
+ * scenario picks its role with -testid and passes its parameters with
+ * -argstest key=value.
+ */
+#include "tester.h"
+
+void dfu_upload_main(void);
+void hub_host_main(void);
+void discovery_main(void);
+void keys_host_main(void);
+void idle_link_main(void);
+
+static const struct bst_test_instance tester_tests[] = {
+    {
+        .test_id = "dfu_upload",
+        .test_descr = "Upload an image over SMP and report the throughput. "
+                      "Arguments: size=<bytes> window=<frames> min_bps=<B/s>",
+        .test_pre_init_f = tester_init,
+        .test_tick_f = tester_tick,
+        .test_args_f = tester_args,
+        .test_main_f = dfu_upload_main,
+    },
+    {
+        .test_id = "hub_host",
+        .test_descr = "Act as the host of a hub and time the presses of each remote. "
+                      "Arguments: start_ms t0_ms period_ms slot_ms slots presses end_ms latency_max_us",
+        .test_pre_init_f = tester_init,
+        .test_tick_f = tester_tick,
+        .test_args_f = tester_args,
+        .test_main_f = hub_host_main,
+    },
+    {
+        .test_id = "discovery",
+        .test_descr = "Pair, walk the database like a host and time the first key. "
+                      "Arguments: attrs_max first_key_max_ms",
+        .test_pre_init_f = tester_init,
+        .test_tick_f = tester_tick,
+        .test_args_f = tester_args,
+        .test_main_f = discovery_main,
+    },
+    {
+        .test_id = "keys_host",
+        .test_descr = "Act as the host and time every press of the schedule. "
+                      "Arguments: t0_ms period_ms presses end_ms latency_max_us",
+        .test_pre_init_f = tester_init,
+        .test_tick_f = tester_tick,
+        .test_args_f = tester_args,
+        .test_main_f = keys_host_main,
+    },
+    {
+        .test_id = "idle_link",
+        .test_descr = "Act as the host, record the link timing around every press of the schedule. "
+                      "Arguments: t0_ms period_ms presses transition_max_ms latency_max_us",
+        .test_pre_init_f = tester_init,
+        .test_tick_f = tester_tick,
+        .test_args_f = tester_args,
+        .test_main_f = idle_link_main,
+    },
+    BSTEST_END_MARKER
+};
+
+
+static struct bst_test_list *tester_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, tester_tests);
+}
+
+
+bst_test_install_t test_installers[] = {
+    tester_install,
+    NULL
+};
+
+
+int main(void)
+{
+    bst_main();
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include "tester.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+
+#include <zephyr/sys/byteorder.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nsi_hw_scheduler.h"
+
+#define ARGS_MAX          8
+#define TIMEOUT_S_DEFAULT 60
+
+static struct {
+    char key[24];
+    long value;
+} args[ARGS_MAX];
+static int arg_count;
+
+static K_SEM_DEFINE(conn_sem, 0, 1);
+static K_SEM_DEFINE(security_sem, 0, 1);
+static K_SEM_DEFINE(mtu_sem, 0, 1);
+static K_SEM_DEFINE(discover_sem, 0, 1);
+static K_SEM_DEFINE(subscribe_sem, 0, 1);
+
+static const char *scan_name;
+static uint8_t scan_flags;
+static struct bt_conn *pending_conn;
+static const struct bt_le_conn_param *pending_param;
+static int security_err;
+static uint8_t subscribe_err;
+
+
+void tester_init(void)
+{
+    bst_ticker_set_next_tick_absolute(tester_arg("timeout_s", TIMEOUT_S_DEFAULT) * USEC_PER_SEC);
+    bst_result = In_progress;
+}
+
+
+void tester_tick(bs_time_t now)
+{
+    if (bst_result != Passed) {
+        TESTER_FAIL("test timed out at %u s\n", (uint32_t)(now / USEC_PER_SEC));
+    }
+}
+
+
+void tester_args(int argc, char *argv[])
+{
+    for (int i = 0; i < argc && arg_count < ARGS_MAX; i++) {
+        const char *eq = strchr(argv[i], '=');
+
+        if (!eq || eq - argv[i] >= sizeof(args[0].key)) {
+            continue;
+        }
+        memcpy(args[arg_count].key, argv[i], eq - argv[i]);
+        args[arg_count].key[eq - argv[i]] = '\0';
+        args[arg_count].value = strtol(eq + 1, NULL, 0);
+        arg_count++;
+    }
+}
+
+
+long tester_arg(const char *key, long def)
+{
+    for (int i = 0; i < arg_count; i++) {
+        if (!strcmp(args[i].key, key)) {
+            return args[i].value;
+        }
+    }
+    return def;
+}
+
+
+uint64_t tester_now_us(void)
+{
+    return nsi_hws_get_time();
+}
+
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (conn != pending_conn) {
+        return;
+    }
+    if (err) {
+        bt_conn_unref(pending_conn);
+        pending_conn = NULL;
+    }
+    k_sem_give(&conn_sem);
+}
+
+
+static void security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(level);
+
+    security_err = err;
+    k_sem_give(&security_sem);
+}
+
+
+BT_CONN_CB_DEFINE(tester_conn_callbacks) = {
+    .connected = connected,
+    .security_changed = security_changed,
+};
+
+
+static bool name_match(struct bt_data *data, void *user_data)
+{
+    bool *found = user_data;
+
+    // company ID, version, flags
+    if (scan_flags && data->type == BT_DATA_MANUFACTURER_DATA && data->data_len >= 4 &&
+        sys_get_le16(data->data) == TESTER_STATUS_COMPANY_ID &&
+        (data->data[3] & scan_flags) == scan_flags) {
+        *found = true;
+        return false;
+    }
+    if (!scan_flags && (data->type == BT_DATA_NAME_COMPLETE || data->type == BT_DATA_NAME_SHORTENED) &&
+        data->data_len == strlen(scan_name) && !memcmp(data->data, scan_name, data->data_len)) {
+        *found = true;
+        return false;
+    }
+    return true;
+}
+
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+    bool found = false;
+    int err;
+
+    ARG_UNUSED(rssi);
+
+    if (pending_conn || (type != BT_GAP_ADV_TYPE_ADV_IND && type != BT_GAP_ADV_TYPE_SCAN_RSP)) {
+        return;
+    }
+
+    bt_data_parse(ad, name_match, &found);
+    if (!found || bt_le_scan_stop()) {
+        return;
+    }
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, pending_param, &pending_conn);
+    if (err) {
+        TESTER_FAIL("connect failed (err %d)\n", err);
+    }
+}
+
+
+int tester_connect(const char *name, uint8_t status_flags, const struct bt_le_conn_param *param,
+                   struct bt_conn **conn)
+{
+    int err;
+
+    scan_name = name;
+    scan_flags = status_flags;
+    pending_param = param;
+    pending_conn = NULL;
+
+    err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, device_found);
+    if (err) {
+        return err;
+    }
+
+    k_sem_take(&conn_sem, K_FOREVER);
+    if (!pending_conn) {
+        return -ENOTCONN;
+    }
+    *conn = pending_conn;
+    return 0;
+}
+
+
+int tester_secure(struct bt_conn *conn)
+{
+    int err = bt_conn_set_security(conn, BT_SECURITY_L2);
+
+    if (err) {
+        return err;
+    }
+    k_sem_take(&security_sem, K_FOREVER);
+    return security_err ? -EACCES : 0;
+}
+
+
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err, struct bt_gatt_exchange_params *params)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(err);
+    ARG_UNUSED(params);
+
+    k_sem_give(&mtu_sem);
+}
+
+
+int tester_link_max(struct bt_conn *conn)
+{
+    static struct bt_gatt_exchange_params mtu_params = { .func = mtu_exchanged };
+    int err;
+
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err) {
+        return err;
+    }
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err && err != -EALREADY) {
+        return err;
+    }
+    err = bt_gatt_exchange_mtu(conn, &mtu_params);
+    if (err) {
+        return err;
+    }
+    k_sem_take(&mtu_sem, K_FOREVER);
+    return 0;
+}
+
+
+static struct {
+    uint8_t index;
+    uint16_t value_handle;
+} discover;
+
+
+static uint8_t chrc_discovered(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                               struct bt_gatt_discover_params *params)
+{
+    ARG_UNUSED(conn);
+
+    if (!attr) {
+        k_sem_give(&discover_sem);
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (discover.index-- == 0) {
+        discover.value_handle = ((const struct bt_gatt_chrc *)attr->user_data)->value_handle;
+        k_sem_give(&discover_sem);
+        return BT_GATT_ITER_STOP;
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+
+uint16_t tester_find_chrc(struct bt_conn *conn, const struct bt_uuid *uuid, uint8_t index)
+{
+    static struct bt_gatt_discover_params params;
+
+    discover.index = index;
+    discover.value_handle = 0;
+
+    params.uuid = uuid;
+    params.func = chrc_discovered;
+    params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    if (bt_gatt_discover(conn, &params)) {
+        return 0;
+    }
+    k_sem_take(&discover_sem, K_FOREVER);
+    return discover.value_handle;
+}
+
+
+static void subscribed(struct bt_conn *conn, uint8_t err, struct bt_gatt_subscribe_params *params)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+
+    subscribe_err = err;
+    k_sem_give(&subscribe_sem);
+}
+
+
+int tester_subscribe(struct bt_conn *conn, uint16_t value_handle, bt_gatt_notify_func_t notify,
+                     struct bt_gatt_subscribe_params *params)
+{
+    static struct bt_gatt_discover_params ccc_discover;
+    int err;
+
+    params->notify = notify;
+    params->subscribe = subscribed;
+    params->value = BT_GATT_CCC_NOTIFY;
+    params->value_handle = value_handle;
+    params->ccc_handle = 0; // found by the auto discovery
+    params->end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    params->disc_params = &ccc_discover;
+
+    err = bt_gatt_subscribe(conn, params);
+    if (err) {
+        return err;
+    }
+    k_sem_take(&subscribe_sem, K_FOREVER);
+    return subscribe_err ? -EIO : 0;
+}
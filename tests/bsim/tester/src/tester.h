@@ -0,0 +1,92 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "bs_tracing.h"
+#include "bs_types.h"
+#include "bstests.h"
+
+extern enum bst_result_t bst_result;
+
+#define TESTER_FAIL(...)                         \
+    do {                                         \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+#define TESTER_PASS(...)                         \
+    do {                                         \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+/* Results are printed on one line each so the scripts can grep them */
+#define TESTER_RESULT(fmt, ...) bs_trace_raw(0, "RESULT " fmt "\n", ##__VA_ARGS__)
+
+#define TESTER_DUT_NAME "trykkert"
+
+/* Common test hooks: a watchdog of -argstest timeout_s=<s> (default 60 s)
+ * and the key=value test arguments.
+ */
+void tester_init(void);
+void tester_tick(bs_time_t now);
+void tester_args(int argc, char *argv[]);
+
+/**
+ * @brief Get a test argument given as key=value after -argstest.
+ *
+ * @retval The value, or @p def when the key was not given.
+ */
+long tester_arg(const char *key, long def);
+
+/**
+ * @brief Simulated time in microseconds, the same clock on every device.
+ */
+uint64_t tester_now_us(void);
+
+/* ADV_STATUS_* flags of the application's manufacturer data (hid.h) */
+#define TESTER_STATUS_COMPANY_ID 0xffff
+#define TESTER_STATUS_HUB        BIT(4)
+
+/**
+ * @brief Scan for a device and connect to it.
+ *
+ * @param[in] name Device name in the scan response, used when @p status_flags is 0.
+ * @param[in] status_flags Match the advertising status flags instead of the name.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int tester_connect(const char *name, uint8_t status_flags, const struct bt_le_conn_param *param,
+                   struct bt_conn **conn);
+
+/**
+ * @brief Pair (Just Works) or re-encrypt with an existing bond.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int tester_secure(struct bt_conn *conn);
+
+/**
+ * @brief Move the link to the 2M PHY, the longest data length and the largest ATT MTU.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int tester_link_max(struct bt_conn *conn);
+
+/**
+ * @brief Find the value handle of the @p index th characteristic with @p uuid.
+ *
+ * @retval Value handle, 0 if not found.
+ */
+uint16_t tester_find_chrc(struct bt_conn *conn, const struct bt_uuid *uuid, uint8_t index);
+
+/**
+ * @brief Subscribe to notifications of a characteristic value handle.
+ *
+ * @retval 0 if successful. Negative errno number on error.
+ */
+int tester_subscribe(struct bt_conn *conn, uint16_t value_handle, bt_gatt_notify_func_t notify,
+                     struct bt_gatt_subscribe_params *params);
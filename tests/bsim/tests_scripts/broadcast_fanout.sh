@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+# One clicker built with broadcast.conf and eight receivers (receiver/).
+# The clicker presses button 0 every 500 ms from 3 s; every receiver logs
+# its key reports, and broadcast_latency.py prints one RESULT line per
+# receiver with the events it applied and the latency from the button
+# edge to the report. LATENCY_MAX_US fails the run above a ceiling.
+set -ue
+scripts=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+source "${scripts}/_env.source"
+
+simulation_id="trykkert_broadcast_fanout"
+broadcast_exe=./bs_${BOARD_TS}_trykkert_broadcast
+receiver_exe=./bs_${BOARD_TS}_trykkert_receiver
+stimulus=$(stimulus_dir ${simulation_id})
+receivers=8
+first_us=3000000
+period_us=500000
+hold_us=100000
+presses=40
+
+button_stimulus "${stimulus}/clicker.txt" "${PIN_SW0}" ${first_us} ${period_us} ${presses} ${hold_us}
+
+Execute "${broadcast_exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+    -gpio_in_file="${stimulus}/clicker.txt"
+
+logs=()
+for ((r = 0; r < receivers; r++)); do
+    logs+=("${stimulus}/rx${r}.log")
+    Execute "${receiver_exe}" -v=${verbosity_level} -s=${simulation_id} -d=$((r + 1)) -RealEncryption=1 \
+        > "${stimulus}/rx${r}.log"
+done
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=$((receivers + 1)) -sim_length=25e6 "$@"
+
+wait_for_background_jobs
+
+"${scripts}/broadcast_latency.py" --first-us ${first_us} --period-us ${period_us} \
+    --hold-us ${hold_us} --count ${presses} --latency-max-us ${LATENCY_MAX_US:-0} "${logs[@]}"
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Per-receiver latency of the clicker broadcast in a bsim run.
+
+The clicker presses button 0 on a fixed schedule (button_stimulus in
+_env.source) and numbers every press and release from 1 (broadcast.c).
+A receiver on nrf52_bsim logs each key report as "report seq N mask 0xM
+at T us", so event N is the (N-1)th edge of the schedule and its latency
+is T minus the edge time.
+
+    broadcast_latency.py --first-us 3000000 --period-us 500000 \\
+        --hold-us 100000 --count 40 rx0.log rx1.log ...
+"""
+
+import argparse
+import os
+import re
+import sys
+
+REPORT = re.compile(r"report seq (\d+) mask 0x([0-9a-f]+) at (\d+) us")
+
+
+def edges(args):
+    for i in range(args.count):
+        press = args.first_us + i * args.period_us
+        yield press, 1
+        yield press + args.hold_us, 0
+
+
+def reports(path):
+    seen = {}
+    with open(path, errors="replace") as log:
+        for line in log:
+            match = REPORT.search(line)
+            if match:
+                seq, mask, at = int(match[1]), int(match[2], 16), int(match[3])
+                # the release on sync loss repeats the last sequence number
+                seen.setdefault(seq, (mask, at))
+    return seen
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("logs", nargs="+", help="receiver outputs")
+    parser.add_argument("--first-us", type=int, required=True)
+    parser.add_argument("--period-us", type=int, required=True)
+    parser.add_argument("--hold-us", type=int, required=True)
+    parser.add_argument("--count", type=int, required=True, help="presses")
+    parser.add_argument("--latency-max-us", type=int, default=0, help="fail above this, 0 to only report")
+    args = parser.parse_args()
+
+    expected = list(edges(args))
+    ok = True
+
+    for path in args.logs:
+        seen = reports(path)
+        latencies = []
+        wrong = 0
+        for seq, (edge_us, mask) in enumerate(expected, start=1):
+            if seq not in seen:
+                continue
+            got_mask, at = seen[seq]
+            if got_mask != mask:
+                wrong += 1
+            latencies.append(at - edge_us)
+
+        name = os.path.splitext(os.path.basename(path))[0]
+        missing = len(expected) - len(latencies)
+        if latencies:
+            avg, worst = sum(latencies) // len(latencies), max(latencies)
+        else:
+            avg = worst = 0
+        print(f"RESULT broadcast {name} events={len(latencies)}/{len(expected)} wrong={wrong} "
+              f"latency_avg_us={avg} latency_max_us={worst}")
+
+        if missing or wrong or (args.latency_max_us and worst > args.latency_max_us):
+            ok = False
+
+    print("PASSED" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
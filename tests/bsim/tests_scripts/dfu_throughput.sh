@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# SMP image upload throughput (dfu.c): the tester central uploads a 64 KiB
+# image over a 7.5-15 ms, 2M PHY, 251 byte data length link and prints
+# the throughput on its RESULT line; the application logs its own view in
+# "Upload complete". MIN_BPS fails the run below a floor.
+set -ue
+source "$(dirname "${BASH_SOURCE[0]}")/_env.source"
+
+simulation_id="trykkert_dfu_throughput"
+size=${SIZE:-65536}
+
+stimulus=$(stimulus_dir ${simulation_id})
+button_idle "${stimulus}/dut.txt"
+
+Execute "${dut_exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+    -gpio_in_file="${stimulus}/dut.txt"
+
+Execute "${tester_exe}" -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=1 \
+    -testid=dfu_upload -argstest size=${size} window=${WINDOW:-2} min_bps=${MIN_BPS:-0} timeout_s=60
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=2 -sim_length=60e6 "$@"
+
+wait_for_background_jobs
@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# Host-side discovery and pair-to-first-keystroke time (Kconfig attribute
+# options). The same tester run goes against the default image ("cut")
+# and against dut_full with Battery Level Status and the LED output report
+# back in ("full"); the RESULT lines give the attribute count, the time
+# from connect to the end of discovery and to the first key report.
+# ATTRS_MAX and FIRST_KEY_MAX_MS fail the default image above a ceiling.
+set -ue
+source "$(dirname "${BASH_SOURCE[0]}")/_env.source"
+
+# <label> <dut image> <tester args...>
+run() {
+    local label=$1 exe=$2
+    local simulation_id="trykkert_discovery_${label}"
+    local stimulus
+    shift 2
+
+    stimulus=$(stimulus_dir ${simulation_id})
+    # a short press every 100 ms from 0.5 s, so the first key follows the subscription closely
+    button_stimulus "${stimulus}/dut.txt" "${PIN_SW0}" 500000 100000 200 50000
+
+    echo "discovery ${label}:"
+    Execute "${exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+        -gpio_in_file="${stimulus}/dut.txt"
+
+    Execute "${tester_exe}" -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=1 \
+        -testid=discovery -argstest "$@" timeout_s=20
+
+    Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=2 -sim_length=20e6
+
+    wait_for_background_jobs
+    process_ids="" # reaped, the next run waits for its own
+}
+
+run full ./bs_${BOARD_TS}_trykkert_dut_full
+run cut "${dut_exe}" attrs_max=${ATTRS_MAX:-0} first_key_max_ms=${FIRST_KEY_MAX_MS:-0}
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# Hardware edge timestamps (edge.c) on the nrf52_bsim GPIOTE, PPI and
+# TIMER models. Every press and release of the clicker chatters for 4 ms
+# before it settles. The first edge of each press has to start TIMER3 and
+# debouncing has to stop it again: a press whose edges do not start the
+# timer never reads as quiet and is never reported, and a timer that is not
+# restarted loses every press after the first. The tester reports the
+# presses it got and the time from the first edge to the report.
+set -ue
+source "$(dirname "${BASH_SOURCE[0]}")/_env.source"
+
+simulation_id="trykkert_edge_timestamps"
+stimulus=$(stimulus_dir ${simulation_id})
+t0_ms=5000
+period_ms=500
+presses=20
+
+button_stimulus "${stimulus}/dut.txt" "${PIN_SW0}" $((t0_ms * 1000)) $((period_ms * 1000)) ${presses} 100000 4
+
+Execute "${dut_exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+    -gpio_in_file="${stimulus}/dut.txt"
+
+Execute "${tester_exe}" -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=1 \
+    -testid=keys_host -argstest t0_ms=${t0_ms} period_ms=${period_ms} presses=${presses} \
+    latency_max_us=${LATENCY_MAX_US:-0} timeout_s=20
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=2 -sim_length=20e6 "$@"
+
+wait_for_background_jobs
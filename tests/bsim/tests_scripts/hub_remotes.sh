@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# One hub, four remotes and an unbonded unit (hub.c).
+#
+#  - The hub gets the pairing gesture (both buttons held past the long
+#    press) at 0.1 s and pairs the four remotes inside its 30 s window.
+#  - The tester is the hub's host. Remote r presses every second from 15 s
+#    in slot r (200 ms slots); the tester reports, per remote, the time
+#    from the remote's GPIO edge to the hub's keyboard report.
+#  - A fifth unit boots at 36 s, after the window, and presses in slot 4;
+#    none of its presses may reach the host.
+set -ue
+source "$(dirname "${BASH_SOURCE[0]}")/_env.source"
+
+simulation_id="trykkert_hub_remotes"
+hub_exe=./bs_${BOARD_TS}_trykkert_hub
+stimulus=$(stimulus_dir ${simulation_id})
+presses=15
+
+button_stimulus "${stimulus}/hub.txt" "${PIN_SW0},${PIN_SW1}" 100000 0 1 5200000
+for r in 0 1 2 3; do
+    button_stimulus "${stimulus}/remote${r}.txt" "${PIN_SW0}" $((15000000 + r * 200000)) 1000000 ${presses} 50000
+done
+button_stimulus "${stimulus}/intruder.txt" "${PIN_SW0}" 40800000 1000000 10 50000
+
+Execute "${hub_exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+    -gpio_in_file="${stimulus}/hub.txt"
+
+for r in 0 1 2 3; do
+    Execute "${dut_exe}" -v=${verbosity_level} -s=${simulation_id} -d=$((r + 1)) -RealEncryption=1 \
+        -gpio_in_file="${stimulus}/remote${r}.txt"
+done
+
+Execute "${dut_exe}" -v=${verbosity_level} -s=${simulation_id} -d=5 -RealEncryption=1 \
+    -start_offset=36e6 -gpio_in_file="${stimulus}/intruder.txt"
+
+Execute "${tester_exe}" -v=${verbosity_level} -s=${simulation_id} -d=6 -RealEncryption=1 \
+    -testid=hub_host -argstest start_ms=6000 t0_ms=15000 period_ms=1000 slot_ms=200 slots=5 \
+    presses=${presses} end_ms=52000 latency_max_us=${LATENCY_MAX_US:-30000} timeout_s=58
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=7 -sim_length=55e6 "$@"
+
+wait_for_background_jobs
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Radio activity of one device in idle windows of a bsim run.
+
+bsim has no current model, so the idle current is compared by what drives
+it: how often the radio of the device wakes up and for how long. The 2G4
+phy run with -dump writes every transmission and reception of device N to
+d_2G4_NN.Tx.csv and d_2G4_NN.Rx.csv in the results directory. The windows
+are the stretch before every press of the stimulus schedule
+(button_stimulus in _env.source), where the link has to be idle.
+
+With --active-us, the transmissions in that long after each press are
+checked against the idle window before it: going from idle to active
+must neither raise the TX power (txpower.c) nor change the modulation
+(phy.c), as a late acknowledgement on the slow idle link would.
+
+    radio_activity.py --label subrating --device 0 --first-us 75000000 \\
+        --period-us 75000000 --count 3 --window-us 10000000 results/<id>
+"""
+
+import argparse
+import csv
+import glob
+import os
+import re
+import sys
+
+
+def dump(results, device, kind):
+    for path in glob.glob(os.path.join(results, "d_2G4_*.%s.csv" % kind)):
+        match = re.search(r"_0*(\d+)\.%s\.csv$" % kind, path)
+        if match and int(match[1]) == device:
+            return path
+    return None
+
+
+def activity(path, kind):
+    """(start_us, radio on us) per Tx or Rx entry"""
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            start = float(row["start_time"])
+            if kind == "Tx":
+                end = float(row["end_time"])
+            elif row.get("payload_end") and float(row["payload_end"]) > start:
+                end = float(row["payload_end"])  # received, on until the end of the packet
+            else:
+                end = start + float(row.get("scan_duration") or 0)
+            yield start, max(end - start, 0)
+
+
+def transmissions(path):
+    """(start_us, power_level, modulation) per Tx entry"""
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            yield float(row["start_time"]), float(row["power_level"]), row["modulation"]
+
+
+def transition_check(path, windows, active_us):
+    """True if no press raised the TX power or changed the modulation"""
+    ok = True
+    for n, (lo, hi) in enumerate(windows):
+        press = hi + 500000
+        idle = [(p, m) for t, p, m in transmissions(path) if lo <= t < hi]
+        active = [(p, m) for t, p, m in transmissions(path) if press <= t < press + active_us]
+        if not idle or not active:
+            print("RESULT transition press=%d no transmissions to compare" % n)
+            ok = False
+            continue
+        idle_power = max(p for p, _ in idle)
+        active_power = max(p for p, _ in active)
+        changed = {m for _, m in active} - {m for _, m in idle}
+        print("RESULT transition press=%d idle_power=%.1f active_power=%.1f modulation=%s"
+              % (n, idle_power, active_power, "changed" if changed else "kept"))
+        ok &= active_power <= idle_power and not changed
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--label", default="")
+    parser.add_argument("--device", type=int, default=0)
+    parser.add_argument("--first-us", type=int, required=True)
+    parser.add_argument("--period-us", type=int, required=True)
+    parser.add_argument("--count", type=int, required=True)
+    parser.add_argument("--window-us", type=int, required=True,
+                        help="length of the idle window that ends 500 ms before each press")
+    parser.add_argument("--active-us", type=int, default=0,
+                        help="check the TX power and modulation this long after each press")
+    parser.add_argument("results")
+    args = parser.parse_args()
+
+    windows = []
+    for i in range(args.count):
+        end = args.first_us + i * args.period_us - 500000
+        windows.append((end - args.window_us, end))
+
+    totals = {}
+    for kind in ("Tx", "Rx"):
+        path = dump(args.results, args.device, kind)
+        if not path:
+            print("no %s dump of device %d in %s, run the phy with -dump"
+                  % (kind, args.device, args.results), file=sys.stderr)
+            return 1
+        events, on_us = 0, 0.0
+        for start, length in activity(path, kind):
+            if any(lo <= start < hi for lo, hi in windows):
+                events += 1
+                on_us += length
+        totals[kind] = (events, on_us)
+
+    seconds = len(windows) * args.window_us / 1e6
+    tx, rx = totals["Tx"], totals["Rx"]
+    print("RESULT radio %s tx_per_s=%.1f rx_per_s=%.1f radio_on_us_per_s=%.0f"
+          % (args.label, tx[0] / seconds, rx[0] / seconds, (tx[1] + rx[1]) / seconds))
+
+    if args.active_us and not transition_check(dump(args.results, args.device, "Tx"), windows,
+                                               args.active_us):
+        print("idle to active raised the TX power or changed the PHY", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+# Idle link by subrating (wake.c, CONFIG_APP_CONN_SUBRATING) against the
+# connection parameter update of dut_nosubrate. The clicker connects and is
+# left alone until the idle timeout, then pressed once a period, so the
+# link goes idle and back before every press. The tester prints the time
+# from each press until the link is fast again and the idle event
+# interval; radio_activity.py prints how often and how long the clicker's
+# radio ran in the idle stretch before each press, the stand-in for the
+# idle current on bsim. Both runs fail when the first two seconds after a
+# press go out with more TX power or another PHY than the idle link before
+# it. TRANSITION_MAX_MS fails the subrating run when the link takes longer
+# to come back.
+set -ue
+scripts=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+source "$(dirname "${BASH_SOURCE[0]}")/_env.source"
+
+# a press 15 s after each idle timeout (WAKE_IDLE_TIMEOUT_MS, 60 s)
+t0_ms=75000
+period_ms=75000
+presses=3
+sim_length=$(((t0_ms + presses * period_ms + 5000) * 1000)) # the tester reports after the last period
+
+# <label> <dut image> <tester args...>
+run() {
+    local label=$1 exe=$2
+    local simulation_id="trykkert_subrating_${label}"
+    local stimulus
+    shift 2
+
+    stimulus=$(stimulus_dir ${simulation_id})
+    button_stimulus "${stimulus}/dut.txt" "${PIN_SW0}" $((t0_ms * 1000)) $((period_ms * 1000)) \
+        ${presses} 100000
+
+    echo "idle link ${label}:"
+    Execute "${exe}" -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=1 \
+        -gpio_in_file="${stimulus}/dut.txt"
+
+    Execute "${tester_exe}" -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=1 \
+        -testid=idle_link -argstest t0_ms=${t0_ms} period_ms=${period_ms} presses=${presses} \
+        timeout_s=$((sim_length / 1000000 + 10)) "$@"
+
+    Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=2 -sim_length=${sim_length} \
+        -dump
+
+    wait_for_background_jobs
+    process_ids="" # reaped, the next run waits for its own
+
+    python3 "${scripts}/radio_activity.py" --label ${label} --device 0 \
+        --first-us $((t0_ms * 1000)) --period-us $((period_ms * 1000)) --count ${presses} \
+        --window-us 10000000 --active-us 2000000 "${BSIM_OUT_PATH}/results/${simulation_id}" || failed=1
+}
+
+failed=0
+
+run param_update ./bs_${BOARD_TS}_trykkert_dut_nosubrate
+run subrating "${dut_exe}" transition_max_ms=${TRANSITION_MAX_MS:-0}
+
+exit ${failed}
@@ -0,0 +1,72 @@
+# Attach the native_sim USB/IP device on this host and check what the host
+# actually receives through hidraw: every report of the burst and of the
+# paced sequence in order, none dropped, and the endpoint latency the device
+# measured between queuing a report and the host polling it.
+
+import glob
+import os
+import re
+import select
+import subprocess
+import time
+
+from twister_harness import DeviceAdapter
+
+BURST_LEN = 8
+PACED_LEN = 100
+KEY_CODE = 0x4E
+LATENCY_MAX_US = 4000  # Four 1 ms polling intervals
+
+
+def usbip(*args):
+    return subprocess.run(['usbip', *args], check=True, capture_output=True, text=True).stdout
+
+
+def hidraw_node(timeout=10):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        for uevent in glob.glob('/sys/class/hidraw/hidraw*/device/uevent'):
+            with open(uevent) as f:
+                if 'trykkert' in f.read():
+                    return '/dev/' + uevent.split('/')[4]
+        time.sleep(0.1)
+    raise AssertionError('no hidraw node for the emulated keyboard')
+
+
+def read_reports(node, count, timeout=10):
+    reports = []
+    fd = os.open(node, os.O_RDONLY | os.O_NONBLOCK)
+    try:
+        deadline = time.monotonic() + timeout
+        while len(reports) < count and time.monotonic() < deadline:
+            ready, _, _ = select.select([fd], [], [], 0.5)
+            if ready:
+                reports.append(os.read(fd, 64))
+    finally:
+        os.close(fd)
+    return reports
+
+
+def test_usbip_reports(dut: DeviceAdapter):
+    dut.readlines_until(regex='waiting for host', timeout=10)
+
+    busid = re.search(r'^\s+(\d+-\d+):', usbip('list', '-r', '127.0.0.1'), re.M).group(1)
+    usbip('attach', '-r', '127.0.0.1', '-b', busid)
+    try:
+        node = hidraw_node()
+        reports = read_reports(node, BURST_LEN + 2 * PACED_LEN)
+        done = dut.readlines_until(regex='done sent', timeout=30)[-1]
+    finally:
+        for port in re.findall(r'^Port (\d+): <Port in Use>', usbip('port'), re.M):
+            subprocess.run(['usbip', 'detach', '-p', port], capture_output=True)
+
+    keys = [r[2] for r in reports]
+    expected = [KEY_CODE if i % 2 == 0 else 0 for i in range(BURST_LEN + 2 * PACED_LEN)]
+    assert keys == expected, f'host saw {len(keys)} reports, first mismatch at {next((i for i, (a, b) in enumerate(zip(keys, expected)) if a != b), len(keys))}'
+
+    stats = re.search(r'sent (\d+) dropped (\d+) latency last (\d+) us max (\d+) us', done)
+    sent, dropped, _, latency_max = (int(v) for v in stats.groups())
+    print(f'usbip: {sent} reports, {dropped} dropped, endpoint latency max {latency_max} us')
+    assert dropped == 0
+    assert sent == len(expected)
+    assert latency_max <= LATENCY_MAX_US
@@ -0,0 +1,74 @@
+#include <zephyr/kernel.h>
+#include <zephyr/usb/class/usb_hid.h>
+
+#include "usbhid.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(usbip_test);
+
+#define BURST_LEN    8   // Back-to-back reports, like a pending replay
+#define PACED_LEN    100 // Press and release pairs at typing speed
+#define PACED_GAP_MS 20
+#define KEY_CODE     0x4e // Page Down, the default forward key
+
+// Boot keyboard without a report ID, the layout usbhid carries on the XIAO
+static const uint8_t report_map[] = HID_KEYBOARD_REPORT_DESC();
+
+static K_SEM_DEFINE(active_sem, 0, 1);
+
+
+static void state_changed(bool active)
+{
+    LOG_INF("transport %s", active ? "active" : "inactive");
+    if (active) {
+        k_sem_give(&active_sem);
+    }
+}
+
+
+static int key_send(uint8_t code)
+{
+    uint8_t report[8] = { 0 };
+
+    report[2] = code;
+    return usbhid_send(report, sizeof(report));
+}
+
+
+int main(void)
+{
+    struct usbhid_stats stats;
+    int err;
+
+    err = usbhid_init(report_map, sizeof(report_map), state_changed);
+    if (err) {
+        LOG_ERR("usbhid_init failed (err %d)", err);
+        return 0;
+    }
+
+    // The pytest attaches the device over USB/IP once this is printed
+    LOG_INF("waiting for host");
+    k_sem_take(&active_sem, K_FOREVER);
+    k_sleep(K_MSEC(500)); // Let the host finish binding hidraw
+
+    for (int i = 0; i < BURST_LEN; i++) {
+        err = key_send(i % 2 ? 0 : KEY_CODE);
+        if (err) {
+            LOG_ERR("burst report %d failed (err %d)", i, err);
+        }
+    }
+    k_sleep(K_MSEC(100));
+
+    for (int i = 0; i < PACED_LEN; i++) {
+        key_send(KEY_CODE);
+        k_sleep(K_MSEC(PACED_GAP_MS / 2));
+        key_send(0);
+        k_sleep(K_MSEC(PACED_GAP_MS / 2));
+    }
+    k_sleep(K_MSEC(100));
+
+    usbhid_stats_get(&stats);
+    LOG_INF("done sent %u dropped %u latency last %u us max %u us",
+            stats.sent, stats.dropped, stats.latency_last_us, stats.latency_max_us);
+    return 0;
+}